@@ -42,6 +42,8 @@ public:
     this->buildPlane(0, 1, 2, 1, -1, width, height, depth, widthSegments, heightSegments, 4);   // pz
     this->buildPlane(0, 1, 2, -1, -1, width, height, -depth, widthSegments, heightSegments, 5); // nz
 
+    this->optimize();
+    this->computeTangents();
     this->setupBuffers();
   }
 
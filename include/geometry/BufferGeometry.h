@@ -5,6 +5,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <geometry/Vertex.h>
+#include <geometry/Tangents.h>
+#include <geometry/PackedVertex.h>
+#include <tool/mesh_optimizer.h>
+#include <tool/instance_buffer.h>
+#include <tool/geometry_arena.h>
+#include <tool/bounds.h>
 
 #include <string>
 #include <vector>
@@ -14,17 +21,6 @@ using namespace std;
 
 const float PI = glm::pi<float>();
 
-// mesh.h中也定义此属性
-struct Vertex
-{
-  glm::vec3 Position;  // 顶点位置
-  glm::vec3 Normal;    // 法线
-  glm::vec2 TexCoords; // 纹理坐标
-
-  glm::vec3 Tangent;   // 切线
-  glm::vec3 Bitangent; // 副切线
-};
-
 class BufferGeometry
 {
 public:
@@ -32,6 +28,15 @@ public:
   vector<unsigned int> indices;
   unsigned int VAO;
 
+  // 模型空间包围盒与包围球，在 setupBuffers 时计算
+  BoundingBox boundingBox;
+  BoundingSphere boundingSphere;
+
+  // 压缩顶点格式，packed 为 true 时着色器需要用 positionOffset / positionScale 解码位置
+  bool packed = false;
+  glm::vec3 positionOffset = glm::vec3(0.0f);
+  glm::vec3 positionScale = glm::vec3(1.0f);
+
   void logParameters()
   {
     for (unsigned int i = 0; i < vertices.size(); i++)
@@ -44,9 +49,54 @@ public:
     }
   }
 
+  // 按顶点缓存 / overdraw / 顶点读取顺序重排索引与顶点，需在 setupBuffers 之前调用
+  MeshOptimizeReport optimize()
+  {
+    return optimizeMesh(vertices, indices);
+  }
+
   // 计算切线向量并添加到顶点属性中
   void computeTangents()
   {
+    computeTangentFrames(vertices, indices);
+  }
+
+  // 改用压缩顶点格式重新上传顶点数据，VAO 保持不变
+  void usePackedVertices(PositionEncoding encoding = POSITION_SNORM16)
+  {
+    PackedVertexBuffer packedBuffer = packVertices(vertices, true, encoding);
+    packed = true;
+    positionOffset = packedBuffer.positionOffset;
+    positionScale = packedBuffer.positionScale;
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, packedBuffer.data.size(), packedBuffer.data.data(), GL_STATIC_DRAW);
+    packedBuffer.setupAttributes();
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+  }
+
+  // 以 transform 变换后合并进 arena，返回 arena 中的句柄
+  unsigned int addTo(GeometryArena &arena, const glm::mat4 &transform = glm::mat4(1.0f)) const
+  {
+    return arena.add(vertices, indices, transform);
+  }
+
+  // 一次绘制 instances.count 个实例，实例属性位于 location 5 - 12
+  void drawInstanced(const InstanceBuffer &instances)
+  {
+    if (instances.count == 0)
+      return;
+    if (instanceVBO != instances.VBO)
+    {
+      instances.attach(VAO);
+      instanceVBO = instances.VBO;
+    }
+    glBindVertexArray(VAO);
+    glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instances.count);
+    glBindVertexArray(0);
   }
 
   void dispose()
@@ -63,9 +113,12 @@ private:
 
 protected:
   unsigned int VBO, EBO;
+  unsigned int instanceVBO = 0; // 当前绑定到 VAO 上的实例缓冲
 
   void setupBuffers()
   {
+    computeBounds(vertices, boundingBox, boundingSphere);
+
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
@@ -93,6 +146,14 @@ protected:
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
 
+    // Tangent
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
+
+    // Bitangent
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
+
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
   }
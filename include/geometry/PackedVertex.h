@@ -0,0 +1,257 @@
+#ifndef PACKED_VERTEX_H
+#define PACKED_VERTEX_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <geometry/Vertex.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 压缩顶点格式（可选）
+ * Position  : 4 x int16  归一化到包围盒内 (snorm16)，或 4 x half
+ * Normal    : 2 x int16  八面体编码 (snorm16)
+ * TexCoords : 2 x half
+ * QTangent  : 4 x int16  四元数表示的切线空间，w 的符号为副切线手性，仅在有切线时上传
+ * 有切线 24 字节，无切线 16 字节（完整 Vertex 为 56 字节）
+ * 对应的 GLSL 解码函数见 src/24_meshes/shader/packed_vertex.glsl
+ */
+enum PositionEncoding
+{
+  POSITION_SNORM16, // 包围盒内的 16 位定点数，精度更高
+  POSITION_HALF     // 半精度浮点，不需要包围盒
+};
+
+struct PackedVertex
+{
+  int16_t Position[4];
+  int16_t Normal[2];
+  uint16_t TexCoords[2];
+};
+
+struct PackedTangentVertex
+{
+  int16_t Position[4];
+  int16_t Normal[2];
+  uint16_t TexCoords[2];
+  int16_t QTangent[4];
+};
+
+// 交错存放的压缩顶点数据以及着色器解码位置需要的参数
+struct PackedVertexBuffer
+{
+  vector<unsigned char> data;
+  unsigned int stride = 0;
+  bool hasTangents = false;
+  PositionEncoding encoding = POSITION_SNORM16;
+
+  // 解码: position = positionOffset + positionScale * decoded
+  glm::vec3 positionOffset = glm::vec3(0.0f);
+  glm::vec3 positionScale = glm::vec3(1.0f);
+
+  unsigned int vertexCount() const
+  {
+    return stride ? (unsigned int)(data.size() / stride) : 0;
+  }
+
+  // 设置顶点属性指针，调用前需要绑定 VAO 与 VBO
+  void setupAttributes() const
+  {
+    GLenum positionType = encoding == POSITION_HALF ? GL_HALF_FLOAT : GL_SHORT;
+    GLboolean positionNormalized = encoding == POSITION_HALF ? GL_FALSE : GL_TRUE;
+
+    // Position
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, positionType, positionNormalized, stride, (void *)offsetof(PackedVertex, Position));
+
+    // Normal
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void *)offsetof(PackedVertex, Normal));
+
+    // TexCoords
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void *)offsetof(PackedVertex, TexCoords));
+
+    // QTangent
+    if (hasTangents)
+    {
+      glEnableVertexAttribArray(3);
+      glVertexAttribPointer(3, 4, GL_SHORT, GL_TRUE, stride, (void *)offsetof(PackedTangentVertex, QTangent));
+    }
+    else
+      glDisableVertexAttribArray(3);
+
+    // Bitangent 已经合并到 QTangent 中
+    glDisableVertexAttribArray(4);
+  }
+};
+
+namespace packing
+{
+  inline glm::vec2 signNotZero(glm::vec2 v)
+  {
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+  }
+
+  // 单位向量 -> 八面体展开到 [-1, 1]^2
+  inline glm::vec2 octEncode(glm::vec3 n)
+  {
+    float sum = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+    if (sum <= 0.0f)
+      return glm::vec2(0.0f);
+    n /= sum;
+    glm::vec2 p = glm::vec2(n.x, n.y);
+    if (n.z < 0.0f)
+      p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+    return p;
+  }
+
+  inline glm::vec3 octDecode(glm::vec2 p)
+  {
+    glm::vec3 n = glm::vec3(p.x, p.y, 1.0f - glm::abs(p.x) - glm::abs(p.y));
+    if (n.z < 0.0f)
+    {
+      glm::vec2 xy = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(glm::vec2(n.x, n.y));
+      n.x = xy.x;
+      n.y = xy.y;
+    }
+    return glm::normalize(n);
+  }
+
+  // 由 (T, B, N) 构造 QTangent：w 始终不为 0，负号代表镜像的副切线
+  inline glm::quat qtangentEncode(glm::vec3 normal, glm::vec3 tangent, glm::vec3 bitangent)
+  {
+    glm::vec3 n = glm::normalize(normal);
+    glm::vec3 t = tangent - n * glm::dot(n, tangent);
+    if (glm::dot(t, t) < 1e-12f)
+      t = glm::abs(n.x) < 0.9f ? glm::cross(glm::vec3(1.0f, 0.0f, 0.0f), n) : glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), n);
+    t = glm::normalize(t);
+    glm::vec3 b = glm::cross(n, t);
+    float handedness = glm::dot(b, bitangent) < 0.0f ? -1.0f : 1.0f;
+
+    glm::quat q = glm::normalize(glm::quat_cast(glm::mat3(t, b, n)));
+    if (q.w < 0.0f)
+      q = -q;
+
+    // snorm16 量化后 w 不能为 0，否则会丢失符号
+    const float bias = 1.0f / 32767.0f;
+    if (q.w < bias)
+    {
+      float scale = glm::sqrt(1.0f - bias * bias);
+      q = glm::quat(bias, q.x * scale, q.y * scale, q.z * scale);
+    }
+    if (handedness < 0.0f)
+      q = -q;
+    return q;
+  }
+
+  inline int16_t snorm16(float v)
+  {
+    return (int16_t)glm::packSnorm1x16(v);
+  }
+}
+
+// 按 encoding 压缩顶点，hasTangents 为 false 时不写入 QTangent
+inline PackedVertexBuffer packVertices(const vector<Vertex> &vertices, bool hasTangents, PositionEncoding encoding = POSITION_SNORM16)
+{
+  PackedVertexBuffer packed;
+  packed.hasTangents = hasTangents;
+  packed.encoding = encoding;
+  packed.stride = hasTangents ? sizeof(PackedTangentVertex) : sizeof(PackedVertex);
+  packed.data.resize(vertices.size() * packed.stride);
+
+  if (encoding == POSITION_SNORM16 && !vertices.empty())
+  {
+    glm::vec3 minPos = vertices[0].Position;
+    glm::vec3 maxPos = vertices[0].Position;
+    for (unsigned int i = 1; i < vertices.size(); i++)
+    {
+      minPos = glm::min(minPos, vertices[i].Position);
+      maxPos = glm::max(maxPos, vertices[i].Position);
+    }
+    packed.positionOffset = (minPos + maxPos) * 0.5f;
+    packed.positionScale = glm::max((maxPos - minPos) * 0.5f, glm::vec3(1e-8f));
+  }
+
+  for (unsigned int i = 0; i < vertices.size(); i++)
+  {
+    const Vertex &vertex = vertices[i];
+    PackedTangentVertex out;
+
+    if (encoding == POSITION_SNORM16)
+    {
+      glm::vec3 p = (vertex.Position - packed.positionOffset) / packed.positionScale;
+      out.Position[0] = packing::snorm16(p.x);
+      out.Position[1] = packing::snorm16(p.y);
+      out.Position[2] = packing::snorm16(p.z);
+      out.Position[3] = 32767;
+    }
+    else
+    {
+      out.Position[0] = (int16_t)glm::packHalf1x16(vertex.Position.x);
+      out.Position[1] = (int16_t)glm::packHalf1x16(vertex.Position.y);
+      out.Position[2] = (int16_t)glm::packHalf1x16(vertex.Position.z);
+      out.Position[3] = (int16_t)glm::packHalf1x16(1.0f);
+    }
+
+    glm::vec2 oct = packing::octEncode(vertex.Normal);
+    out.Normal[0] = packing::snorm16(oct.x);
+    out.Normal[1] = packing::snorm16(oct.y);
+
+    out.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+    out.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+
+    if (hasTangents)
+    {
+      glm::quat q = packing::qtangentEncode(vertex.Normal, vertex.Tangent, vertex.Bitangent);
+      out.QTangent[0] = packing::snorm16(q.x);
+      out.QTangent[1] = packing::snorm16(q.y);
+      out.QTangent[2] = packing::snorm16(q.z);
+      out.QTangent[3] = packing::snorm16(q.w);
+    }
+
+    memcpy(&packed.data[i * packed.stride], &out, packed.stride);
+  }
+  return packed;
+}
+
+// packVertices 的逆过程，与 packed_vertex.glsl 的解码一致；没有切线时 Tangent / Bitangent 为 0
+inline vector<Vertex> unpackVertices(const PackedVertexBuffer &packed)
+{
+  vector<Vertex> vertices(packed.vertexCount());
+  for (unsigned int i = 0; i < vertices.size(); i++)
+  {
+    PackedTangentVertex in = {};
+    memcpy(&in, &packed.data[i * packed.stride], packed.stride);
+    Vertex &vertex = vertices[i];
+
+    glm::vec3 p;
+    for (int c = 0; c < 3; c++)
+      p[c] = packed.encoding == POSITION_HALF ? glm::unpackHalf1x16((uint16_t)in.Position[c]) : glm::unpackSnorm1x16((uint16_t)in.Position[c]);
+    vertex.Position = packed.encoding == POSITION_HALF ? p : packed.positionOffset + packed.positionScale * p;
+
+    vertex.Normal = packing::octDecode(glm::vec2(glm::unpackSnorm1x16((uint16_t)in.Normal[0]), glm::unpackSnorm1x16((uint16_t)in.Normal[1])));
+    vertex.TexCoords = glm::vec2(glm::unpackHalf1x16(in.TexCoords[0]), glm::unpackHalf1x16(in.TexCoords[1]));
+
+    vertex.Tangent = glm::vec3(0.0f);
+    vertex.Bitangent = glm::vec3(0.0f);
+    if (packed.hasTangents)
+    {
+      // tangent = q * X, bitangent = sign(q.w) * cross(normal, tangent)
+      glm::quat q = glm::normalize(glm::quat(glm::unpackSnorm1x16((uint16_t)in.QTangent[3]), glm::unpackSnorm1x16((uint16_t)in.QTangent[0]),
+                                             glm::unpackSnorm1x16((uint16_t)in.QTangent[1]), glm::unpackSnorm1x16((uint16_t)in.QTangent[2])));
+      vertex.Tangent = q * glm::vec3(1.0f, 0.0f, 0.0f);
+      vertex.Bitangent = (q.w < 0.0f ? -1.0f : 1.0f) * glm::cross(vertex.Normal, vertex.Tangent);
+    }
+  }
+  return vertices;
+}
+
+#endif
@@ -56,6 +56,8 @@ public:
       }
     }
 
+    this->optimize();
+    this->computeTangents();
     this->setupBuffers();
   }
 };
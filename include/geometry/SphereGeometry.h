@@ -91,6 +91,8 @@ public:
       }
     }
 
+    this->optimize();
+    this->computeTangents();
     this->setupBuffers();
   }
 };
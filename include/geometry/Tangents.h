@@ -0,0 +1,267 @@
+#ifndef TANGENTS_H
+#define TANGENTS_H
+
+#include <glm/glm.hpp>
+
+#include <geometry/Vertex.h>
+#include <tool/thread_pool.h>
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TANGENTS_USE_SSE 1
+#endif
+
+using namespace std;
+
+/**
+ * 切线空间生成：按顶点累加相邻三角形的切线，以三角形在该顶点处的夹角为权重
+ * （不拆分顶点，UV 接缝或手性相反处与 MikkTSpace 的结果不同）
+ * 1. 按三角形计算 UV 梯度方向 (dP/du, dP/dv) 与三个角的夹角，SSE 每次处理 4 个三角形
+ * 2. 对每个顶点收集相邻三角形，把切线投影到法线平面后按夹角加权累加
+ * 3. 正交化，副切线 = sign * cross(N, T)，sign 为 UV 手性
+ * 三角形与顶点两个阶段都按区间拆分到线程池
+ */
+namespace tangents
+{
+  // 每个工作块最少处理的三角形 / 顶点数量，过小的网格直接在当前线程完成
+  const size_t MIN_TRIANGLES_PER_JOB = 4096;
+  const size_t MIN_VERTICES_PER_JOB = 4096;
+
+  struct FaceFrame
+  {
+    glm::vec3 tangent;   // 归一化的 dP/du，退化三角形为 0
+    glm::vec3 bitangent; // 归一化的 dP/dv
+    float angle[3];      // 三个角的夹角，作为累加权重
+  };
+
+  inline float cornerAngle(const glm::vec3 &a, const glm::vec3 &b)
+  {
+    float la = glm::length(a);
+    float lb = glm::length(b);
+    if (la <= 0.0f || lb <= 0.0f)
+      return 0.0f;
+    return std::acos(glm::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f));
+  }
+
+  inline void scalarFace(const vector<Vertex> &vertices, const unsigned int *tri, FaceFrame &face)
+  {
+    const Vertex &v0 = vertices[tri[0]];
+    const Vertex &v1 = vertices[tri[1]];
+    const Vertex &v2 = vertices[tri[2]];
+
+    glm::vec3 e1 = v1.Position - v0.Position;
+    glm::vec3 e2 = v2.Position - v0.Position;
+    glm::vec2 d1 = v1.TexCoords - v0.TexCoords;
+    glm::vec2 d2 = v2.TexCoords - v0.TexCoords;
+
+    float det = d1.x * d2.y - d2.x * d1.y;
+    face.tangent = glm::vec3(0.0f);
+    face.bitangent = glm::vec3(0.0f);
+    if (std::fabs(det) > 1e-20f)
+    {
+      float r = 1.0f / det;
+      glm::vec3 t = (e1 * d2.y - e2 * d1.y) * r;
+      glm::vec3 b = (e2 * d1.x - e1 * d2.x) * r;
+      float lt = glm::length(t);
+      float lb = glm::length(b);
+      if (lt > 0.0f)
+        face.tangent = t / lt;
+      if (lb > 0.0f)
+        face.bitangent = b / lb;
+    }
+
+    face.angle[0] = cornerAngle(e1, e2);
+    face.angle[1] = cornerAngle(v2.Position - v1.Position, v0.Position - v1.Position);
+    face.angle[2] = cornerAngle(v0.Position - v2.Position, v1.Position - v2.Position);
+  }
+
+#ifdef TANGENTS_USE_SSE
+  struct Vec3x4
+  {
+    __m128 x, y, z;
+  };
+
+  inline Vec3x4 sub(const Vec3x4 &a, const Vec3x4 &b)
+  {
+    return {_mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z)};
+  }
+
+  inline __m128 dot(const Vec3x4 &a, const Vec3x4 &b)
+  {
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+  }
+
+  // 长度为 0 的向量保持为 0
+  inline Vec3x4 normalize(const Vec3x4 &a)
+  {
+    __m128 len = _mm_sqrt_ps(dot(a, a));
+    __m128 valid = _mm_cmpgt_ps(len, _mm_setzero_ps());
+    __m128 inv = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(len, _mm_set1_ps(1e-30f))));
+    return {_mm_mul_ps(a.x, inv), _mm_mul_ps(a.y, inv), _mm_mul_ps(a.z, inv)};
+  }
+
+  inline __m128 cosine(const Vec3x4 &a, const Vec3x4 &b)
+  {
+    Vec3x4 na = normalize(a);
+    Vec3x4 nb = normalize(b);
+    return _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_set1_ps(-1.0f), dot(na, nb)));
+  }
+
+  // 4 个三角形一组：顶点数据转成 SoA 后同时求解
+  inline void simdFaces(const vector<Vertex> &vertices, const unsigned int *tris, FaceFrame *faces)
+  {
+    alignas(16) float px[3][4], py[3][4], pz[3][4], tu[3][4], tv[3][4];
+    for (int lane = 0; lane < 4; lane++)
+    {
+      for (int c = 0; c < 3; c++)
+      {
+        const Vertex &v = vertices[tris[lane * 3 + c]];
+        px[c][lane] = v.Position.x;
+        py[c][lane] = v.Position.y;
+        pz[c][lane] = v.Position.z;
+        tu[c][lane] = v.TexCoords.x;
+        tv[c][lane] = v.TexCoords.y;
+      }
+    }
+
+    Vec3x4 p[3];
+    __m128 u[3], v[3];
+    for (int c = 0; c < 3; c++)
+    {
+      p[c] = {_mm_load_ps(px[c]), _mm_load_ps(py[c]), _mm_load_ps(pz[c])};
+      u[c] = _mm_load_ps(tu[c]);
+      v[c] = _mm_load_ps(tv[c]);
+    }
+
+    Vec3x4 e1 = sub(p[1], p[0]);
+    Vec3x4 e2 = sub(p[2], p[0]);
+    __m128 du1 = _mm_sub_ps(u[1], u[0]);
+    __m128 dv1 = _mm_sub_ps(v[1], v[0]);
+    __m128 du2 = _mm_sub_ps(u[2], u[0]);
+    __m128 dv2 = _mm_sub_ps(v[2], v[0]);
+
+    __m128 det = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+    __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 valid = _mm_cmpgt_ps(absDet, _mm_set1_ps(1e-20f));
+    __m128 safeDet = _mm_or_ps(_mm_and_ps(valid, det), _mm_andnot_ps(valid, _mm_set1_ps(1.0f)));
+    __m128 r = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), safeDet));
+
+    Vec3x4 t = {_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1.x, dv2), _mm_mul_ps(e2.x, dv1)), r),
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1.y, dv2), _mm_mul_ps(e2.y, dv1)), r),
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1.z, dv2), _mm_mul_ps(e2.z, dv1)), r)};
+    Vec3x4 b = {_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2.x, du1), _mm_mul_ps(e1.x, du2)), r),
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2.y, du1), _mm_mul_ps(e1.y, du2)), r),
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2.z, du1), _mm_mul_ps(e1.z, du2)), r)};
+    t = normalize(t);
+    b = normalize(b);
+
+    Vec3x4 e12 = sub(p[2], p[1]);
+    __m128 cos0 = cosine(e1, e2);
+    __m128 cos1 = cosine(e12, sub(p[0], p[1]));
+    __m128 cos2 = cosine(sub(p[0], p[2]), sub(p[1], p[2]));
+
+    alignas(16) float out[9][4];
+    _mm_store_ps(out[0], t.x);
+    _mm_store_ps(out[1], t.y);
+    _mm_store_ps(out[2], t.z);
+    _mm_store_ps(out[3], b.x);
+    _mm_store_ps(out[4], b.y);
+    _mm_store_ps(out[5], b.z);
+    _mm_store_ps(out[6], cos0);
+    _mm_store_ps(out[7], cos1);
+    _mm_store_ps(out[8], cos2);
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+      FaceFrame &face = faces[lane];
+      face.tangent = glm::vec3(out[0][lane], out[1][lane], out[2][lane]);
+      face.bitangent = glm::vec3(out[3][lane], out[4][lane], out[5][lane]);
+      face.angle[0] = std::acos(out[6][lane]);
+      face.angle[1] = std::acos(out[7][lane]);
+      face.angle[2] = std::acos(out[8][lane]);
+    }
+  }
+#endif
+
+  // 法线平面内任取一条切线，用于没有有效 UV 的顶点
+  inline glm::vec3 anyTangent(const glm::vec3 &n)
+  {
+    glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::normalize(glm::cross(axis, n));
+  }
+
+  inline void accumulateVertex(Vertex &vertex, const FaceFrame *faces, const unsigned int *corners, unsigned int cornerCount)
+  {
+    glm::vec3 n = vertex.Normal;
+    float nl = glm::length(n);
+    n = nl > 0.0f ? n / nl : glm::vec3(0.0f, 0.0f, 1.0f);
+
+    glm::vec3 t(0.0f);
+    glm::vec3 b(0.0f);
+    for (unsigned int i = 0; i < cornerCount; i++)
+    {
+      unsigned int corner = corners[i];
+      const FaceFrame &face = faces[corner / 3];
+      float weight = face.angle[corner % 3];
+
+      glm::vec3 ft = face.tangent - n * glm::dot(n, face.tangent);
+      glm::vec3 fb = face.bitangent - n * glm::dot(n, face.bitangent);
+      float lt = glm::length(ft);
+      float lb = glm::length(fb);
+      if (lt > 0.0f)
+        t += ft * (weight / lt);
+      if (lb > 0.0f)
+        b += fb * (weight / lb);
+    }
+
+    float lt = glm::length(t);
+    t = lt > 1e-12f ? t / lt : anyTangent(n);
+    float sign = glm::dot(glm::cross(n, t), b) < 0.0f ? -1.0f : 1.0f;
+
+    vertex.Tangent = t;
+    vertex.Bitangent = sign * glm::cross(n, t);
+  }
+}
+
+// 根据 Position / Normal / TexCoords 生成 Tangent 与 Bitangent
+inline void computeTangentFrames(vector<Vertex> &vertices, const vector<unsigned int> &indices)
+{
+  size_t triangleCount = indices.size() / 3;
+  if (vertices.empty() || triangleCount == 0)
+    return;
+
+  // 1. 三角形阶段
+  vector<tangents::FaceFrame> faces(triangleCount);
+  const unsigned int *tris = indices.data();
+  parallelFor(triangleCount, tangents::MIN_TRIANGLES_PER_JOB, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef TANGENTS_USE_SSE
+    for (; i + 4 <= end; i += 4)
+      tangents::simdFaces(vertices, tris + i * 3, &faces[i]);
+#endif
+    for (; i < end; i++)
+      tangents::scalarFace(vertices, tris + i * 3, faces[i]);
+  });
+
+  // 2. 顶点 -> 三角形角 的邻接表 (CSR)
+  vector<unsigned int> offsets(vertices.size() + 1, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+    offsets[indices[i] + 1]++;
+  for (size_t i = 0; i < vertices.size(); i++)
+    offsets[i + 1] += offsets[i];
+  vector<unsigned int> corners(triangleCount * 3);
+  vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+    corners[cursor[indices[i]]++] = (unsigned int)i;
+
+  // 3. 顶点阶段
+  parallelFor(vertices.size(), tangents::MIN_VERTICES_PER_JOB, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; v++)
+      tangents::accumulateVertex(vertices[v], faces.data(), &corners[offsets[v]], offsets[v + 1] - offsets[v]);
+  });
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include <glm/glm.hpp>
+
+// BufferGeometry 与 Mesh 共用的顶点结构
+struct Vertex
+{
+  glm::vec3 Position;  // 顶点位置
+  glm::vec3 Normal;    // 法线
+  glm::vec2 TexCoords; // 纹理坐标
+
+  glm::vec3 Tangent;   // 切线
+  glm::vec3 Bitangent; // 副切线
+};
+
+#endif
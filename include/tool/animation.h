@@ -0,0 +1,582 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <tool/shader.h>
+#include <tool/scene_graph.h>
+#include <tool/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANIMATION_USE_SSE 1
+#endif
+
+using namespace std;
+
+// Skeletal animation for many characters per frame:
+// - meshes carry four bone influences per vertex (VertexSkin, attributes 13 / 14),
+// - clips are resampled at load time into whole poses stored SoA, four joints per JointGroup, so sampling and
+//   cross-fading are a lerp / nlerp over SSE registers instead of key searches per joint and channel,
+// - evaluatePalettes() turns one AnimationState per character into 3x4 bone matrices, spread over the thread pool,
+// - SkinningPalette writes them into a texture buffer that the vertex shader indexes by gl_InstanceID.
+
+const unsigned int SKIN_ATTRIBUTE_BONES = 13;		// uvec4, glVertexAttribIPointer
+const unsigned int SKIN_ATTRIBUTE_WEIGHTS = 14; // unorm8 vec4
+const unsigned int MAX_SKIN_BONES = 256;				// bone indices are bytes
+const unsigned int PALETTE_FLOATS_PER_BONE = 12; // the three rows of the affine bone matrix
+const int PALETTE_TEXTURE_UNIT = 15;						 // above the units the materials use
+
+struct VertexSkin
+{
+	unsigned char bones[4];
+	unsigned char weights[4]; // sum to 255
+};
+
+// the influences of one vertex while they are collected from the importer; keeps the four strongest
+struct SkinInfluences
+{
+	unsigned int bone[4] = {0, 0, 0, 0};
+	float weight[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+	void add(unsigned int boneIndex, float boneWeight)
+	{
+		int weakest = 0;
+		for (int i = 1; i < 4; i++)
+			if (weight[i] < weight[weakest])
+				weakest = i;
+		if (boneWeight > weight[weakest])
+		{
+			bone[weakest] = boneIndex;
+			weight[weakest] = boneWeight;
+		}
+	}
+
+	// renormalised over the kept influences and quantised so that the bytes add up to exactly 255;
+	// a vertex without influences follows bone 0
+	VertexSkin pack() const
+	{
+		VertexSkin skin = {};
+		float total = weight[0] + weight[1] + weight[2] + weight[3];
+		if (total <= 0.0f)
+		{
+			skin.weights[0] = 255;
+			return skin;
+		}
+		int sum = 0, largest = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			skin.bones[i] = (unsigned char)bone[i];
+			skin.weights[i] = (unsigned char)(weight[i] / total * 255.0f + 0.5f);
+			sum += skin.weights[i];
+			if (weight[i] > weight[largest])
+				largest = i;
+		}
+		skin.weights[largest] = (unsigned char)(skin.weights[largest] + 255 - sum);
+		return skin;
+	}
+};
+
+// local transforms of four joints, lane j holding joint 4 * group + j
+struct alignas(16) JointGroup
+{
+	float rows[10][4];
+};
+enum
+{
+	JOINT_TRANSLATION = 0, // rows 0-2: x, y, z
+	JOINT_ROTATION = 3,		 // rows 3-6: quaternion x, y, z, w
+	JOINT_SCALE = 7				 // rows 7-9: x, y, z
+};
+
+namespace anim
+{
+	inline JointGroup identityGroup()
+	{
+		JointGroup group = {};
+		for (int lane = 0; lane < 4; lane++)
+		{
+			group.rows[JOINT_ROTATION + 3][lane] = 1.0f;
+			for (int i = 0; i < 3; i++)
+				group.rows[JOINT_SCALE + i][lane] = 1.0f;
+		}
+		return group;
+	}
+
+	inline void setJoint(JointGroup *groups, size_t joint, const glm::vec3 &translation, const glm::quat &rotation, const glm::vec3 &scale)
+	{
+		JointGroup &group = groups[joint / 4];
+		size_t lane = joint % 4;
+		for (int i = 0; i < 3; i++)
+		{
+			group.rows[JOINT_TRANSLATION + i][lane] = translation[i];
+			group.rows[JOINT_SCALE + i][lane] = scale[i];
+		}
+		group.rows[JOINT_ROTATION + 0][lane] = rotation.x;
+		group.rows[JOINT_ROTATION + 1][lane] = rotation.y;
+		group.rows[JOINT_ROTATION + 2][lane] = rotation.z;
+		group.rows[JOINT_ROTATION + 3][lane] = rotation.w;
+	}
+
+	inline void getJoint(const JointGroup *groups, size_t joint, glm::vec3 &translation, glm::quat &rotation, glm::vec3 &scale)
+	{
+		const JointGroup &group = groups[joint / 4];
+		size_t lane = joint % 4;
+		for (int i = 0; i < 3; i++)
+		{
+			translation[i] = group.rows[JOINT_TRANSLATION + i][lane];
+			scale[i] = group.rows[JOINT_SCALE + i][lane];
+		}
+		rotation = glm::quat(group.rows[JOINT_ROTATION + 3][lane], group.rows[JOINT_ROTATION + 0][lane], group.rows[JOINT_ROTATION + 1][lane],
+												 group.rows[JOINT_ROTATION + 2][lane]);
+	}
+
+	// translation * rotation * scale of one joint
+	inline glm::mat4 jointMatrix(const JointGroup *groups, size_t joint)
+	{
+		glm::vec3 translation, scale;
+		glm::quat rotation;
+		getJoint(groups, joint, translation, rotation, scale);
+		glm::mat3 r = glm::mat3_cast(rotation);
+		glm::mat4 m(1.0f);
+		for (int i = 0; i < 3; i++)
+			m[i] = glm::vec4(r[i] * scale[i], 0.0f);
+		m[3] = glm::vec4(translation, 1.0f);
+		return m;
+	}
+
+	// the jointMatrix of all four lanes of a group at once
+	inline void groupMatrices(const JointGroup &group, glm::mat4 *out)
+	{
+#ifdef ANIMATION_USE_SSE
+		const float(*r)[4] = group.rows;
+		__m128 x = _mm_load_ps(r[JOINT_ROTATION]), y = _mm_load_ps(r[JOINT_ROTATION + 1]);
+		__m128 z = _mm_load_ps(r[JOINT_ROTATION + 2]), w = _mm_load_ps(r[JOINT_ROTATION + 3]);
+		__m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+		__m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+		__m128 sx = _mm_load_ps(r[JOINT_SCALE]), sy = _mm_load_ps(r[JOINT_SCALE + 1]), sz = _mm_load_ps(r[JOINT_SCALE + 2]);
+		// columns of rotation * scale, one lane per joint
+		__m128 columns[4][4] = {
+				{_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_add_ps(xy, wz), sx), _mm_mul_ps(_mm_sub_ps(xz, wy), sx), _mm_setzero_ps()},
+				{_mm_mul_ps(_mm_sub_ps(xy, wz), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy), _mm_mul_ps(_mm_add_ps(yz, wx), sy), _mm_setzero_ps()},
+				{_mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_mul_ps(_mm_sub_ps(yz, wx), sz), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), _mm_setzero_ps()},
+				{_mm_load_ps(r[JOINT_TRANSLATION]), _mm_load_ps(r[JOINT_TRANSLATION + 1]), _mm_load_ps(r[JOINT_TRANSLATION + 2]), one}};
+		for (int c = 0; c < 4; c++)
+		{
+			// lanes to matrices
+			_MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+			for (int lane = 0; lane < 4; lane++)
+				_mm_storeu_ps(&out[lane][c][0], columns[c][lane]);
+		}
+#else
+		for (int lane = 0; lane < 4; lane++)
+			out[lane] = jointMatrix(&group, lane);
+#endif
+	}
+
+	// splits an affine matrix without shear into translation, rotation and scale
+	inline void decompose(const glm::mat4 &m, glm::vec3 &translation, glm::quat &rotation, glm::vec3 &scale)
+	{
+		translation = glm::vec3(m[3]);
+		glm::mat3 r(m);
+		for (int i = 0; i < 3; i++)
+			scale[i] = glm::length(r[i]);
+		if (glm::determinant(r) < 0.0f)
+			scale.x = -scale.x;
+		for (int i = 0; i < 3; i++)
+			if (scale[i] != 0.0f)
+				r[i] /= scale[i];
+		rotation = glm::normalize(glm::quat_cast(r));
+	}
+
+	// out = a + (b - a) * weight per joint, rotations by nlerp along the shorter arc. out may be a or b.
+	inline void blendGroups(const JointGroup *a, const JointGroup *b, float weight, JointGroup *out, size_t count)
+	{
+#ifdef ANIMATION_USE_SSE
+		const __m128 w = _mm_set1_ps(weight);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		for (size_t g = 0; g < count; g++)
+		{
+			const float(*ra)[4] = a[g].rows;
+			const float(*rb)[4] = b[g].rows;
+			float(*ro)[4] = out[g].rows;
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 ta = _mm_load_ps(ra[JOINT_TRANSLATION + i]), sa = _mm_load_ps(ra[JOINT_SCALE + i]);
+				__m128 tb = _mm_load_ps(rb[JOINT_TRANSLATION + i]), sb = _mm_load_ps(rb[JOINT_SCALE + i]);
+				_mm_store_ps(ro[JOINT_TRANSLATION + i], _mm_add_ps(ta, _mm_mul_ps(_mm_sub_ps(tb, ta), w)));
+				_mm_store_ps(ro[JOINT_SCALE + i], _mm_add_ps(sa, _mm_mul_ps(_mm_sub_ps(sb, sa), w)));
+			}
+			__m128 qa[4], qb[4];
+			__m128 dot = _mm_setzero_ps();
+			for (int i = 0; i < 4; i++)
+			{
+				qa[i] = _mm_load_ps(ra[JOINT_ROTATION + i]);
+				qb[i] = _mm_load_ps(rb[JOINT_ROTATION + i]);
+				dot = _mm_add_ps(dot, _mm_mul_ps(qa[i], qb[i]));
+			}
+			// q and -q are the same rotation: flip b where it points away from a
+			__m128 flip = _mm_and_ps(dot, signBit);
+			__m128 length = _mm_setzero_ps();
+			for (int i = 0; i < 4; i++)
+			{
+				__m128 target = _mm_xor_ps(qb[i], flip);
+				qa[i] = _mm_add_ps(qa[i], _mm_mul_ps(_mm_sub_ps(target, qa[i]), w));
+				length = _mm_add_ps(length, _mm_mul_ps(qa[i], qa[i]));
+			}
+			__m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length));
+			for (int i = 0; i < 4; i++)
+				_mm_store_ps(ro[JOINT_ROTATION + i], _mm_mul_ps(qa[i], scale));
+		}
+#else
+		for (size_t g = 0; g < count; g++)
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const JointGroup &ga = a[g], &gb = b[g];
+				JointGroup &go = out[g];
+				for (int i = 0; i < 3; i++)
+				{
+					int t = JOINT_TRANSLATION + i, s = JOINT_SCALE + i;
+					go.rows[t][lane] = ga.rows[t][lane] + (gb.rows[t][lane] - ga.rows[t][lane]) * weight;
+					go.rows[s][lane] = ga.rows[s][lane] + (gb.rows[s][lane] - ga.rows[s][lane]) * weight;
+				}
+				float dot = 0.0f;
+				for (int i = JOINT_ROTATION; i < JOINT_ROTATION + 4; i++)
+					dot += ga.rows[i][lane] * gb.rows[i][lane];
+				float sign = dot < 0.0f ? -1.0f : 1.0f;
+				float q[4], length = 0.0f;
+				for (int i = 0; i < 4; i++)
+				{
+					float qa = ga.rows[JOINT_ROTATION + i][lane];
+					q[i] = qa + (gb.rows[JOINT_ROTATION + i][lane] * sign - qa) * weight;
+					length += q[i] * q[i];
+				}
+				float scale = 1.0f / std::sqrt(length);
+				for (int i = 0; i < 4; i++)
+					go.rows[JOINT_ROTATION + i][lane] = q[i] * scale;
+			}
+#endif
+	}
+
+	// index of the last key at or before time, 0 before the first key
+	inline size_t keyBefore(const vector<float> &times, float time)
+	{
+		size_t after = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+		return after > 0 ? after - 1 : 0;
+	}
+
+	inline glm::vec3 sampleKeys(const vector<float> &times, const vector<glm::vec3> &values, float time)
+	{
+		size_t i = keyBefore(times, time);
+		if (i + 1 >= values.size() || times[i + 1] <= times[i])
+			return values[i];
+		float alpha = glm::clamp((time - times[i]) / (times[i + 1] - times[i]), 0.0f, 1.0f);
+		return glm::mix(values[i], values[i + 1], alpha);
+	}
+
+	inline glm::quat sampleKeys(const vector<float> &times, const vector<glm::quat> &values, float time)
+	{
+		size_t i = keyBefore(times, time);
+		if (i + 1 >= values.size() || times[i + 1] <= times[i])
+			return values[i];
+		float alpha = glm::clamp((time - times[i]) / (times[i + 1] - times[i]), 0.0f, 1.0f);
+		return glm::normalize(glm::slerp(values[i], values[i + 1], alpha));
+	}
+}
+
+// Joints are the nodes of a SceneGraph in its breadth first order, so a parent is always evaluated before its children.
+// Bones are the joints meshes are skinned to: palette entry b is model(boneJoint[b]) * inverseBind[b].
+class Skeleton
+{
+public:
+	vector<int> parent;
+	vector<string> name;
+	vector<JointGroup> bindPose; // local transforms of the scene graph nodes
+	vector<string> boneName;
+	vector<int> boneJoint;
+	vector<glm::mat4> inverseBind; // mesh space to bone space, Assimp's offset matrix
+	glm::mat4 rootInverse = glm::mat4(1.0f); // keeps the palettes relative to the model, like the unskinned meshes
+
+	size_t jointCount() const
+	{
+		return parent.size();
+	}
+
+	size_t groupCount() const
+	{
+		return (parent.size() + 3) / 4;
+	}
+
+	unsigned int boneCount() const
+	{
+		return (unsigned int)boneJoint.size();
+	}
+
+	bool empty() const
+	{
+		return boneJoint.empty();
+	}
+
+	// palette index of the bone with that name, added on first use; the joints are resolved later by resolveBones()
+	unsigned int addBone(const string &jointName, const glm::mat4 &offset)
+	{
+		for (unsigned int i = 0; i < boneName.size(); i++)
+			if (boneName[i] == jointName)
+				return i;
+		if (boneName.size() >= MAX_SKIN_BONES)
+		{
+			cout << "ERROR::SKELETON:: more than " << MAX_SKIN_BONES << " bones, " << jointName << " is skinned to bone 0" << endl;
+			return 0;
+		}
+		boneName.push_back(jointName);
+		inverseBind.push_back(offset);
+		return (unsigned int)boneName.size() - 1;
+	}
+
+	// takes the joints and their bind pose from the graph and looks up the joint of every bone; false if one is missing
+	bool setJoints(const SceneGraph &graph)
+	{
+		parent = graph.parent;
+		name = graph.name;
+		bindPose.assign(groupCount(), anim::identityGroup());
+		for (unsigned int j = 0; j < graph.size(); j++)
+		{
+			glm::vec3 translation, scale;
+			glm::quat rotation;
+			anim::decompose(graph.local[j], translation, rotation, scale);
+			anim::setJoint(bindPose.data(), j, translation, rotation, scale);
+		}
+		rootInverse = graph.size() ? glm::inverse(graph.local[0]) : glm::mat4(1.0f);
+
+		bool complete = true;
+		boneJoint.assign(boneName.size(), 0);
+		for (unsigned int b = 0; b < boneName.size(); b++)
+		{
+			boneJoint[b] = graph.find(boneName[b]);
+			if (boneJoint[b] < 0)
+			{
+				cout << "ERROR::SKELETON:: no node for bone " << boneName[b] << endl;
+				boneJoint[b] = 0;
+				complete = false;
+			}
+		}
+		return complete;
+	}
+};
+
+// keys of one joint as the importer delivers them, times in seconds; an empty channel keeps the bind pose
+struct JointKeys
+{
+	int joint = -1;
+	vector<float> positionTimes;
+	vector<glm::vec3> positions;
+	vector<float> rotationTimes;
+	vector<glm::quat> rotations;
+	vector<float> scaleTimes;
+	vector<glm::vec3> scales;
+};
+
+// A clip resampled at a fixed rate into whole poses: frame f holds every joint at f / sampleRate seconds, the bind pose
+// for joints the clip does not move. Sampling is two frame lookups and one blendGroups over the skeleton.
+class AnimationClip
+{
+public:
+	string name;
+	float duration = 0.0f; // seconds
+	float sampleRate = 30.0f;
+	unsigned int frameCount = 0;
+	size_t groupCount = 0;
+	vector<JointGroup> frames; // frameCount * groupCount
+
+	void build(const Skeleton &skeleton, const string &clipName, float clipDuration, const vector<JointKeys> &tracks, float rate = 30.0f)
+	{
+		name = clipName;
+		duration = std::max(clipDuration, 0.0f);
+		sampleRate = rate;
+		frameCount = (unsigned int)std::ceil(duration * rate) + 1;
+		groupCount = skeleton.groupCount();
+		frames.resize((size_t)frameCount * groupCount);
+		for (unsigned int f = 0; f < frameCount; f++)
+			std::copy(skeleton.bindPose.begin(), skeleton.bindPose.end(), frames.begin() + (size_t)f * groupCount);
+
+		parallelFor(frameCount, 16, [&](size_t begin, size_t end) {
+			for (size_t f = begin; f < end; f++)
+			{
+				float time = std::min(f / rate, duration);
+				JointGroup *pose = &frames[f * groupCount];
+				for (unsigned int t = 0; t < tracks.size(); t++)
+				{
+					const JointKeys &keys = tracks[t];
+					if (keys.joint < 0 || (size_t)keys.joint >= skeleton.jointCount())
+						continue;
+					glm::vec3 translation, scale;
+					glm::quat rotation;
+					anim::getJoint(skeleton.bindPose.data(), keys.joint, translation, rotation, scale);
+					if (!keys.positions.empty())
+						translation = anim::sampleKeys(keys.positionTimes, keys.positions, time);
+					if (!keys.rotations.empty())
+						rotation = anim::sampleKeys(keys.rotationTimes, keys.rotations, time);
+					if (!keys.scales.empty())
+						scale = anim::sampleKeys(keys.scaleTimes, keys.scales, time);
+					anim::setJoint(pose, keys.joint, translation, rotation, scale);
+				}
+			}
+		});
+	}
+
+	// pose at time seconds into pose[groupCount]; loop wraps around, otherwise the ends hold
+	void sample(float time, bool loop, JointGroup *pose) const
+	{
+		if (loop && duration > 0.0f)
+		{
+			time = std::fmod(time, duration);
+			if (time < 0.0f)
+				time += duration;
+		}
+		float frame = glm::clamp(time, 0.0f, duration) * sampleRate;
+		unsigned int first = std::min((unsigned int)frame, frameCount - 1);
+		unsigned int second = std::min(first + 1, frameCount - 1);
+		anim::blendGroups(&frames[(size_t)first * groupCount], &frames[(size_t)second * groupCount], frame - first, pose, groupCount);
+	}
+};
+
+// what one character plays: clip at time, cross-faded towards blendClip at blendTime by blendWeight.
+// A clip of -1 holds the bind pose.
+struct AnimationState
+{
+	int clip = 0;
+	float time = 0.0f;
+	int blendClip = -1;
+	float blendTime = 0.0f;
+	float blendWeight = 0.0f;
+	bool loop = true;
+};
+
+// Per character: sample and blend the clips, walk the joints from the root down, and write the 3x4 row major matrix of
+// every bone to palettes + i * boneCount * PALETTE_FLOATS_PER_BONE. The characters are independent, so the batch is
+// split over the thread pool; each chunk keeps its own scratch pose.
+inline void evaluatePalettes(const Skeleton &skeleton, const vector<AnimationClip> &clips, const AnimationState *states, size_t count, float *palettes)
+{
+	size_t groups = skeleton.groupCount(), joints = skeleton.jointCount();
+	unsigned int bones = skeleton.boneCount();
+	auto playable = [&](int clip) { return clip >= 0 && clip < (int)clips.size() && clips[clip].groupCount == groups && clips[clip].frameCount > 0; };
+
+	parallelFor(count, 8, [&](size_t begin, size_t end) {
+		vector<JointGroup> pose(groups), blend(groups);
+		vector<glm::mat4> model(joints);
+		glm::mat4 local[4];
+		for (size_t c = begin; c < end; c++)
+		{
+			const AnimationState &state = states[c];
+			const JointGroup *groupPose = skeleton.bindPose.data();
+			if (playable(state.clip))
+			{
+				clips[state.clip].sample(state.time, state.loop, pose.data());
+				if (state.blendWeight > 0.0f && playable(state.blendClip))
+				{
+					clips[state.blendClip].sample(state.blendTime, state.loop, blend.data());
+					anim::blendGroups(pose.data(), blend.data(), std::min(state.blendWeight, 1.0f), pose.data(), groups);
+				}
+				groupPose = pose.data();
+			}
+
+			for (size_t j = 0; j < joints; j++)
+			{
+				if (j % 4 == 0)
+					anim::groupMatrices(groupPose[j / 4], local);
+				multiplyMatrix(skeleton.parent[j] < 0 ? skeleton.rootInverse : model[skeleton.parent[j]], local[j % 4], model[j]);
+			}
+
+			float *out = palettes + c * bones * PALETTE_FLOATS_PER_BONE;
+			for (unsigned int b = 0; b < bones; b++, out += PALETTE_FLOATS_PER_BONE)
+			{
+				glm::mat4 skin;
+				multiplyMatrix(model[skeleton.boneJoint[b]], skeleton.inverseBind[b], skin);
+				for (int row = 0; row < 3; row++)
+					for (int column = 0; column < 4; column++)
+						out[row * 4 + column] = skin[column][row];
+			}
+		}
+	});
+}
+
+// Bone palettes of a batch of characters in one texture buffer, three RGBA32F texels per bone. The vertex shader reads
+// entry gl_InstanceID * boneCount + bone, so all characters of a model are one instanced draw (Model::DrawSkinned).
+// update() evaluates the poses straight into the mapped buffer.
+class SkinningPalette
+{
+public:
+	unsigned int buffer = 0;
+	unsigned int texture = 0;
+	unsigned int boneCount = 0;
+	unsigned int count = 0; // characters written by the last update
+	size_t capacity = 0;		// floats the storage can hold
+
+	SkinningPalette()
+	{
+		glGenBuffers(1, &buffer);
+		glGenTextures(1, &texture);
+	}
+
+	void update(const Skeleton &skeleton, const vector<AnimationClip> &clips, const vector<AnimationState> &states)
+	{
+		boneCount = skeleton.boneCount();
+		count = (unsigned int)states.size();
+		size_t floats = (size_t)count * boneCount * PALETTE_FLOATS_PER_BONE;
+		if (floats == 0)
+			return;
+
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		if (floats > capacity)
+		{
+			capacity = std::max(floats, capacity * 2);
+			GLint maxTexels = 0;
+			glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+			if (capacity / 4 > (size_t)maxTexels)
+				cout << "ERROR::SKINNING:: " << capacity / 4 << " palette texels exceed GL_MAX_TEXTURE_BUFFER_SIZE (" << maxTexels << ")" << endl;
+			glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(float), NULL, GL_STREAM_DRAW);
+			glBindTexture(GL_TEXTURE_BUFFER, texture);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+		}
+		// the old contents are invalidated, so the driver never waits for the frame still reading them
+		float *target = (float *)glMapBufferRange(GL_TEXTURE_BUFFER, 0, floats * sizeof(float), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (target)
+		{
+			evaluatePalettes(skeleton, clips, states.data(), states.size(), target);
+			glUnmapBuffer(GL_TEXTURE_BUFFER);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	// binds the palette to PALETTE_TEXTURE_UNIT and sets "bonePalette" and "boneCount"
+	void bind(Shader &shader) const
+	{
+		glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setInt("bonePalette", PALETTE_TEXTURE_UNIT);
+		shader.setInt("boneCount", (int)boneCount);
+	}
+
+	void dispose()
+	{
+		glDeleteTextures(1, &texture);
+		glDeleteBuffers(1, &buffer);
+		texture = buffer = 0;
+		capacity = count = 0;
+	}
+};
+
+#endif
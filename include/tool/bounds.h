@@ -0,0 +1,128 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <geometry/Vertex.h>
+
+#include <vector>
+
+using namespace std;
+
+// axis aligned bounding box
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+
+	glm::vec3 center() const
+	{
+		return (min + max) * 0.5f;
+	}
+
+	glm::vec3 extent() const
+	{
+		return (max - min) * 0.5f;
+	}
+
+	void merge(const BoundingBox &other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	// box around the transformed box (Arvo's method)
+	BoundingBox transform(const glm::mat4 &matrix) const
+	{
+		glm::vec3 c = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+		glm::vec3 e = extent();
+		glm::vec3 worldExtent = glm::abs(glm::vec3(matrix[0])) * e.x + glm::abs(glm::vec3(matrix[1])) * e.y + glm::abs(glm::vec3(matrix[2])) * e.z;
+		return {c - worldExtent, c + worldExtent};
+	}
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	BoundingSphere transform(const glm::mat4 &matrix) const
+	{
+		float scale = glm::sqrt(glm::max(glm::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+																							glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))),
+																		 glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+		return {glm::vec3(matrix * glm::vec4(center, 1.0f)), radius * scale};
+	}
+};
+
+// box plus a sphere centred on the box; the radius is the farthest vertex, not the box diagonal
+inline void computeBounds(const vector<Vertex> &vertices, BoundingBox &box, BoundingSphere &sphere)
+{
+	box = BoundingBox();
+	sphere = BoundingSphere();
+	if (vertices.empty())
+		return;
+	box.min = box.max = vertices[0].Position;
+	for (unsigned int i = 1; i < vertices.size(); i++)
+	{
+		box.min = glm::min(box.min, vertices[i].Position);
+		box.max = glm::max(box.max, vertices[i].Position);
+	}
+	sphere.center = box.center();
+	float radius2 = 0.0f;
+	for (unsigned int i = 0; i < vertices.size(); i++)
+	{
+		glm::vec3 d = vertices[i].Position - sphere.center;
+		radius2 = glm::max(radius2, glm::dot(d, d));
+	}
+	sphere.radius = glm::sqrt(radius2);
+}
+
+// six normalized planes (left, right, bottom, top, near, far), inside is dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	// Gribb & Hartmann extraction from a (projection * view) matrix
+	static Frustum fromMatrix(const glm::mat4 &m)
+	{
+		glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[0] = row3 + row0;
+		frustum.planes[1] = row3 - row0;
+		frustum.planes[2] = row3 + row1;
+		frustum.planes[3] = row3 - row1;
+		frustum.planes[4] = row3 + row2;
+		frustum.planes[5] = row3 - row2;
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+
+	bool intersects(const BoundingSphere &sphere) const
+	{
+		for (int i = 0; i < 6; i++)
+			if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius)
+				return false;
+		return true;
+	}
+
+	bool intersects(const BoundingBox &box) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			// the corner farthest along the plane normal
+			glm::vec3 n = glm::vec3(planes[i]);
+			glm::vec3 p = glm::vec3(n.x >= 0.0f ? box.max.x : box.min.x, n.y >= 0.0f ? box.max.y : box.min.y, n.z >= 0.0f ? box.max.z : box.min.z);
+			if (glm::dot(n, p) + planes[i].w < 0.0f)
+				return false;
+		}
+		return true;
+	}
+};
+
+#endif
@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <tool/bounds.h>
+
 #include <vector>
 
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
@@ -66,6 +68,12 @@ public:
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	// returns the world space view frustum for the given projection matrix
+	Frustum GetFrustum(const glm::mat4 &projection)
+	{
+		return Frustum::fromMatrix(projection * GetViewMatrix());
+	}
+
 	// processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
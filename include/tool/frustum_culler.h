@@ -0,0 +1,161 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <tool/bounds.h>
+#include <tool/thread_pool.h>
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_USE_SSE 1
+#endif
+
+using namespace std;
+
+// Culls many world-space bounds per call. Bounds are stored structure-of-arrays so four of them are tested per SSE instruction;
+// each entry is rejected if its sphere or its box lies fully behind one of the six planes.
+// Entries keep the index they were added with; cull() returns the indices of the visible ones in ascending order.
+class FrustumCuller
+{
+public:
+	// objects per worker job; below this the whole list is tested on the calling thread
+	static const size_t MIN_OBJECTS_PER_JOB = 8192;
+
+	unsigned int size() const
+	{
+		return (unsigned int)radius.size();
+	}
+
+	void clear()
+	{
+		centerX.clear(), centerY.clear(), centerZ.clear(), radius.clear();
+		minX.clear(), minY.clear(), minZ.clear();
+		maxX.clear(), maxY.clear(), maxZ.clear();
+	}
+
+	void reserve(unsigned int count)
+	{
+		centerX.reserve(count), centerY.reserve(count), centerZ.reserve(count), radius.reserve(count);
+		minX.reserve(count), minY.reserve(count), minZ.reserve(count);
+		maxX.reserve(count), maxY.reserve(count), maxZ.reserve(count);
+	}
+
+	unsigned int add(const BoundingBox &box, const BoundingSphere &sphere)
+	{
+		centerX.push_back(sphere.center.x);
+		centerY.push_back(sphere.center.y);
+		centerZ.push_back(sphere.center.z);
+		radius.push_back(sphere.radius);
+		minX.push_back(box.min.x);
+		minY.push_back(box.min.y);
+		minZ.push_back(box.min.z);
+		maxX.push_back(box.max.x);
+		maxY.push_back(box.max.y);
+		maxZ.push_back(box.max.z);
+		return size() - 1;
+	}
+
+	// object-space bounds moved into world space
+	unsigned int add(const BoundingBox &box, const BoundingSphere &sphere, const glm::mat4 &model)
+	{
+		return add(box.transform(model), sphere.transform(model));
+	}
+
+	void update(unsigned int index, const BoundingBox &box, const BoundingSphere &sphere)
+	{
+		centerX[index] = sphere.center.x;
+		centerY[index] = sphere.center.y;
+		centerZ[index] = sphere.center.z;
+		radius[index] = sphere.radius;
+		minX[index] = box.min.x;
+		minY[index] = box.min.y;
+		minZ[index] = box.min.z;
+		maxX[index] = box.max.x;
+		maxY[index] = box.max.y;
+		maxZ[index] = box.max.z;
+	}
+
+	void cull(const Frustum &frustum, vector<unsigned int> &visible)
+	{
+		size_t count = radius.size();
+		mask.resize(count);
+		parallelFor(count, MIN_OBJECTS_PER_JOB, [&](size_t begin, size_t end) { testRange(frustum, begin, end); });
+
+		visible.clear();
+		for (size_t i = 0; i < count; i++)
+			if (mask[i])
+				visible.push_back((unsigned int)i);
+	}
+
+private:
+	vector<float> centerX, centerY, centerZ, radius;
+	vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	vector<unsigned char> mask;
+
+	bool testScalar(const Frustum &frustum, size_t i) const
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4 &plane = frustum.planes[p];
+			if (plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w < -radius[i])
+				return false;
+			float px = plane.x >= 0.0f ? maxX[i] : minX[i];
+			float py = plane.y >= 0.0f ? maxY[i] : minY[i];
+			float pz = plane.z >= 0.0f ? maxZ[i] : minZ[i];
+			if (plane.x * px + plane.y * py + plane.z * pz + plane.w < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	void testRange(const Frustum &frustum, size_t begin, size_t end)
+	{
+		size_t i = begin;
+#ifdef FRUSTUM_CULLER_USE_SSE
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 cx = _mm_loadu_ps(&centerX[i]);
+			__m128 cy = _mm_loadu_ps(&centerY[i]);
+			__m128 cz = _mm_loadu_ps(&centerZ[i]);
+			__m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (int p = 0; p < 6; p++)
+			{
+				const glm::vec4 &plane = frustum.planes[p];
+				__m128 nx = _mm_set1_ps(plane.x);
+				__m128 ny = _mm_set1_ps(plane.y);
+				__m128 nz = _mm_set1_ps(plane.z);
+				__m128 d = _mm_set1_ps(plane.w);
+
+				// sphere
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), d));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+
+				// box: the positive vertex is picked per plane, so the select is a scalar branch shared by the four lanes
+				__m128 px = _mm_loadu_ps(plane.x >= 0.0f ? &maxX[i] : &minX[i]);
+				__m128 py = _mm_loadu_ps(plane.y >= 0.0f ? &maxY[i] : &minY[i]);
+				__m128 pz = _mm_loadu_ps(plane.z >= 0.0f ? &maxZ[i] : &minZ[i]);
+				__m128 boxDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, px), _mm_mul_ps(ny, py)), _mm_add_ps(_mm_mul_ps(nz, pz), d));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(boxDist, _mm_setzero_ps()));
+
+				if (_mm_movemask_ps(inside) == 0)
+					break;
+			}
+
+			int bits = _mm_movemask_ps(inside);
+			mask[i] = bits & 1;
+			mask[i + 1] = (bits >> 1) & 1;
+			mask[i + 2] = (bits >> 2) & 1;
+			mask[i + 3] = (bits >> 3) & 1;
+		}
+#endif
+		for (; i < end; i++)
+			mask[i] = testScalar(frustum, i);
+	}
+};
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <geometry/Vertex.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+// layout of one glMultiDrawElementsIndirect record, as defined by the GL spec
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// first-fit allocator over [0, capacity) with coalescing of freed ranges
+class RangeAllocator
+{
+public:
+	unsigned int capacity = 0;
+
+	// returns false when no free range is large enough
+	bool allocate(unsigned int size, unsigned int &offset)
+	{
+		for (unsigned int i = 0; i < freeRanges.size(); i++)
+		{
+			if (freeRanges[i].size >= size)
+			{
+				offset = freeRanges[i].offset;
+				freeRanges[i].offset += size;
+				freeRanges[i].size -= size;
+				if (freeRanges[i].size == 0)
+					freeRanges.erase(freeRanges.begin() + i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void release(unsigned int offset, unsigned int size)
+	{
+		if (size == 0)
+			return;
+		Range range = {offset, size};
+		auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), range, [](const Range &a, const Range &b) { return a.offset < b.offset; });
+		it = freeRanges.insert(it, range);
+		// merge with the following and the preceding range
+		if (it + 1 != freeRanges.end() && it->offset + it->size == (it + 1)->offset)
+		{
+			it->size += (it + 1)->size;
+			freeRanges.erase(it + 1);
+		}
+		if (it != freeRanges.begin() && (it - 1)->offset + (it - 1)->size == it->offset)
+		{
+			(it - 1)->size += it->size;
+			freeRanges.erase(it);
+		}
+	}
+
+	// extends the space; the new tail becomes free
+	void grow(unsigned int newCapacity)
+	{
+		if (newCapacity <= capacity)
+			return;
+		unsigned int oldCapacity = capacity;
+		capacity = newCapacity;
+		release(oldCapacity, newCapacity - oldCapacity);
+	}
+
+private:
+	struct Range
+	{
+		unsigned int offset;
+		unsigned int size;
+	};
+	vector<Range> freeRanges;
+};
+
+// where a registered geometry lives inside the arena
+struct ArenaRange
+{
+	unsigned int baseVertex;
+	unsigned int vertexCount;
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	bool live;
+};
+
+// Static batcher: many meshes share one VAO, one vertex buffer and one element buffer.
+// Geometry is baked into world space on registration, so a whole batch is drawn with one multi-draw call
+// (glMultiDrawElementsIndirect on GL 4.3, glMultiDrawElementsBaseVertex otherwise) and a single VAO bind.
+// Everything drawn in one call shares the shader state, so register meshes that use the same material into the same arena.
+class GeometryArena
+{
+public:
+	unsigned int VAO = 0;
+	vector<ArenaRange> ranges; // indexed by the handle returned from add()
+
+	// statistics of the last draw: the geometries it covered and the GL calls it made (binds, uploads and the draw)
+	unsigned int lastDrawCommands = 0;
+	unsigned int lastGLCalls = 0;
+
+	GeometryArena(unsigned int vertexCapacity = 1 << 16, unsigned int indexCapacity = 1 << 18)
+	{
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+		glGenBuffers(1, &IBO);
+
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+		setupAttributes();
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		vertexSpace.grow(vertexCapacity);
+		indexSpace.grow(indexCapacity);
+	}
+
+	// copies the geometry into the arena, transformed by 'transform'; returns the handle used by draw() and remove()
+	unsigned int add(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const glm::mat4 &transform = glm::mat4(1.0f))
+	{
+		ArenaRange range;
+		range.vertexCount = (unsigned int)vertices.size();
+		range.indexCount = (unsigned int)indices.size();
+		range.live = true;
+
+		while (!vertexSpace.allocate(range.vertexCount, range.baseVertex))
+			growVertices(std::max(vertexSpace.capacity * 2, vertexSpace.capacity + range.vertexCount));
+		while (!indexSpace.allocate(range.indexCount, range.firstIndex))
+			growIndices(std::max(indexSpace.capacity * 2, indexSpace.capacity + range.indexCount));
+
+		// bake the transform
+		vector<Vertex> baked(vertices);
+		glm::mat3 linear = glm::mat3(transform);
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+		for (unsigned int i = 0; i < baked.size(); i++)
+		{
+			baked[i].Position = glm::vec3(transform * glm::vec4(baked[i].Position, 1.0f));
+			baked[i].Normal = normalMatrix * baked[i].Normal;
+			baked[i].Tangent = linear * baked[i].Tangent;
+			baked[i].Bitangent = linear * baked[i].Bitangent;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)range.baseVertex * sizeof(Vertex), (GLsizeiptr)baked.size() * sizeof(Vertex), baked.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		// indices stay relative to the geometry, the draw adds baseVertex
+		glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)range.firstIndex * sizeof(unsigned int), (GLsizeiptr)indices.size() * sizeof(unsigned int), indices.data());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		// reuse a dead handle slot if there is one
+		for (unsigned int i = 0; i < ranges.size(); i++)
+		{
+			if (!ranges[i].live)
+			{
+				ranges[i] = range;
+				return i;
+			}
+		}
+		ranges.push_back(range);
+		return (unsigned int)ranges.size() - 1;
+	}
+
+	void remove(unsigned int handle)
+	{
+		if (handle >= ranges.size() || !ranges[handle].live)
+			return;
+		ArenaRange &range = ranges[handle];
+		vertexSpace.release(range.baseVertex, range.vertexCount);
+		indexSpace.release(range.firstIndex, range.indexCount);
+		range.live = false;
+	}
+
+	// draws the given handles with one VAO bind and one multi-draw call
+	void draw(const vector<unsigned int> &handles)
+	{
+		commands.clear();
+		for (unsigned int i = 0; i < handles.size(); i++)
+		{
+			if (handles[i] >= ranges.size() || !ranges[handles[i]].live)
+				continue;
+			const ArenaRange &range = ranges[handles[i]];
+			commands.push_back({range.indexCount, 1, range.firstIndex, (GLint)range.baseVertex, 0});
+		}
+		submit();
+	}
+
+	void drawAll()
+	{
+		commands.clear();
+		for (unsigned int i = 0; i < ranges.size(); i++)
+		{
+			if (ranges[i].live)
+				commands.push_back({ranges[i].indexCount, 1, ranges[i].firstIndex, (GLint)ranges[i].baseVertex, 0});
+		}
+		submit();
+	}
+
+	void dispose()
+	{
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		glDeleteBuffers(1, &IBO);
+	}
+
+private:
+	unsigned int VBO, EBO, IBO;
+	unsigned int indirectCapacity = 0;
+	RangeAllocator vertexSpace;
+	RangeAllocator indexSpace;
+	vector<DrawElementsIndirectCommand> commands;
+	// scratch arrays for the glMultiDrawElementsBaseVertex path
+	vector<GLsizei> counts;
+	vector<void *> offsets;
+	vector<GLint> baseVertices;
+
+	void setupAttributes()
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
+	}
+
+	// reallocates a buffer and copies the old contents on the GPU
+	static void growBuffer(unsigned int &buffer, GLsizeiptr oldSize, GLsizeiptr newSize)
+	{
+		unsigned int grown;
+		glGenBuffers(1, &grown);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+		glBufferData(GL_COPY_WRITE_BUFFER, newSize, NULL, GL_STATIC_DRAW);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+		buffer = grown;
+	}
+
+	void growVertices(unsigned int capacity)
+	{
+		growBuffer(VBO, (GLsizeiptr)vertexSpace.capacity * sizeof(Vertex), (GLsizeiptr)capacity * sizeof(Vertex));
+		vertexSpace.grow(capacity);
+		glBindVertexArray(VAO);
+		setupAttributes();
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void growIndices(unsigned int capacity)
+	{
+		growBuffer(EBO, (GLsizeiptr)indexSpace.capacity * sizeof(unsigned int), (GLsizeiptr)capacity * sizeof(unsigned int));
+		indexSpace.grow(capacity);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBindVertexArray(0);
+	}
+
+	void submit()
+	{
+		lastDrawCommands = (unsigned int)commands.size();
+		lastGLCalls = 0;
+		if (commands.empty())
+			return;
+
+		glBindVertexArray(VAO);
+		if (GLAD_GL_VERSION_4_3)
+		{
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, IBO);
+			GLsizeiptr size = (GLsizeiptr)commands.size() * sizeof(DrawElementsIndirectCommand);
+			if (commands.size() > indirectCapacity)
+			{
+				indirectCapacity = (unsigned int)commands.size() * 2;
+				glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)indirectCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+				lastGLCalls++;
+			}
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, commands.data());
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)commands.size(), 0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			lastGLCalls += 4;
+		}
+		else
+		{
+			counts.resize(commands.size());
+			offsets.resize(commands.size());
+			baseVertices.resize(commands.size());
+			for (unsigned int i = 0; i < commands.size(); i++)
+			{
+				counts[i] = commands[i].count;
+				offsets[i] = (void *)((size_t)commands[i].firstIndex * sizeof(unsigned int));
+				baseVertices[i] = commands[i].baseVertex;
+			}
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), (GLsizei)commands.size(), baseVertices.data());
+			lastGLCalls++;
+		}
+		glBindVertexArray(0);
+		lastGLCalls += 2; // the VAO bind and unbind
+	}
+};
+
+#endif
@@ -0,0 +1,572 @@
+#ifndef GLTF_MODEL_H
+#define GLTF_MODEL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <tool/json.h>
+#include <tool/mapped_file.h>
+#include <tool/mesh.h>
+#include <tool/scene_graph.h>
+#include <tool/instance_buffer.h>
+#include <tool/bounds.h>
+#include <tool/texture_cache.h>
+#include <tool/thread_pool.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Binary glTF 2.0 (.glb) without the Assimp detour. The file is mapped and every bufferView that a mesh accessor
+// references goes from the mapping to glBufferData as is; each primitive's VAO points glVertexAttribPointer at it with
+// the accessor's component type, normalisation, byteStride and byteOffset, so vertices are never repacked into Vertex.
+// Attribute locations follow Vertex: POSITION 0, NORMAL 1, TEXCOORD_0 2, TANGENT 3 (vec4, w is the handedness);
+// missing attributes keep the GL default value.
+// Images are decoded and mip filtered on the thread pool while the geometry uploads; embedded ones are shared through
+// TextureCache as "<file>#<image>". Materials map onto the Texture types of Mesh: baseColorTexture -> texture_diffuse,
+// metallicRoughnessTexture -> texture_specular, normalTexture -> texture_normal.
+// Nodes become a SceneGraph; a mesh placed by several nodes is drawn with one instanced call (see Model::drawMesh).
+// Not supported: external or data: URI buffers, sparse accessors, skins and morph targets.
+
+struct GltfPrimitive
+{
+	unsigned int VAO = 0;
+	GLenum mode = GL_TRIANGLES;
+	GLsizei count = 0;				// indices, or vertices when indexType is 0
+	GLenum indexType = 0;		// 0 draws with glDrawArrays
+	size_t indexOffset = 0; // bytes into the element buffer
+	int material = -1;
+	BoundingBox boundingBox; // POSITION min / max
+};
+
+struct GltfMesh
+{
+	string name;
+	vector<GltfPrimitive> primitives;
+	vector<int> sceneNodes; // nodes that place the mesh; none leaves it undrawn
+	BoundingBox boundingBox;
+};
+
+class GltfModel
+{
+public:
+	vector<GltfMesh> meshes;
+	vector<vector<Texture>> materials; // per glTF material: base color, metallic-roughness, normal (those present)
+	SceneGraph sceneGraph;						 // move nodes with sceneGraph.setLocal
+	BoundingBox boundingBox;					 // every mesh placement, object space
+	BoundingSphere boundingSphere;
+	bool gammaCorrection; // base color textures are sRGB
+	bool loaded = false;
+
+	GltfModel(const string &path, bool gamma = false) : gammaCorrection(gamma)
+	{
+		loaded = load(path);
+	}
+
+	// recomputes the nodes moved since the last call, the bounds and the instance matrices of shared meshes
+	void updateScene()
+	{
+		if (!sceneGraph.needsUpdate())
+			return;
+		sceneGraph.update();
+		mergeBounds();
+		vector<InstanceData> instances;
+		for (auto it = nodeInstances.begin(); it != nodeInstances.end(); ++it)
+		{
+			const GltfMesh &mesh = meshes[it->first];
+			instances.clear();
+			for (unsigned int n = 0; n < mesh.sceneNodes.size(); n++)
+				instances.push_back(makeInstance(sceneGraph.world[mesh.sceneNodes[n]]));
+			it->second.update(instances);
+		}
+	}
+
+	// sets "model" to model times the node transform; shared meshes are drawn instanced with the "instanced" switch
+	void Draw(Shader &shader, const glm::mat4 &model = glm::mat4(1.0f))
+	{
+		updateScene();
+		for (unsigned int m = 0; m < meshes.size(); m++)
+		{
+			const GltfMesh &mesh = meshes[m];
+			if (mesh.sceneNodes.empty())
+				continue;
+			bool instanced = mesh.sceneNodes.size() > 1;
+			GLsizei instanceCount = instanced ? nodeInstances[m].count : 1;
+			shader.setMat4("model", instanced ? model : model * sceneGraph.world[mesh.sceneNodes[0]]);
+			if (instanced)
+				shader.setBool("instanced", true);
+			for (unsigned int p = 0; p < mesh.primitives.size(); p++)
+			{
+				const GltfPrimitive &primitive = mesh.primitives[p];
+				if (primitive.material >= 0)
+					materialTables[primitive.material].get(shader, materials[primitive.material]).bind(shader);
+				glBindVertexArray(primitive.VAO);
+				if (primitive.indexType)
+					glDrawElementsInstanced(primitive.mode, primitive.count, primitive.indexType, (void *)primitive.indexOffset, instanceCount);
+				else
+					glDrawArraysInstanced(primitive.mode, 0, primitive.count, instanceCount);
+			}
+			glBindVertexArray(0);
+			if (instanced)
+				shader.setBool("instanced", false);
+		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void dispose()
+	{
+		for (unsigned int m = 0; m < meshes.size(); m++)
+			for (unsigned int p = 0; p < meshes[m].primitives.size(); p++)
+				glDeleteVertexArrays(1, &meshes[m].primitives[p].VAO);
+		for (unsigned int i = 0; i < buffers.size(); i++)
+			if (buffers[i])
+				glDeleteBuffers(1, &buffers[i]);
+		for (auto it = nodeInstances.begin(); it != nodeInstances.end(); ++it)
+			it->second.dispose();
+		meshes.clear();
+		materials.clear();
+		materialTables.clear();
+		buffers.clear();
+		nodeInstances.clear();
+	}
+
+private:
+	struct View
+	{
+		const unsigned char *data;
+		size_t length;
+		size_t stride; // 0 when tightly packed
+	};
+
+	struct Accessor
+	{
+		int view;
+		size_t offset;
+		GLenum componentType;
+		int components;
+		bool normalized;
+		size_t count;
+	};
+
+	struct PendingTexture
+	{
+		TextureHandle texture;
+		future<DecodedImage> image;
+	};
+
+	JsonValue gltf;
+	vector<View> views;
+	vector<unsigned int> buffers; // GL buffer per bufferView, 0 until an accessor needs it
+	size_t uploadedBytes = 0;
+	map<unsigned int, InstanceBuffer> nodeInstances; // node matrices of the meshes placed by several nodes, by mesh index
+	vector<MaterialTables> materialTables;					 // per material, see tool/material.h
+
+	static const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+	static const uint32_t CHUNK_JSON = 0x4E4F534A;
+	static const uint32_t CHUNK_BIN = 0x004E4942;
+
+	static int componentCount(const string &type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4" || type == "MAT2")
+			return 4;
+		if (type == "MAT3")
+			return 9;
+		if (type == "MAT4")
+			return 16;
+		return 0;
+	}
+
+	static size_t componentSize(GLenum componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	bool load(const string &path)
+	{
+		auto start = chrono::steady_clock::now();
+		MappedFile file;
+		if (!file.open(path))
+		{
+			cout << "ERROR::GLTF:: could not open " << path << endl;
+			return false;
+		}
+		const unsigned char *data = file.data();
+		size_t size = file.size();
+
+		// 12 byte header, then chunks of length, type and data padded to 4 bytes: JSON first, BIN optional
+		uint32_t header[3];
+		if (size < 20 || (memcpy(header, data, sizeof(header)), header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size))
+		{
+			cout << "ERROR::GLTF:: " << path << " is not a glTF 2.0 binary" << endl;
+			return false;
+		}
+		size = header[2];
+		const char *json = nullptr;
+		size_t jsonLength = 0, binLength = 0;
+		const unsigned char *bin = nullptr;
+		for (size_t offset = 12; offset + 8 <= size;)
+		{
+			uint32_t chunk[2];
+			memcpy(chunk, data + offset, sizeof(chunk));
+			offset += 8;
+			if (chunk[0] > size - offset)
+				break;
+			if (chunk[1] == CHUNK_JSON && !json)
+			{
+				json = (const char *)data + offset;
+				jsonLength = chunk[0];
+			}
+			else if (chunk[1] == CHUNK_BIN && !bin)
+			{
+				bin = data + offset;
+				binLength = chunk[0];
+			}
+			offset += (chunk[0] + 3) & ~(size_t)3;
+		}
+		string error;
+		if (!json || !parseJson(json, json + jsonLength, gltf, error))
+		{
+			cout << "ERROR::GLTF:: invalid JSON chunk in " << path << ": " << error << endl;
+			return false;
+		}
+
+		// buffer 0 is the BIN chunk
+		const JsonValue &bufferList = gltf["buffers"];
+		for (size_t i = 0; i < bufferList.size(); i++)
+			if (bufferList[i].has("uri") || i > 0)
+			{
+				cout << "ERROR::GLTF:: " << path << " references external buffers, only self-contained GLB files are supported" << endl;
+				return false;
+			}
+		const JsonValue &viewList = gltf["bufferViews"];
+		for (size_t i = 0; i < viewList.size(); i++)
+		{
+			const JsonValue &view = viewList[i];
+			size_t offset = (size_t)view["byteOffset"].asNumber(0.0), length = (size_t)view["byteLength"].asNumber(0.0);
+			if (view["buffer"].asInt() != 0 || !bin || offset > binLength || length > binLength - offset)
+			{
+				cout << "ERROR::GLTF:: buffer view " << i << " lies outside the BIN chunk of " << path << endl;
+				return false;
+			}
+			views.push_back({bin + offset, length, (size_t)view["byteStride"].asNumber(0.0)});
+		}
+		buffers.assign(views.size(), 0);
+
+		// the image decodes run on the pool while the geometry is uploaded; the mapping outlives them
+		string directory = path.substr(0, path.find_last_of('/'));
+		vector<PendingTexture> pending = loadMaterials(path, directory);
+		loadMeshes(path);
+		buildSceneGraph();
+
+		size_t textureBytes = 0;
+		for (unsigned int i = 0; i < pending.size(); i++)
+		{
+			DecodedImage image = pending[i].image.get();
+			if (uploadImage(pending[i].texture->id, image))
+				textureBytes += image.size();
+			else
+				cout << "Texture failed to load at path: " << pending[i].texture->path << endl;
+			TextureCache::global().setUploaded(*pending[i].texture, image);
+			freeImage(image);
+		}
+
+		unsigned int primitiveCount = 0;
+		for (unsigned int m = 0; m < meshes.size(); m++)
+			primitiveCount += (unsigned int)meshes[m].primitives.size();
+		cout << "MODEL::GLTF " << path << " " << meshes.size() << " meshes, " << primitiveCount << " primitives, " << sceneGraph.size() << " nodes, "
+				 << uploadedBytes / 1024 << " KB of buffer views, " << pending.size() << " textures (" << textureBytes / 1024 << " KB) in "
+				 << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+		gltf = JsonValue();
+		views.clear();
+		return true;
+	}
+
+	// acquires the textures of every material and queues decodes for the ones not in the cache yet
+	vector<PendingTexture> loadMaterials(const string &path, const string &directory)
+	{
+		vector<PendingTexture> pending;
+		const JsonValue &materialList = gltf["materials"];
+		materials.assign(materialList.size(), vector<Texture>());
+		materialTables.assign(materialList.size(), MaterialTables());
+		for (size_t m = 0; m < materialList.size(); m++)
+		{
+			const JsonValue &material = materialList[m];
+			const JsonValue &pbr = material["pbrMetallicRoughness"];
+			const JsonValue *references[3] = {&pbr["baseColorTexture"], &pbr["metallicRoughnessTexture"], &material["normalTexture"]};
+			const char *types[3] = {"texture_diffuse", "texture_specular", "texture_normal"};
+			for (int t = 0; t < 3; t++)
+			{
+				int image = gltf["textures"][(size_t)(*references[t])["index"].asInt()]["source"].asInt();
+				const JsonValue &source = gltf["images"][(size_t)image];
+				if (references[t]->isNull() || source.isNull())
+					continue;
+
+				TextureOptions options;
+				options.srgb = gammaCorrection && t == 0;
+				options.normalMap = t == 2;
+				Texture texture;
+				texture.type = types[t];
+				bool embedded = source.has("bufferView");
+				int view = source["bufferView"].asInt();
+				const string &uri = source["uri"].asString();
+				if (embedded ? view < 0 || view >= (int)views.size() : uri.empty() || uri.compare(0, 5, "data:") == 0)
+				{
+					cout << "ERROR::GLTF:: unsupported image " << image << " in " << path << endl;
+					continue;
+				}
+				texture.path = embedded ? path + "#" + to_string(image) : uri;
+				bool created;
+				texture.handle = TextureCache::global().acquire(embedded ? texture.path : directory + '/' + uri, options, &created);
+				texture.id = texture.handle->id;
+				materials[m].push_back(texture);
+				if (!created)
+					continue;
+
+				PendingTexture decode;
+				decode.texture = texture.handle;
+				if (embedded)
+				{
+					const View bytes = views[view];
+					decode.image = ThreadPool::global().submit([bytes, options]() { return decodeEmbedded(bytes.data, bytes.length, options); });
+				}
+				else
+				{
+					string filename = texture.handle->path;
+					decode.image = ThreadPool::global().submit([filename, options]() { return TextureCache::loadImage(filename, options); });
+				}
+				pending.push_back(std::move(decode));
+			}
+		}
+		return pending;
+	}
+
+	// PNG / JPEG bytes of a buffer view; glTF puts the first image row at v = 0, so nothing is flipped
+	static DecodedImage decodeEmbedded(const unsigned char *bytes, size_t length, const TextureOptions &options)
+	{
+		DecodedImage image;
+		auto start = chrono::steady_clock::now();
+		stbi_set_flip_vertically_on_load_thread(false);
+		image.data = stbi_load_from_memory(bytes, (int)length, &image.width, &image.height, &image.components, 0);
+		if (image.data)
+			buildMipChain(image, mipOptions(options));
+		image.decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		return image;
+	}
+
+	bool accessor(int index, Accessor &result) const
+	{
+		const JsonValue &json = gltf["accessors"][(size_t)index];
+		result.view = json["bufferView"].asInt();
+		result.offset = (size_t)json["byteOffset"].asNumber(0.0);
+		result.componentType = (GLenum)json["componentType"].asInt(0);
+		result.components = componentCount(json["type"].asString());
+		result.normalized = json["normalized"].asBool();
+		result.count = (size_t)json["count"].asNumber(0.0);
+		size_t elementSize = componentSize(result.componentType) * result.components;
+		if (json.isNull() || json.has("sparse") || result.view < 0 || result.view >= (int)views.size() || elementSize == 0 || result.count == 0)
+			return false;
+		const View &view = views[result.view];
+		size_t stride = view.stride ? view.stride : elementSize;
+		return result.offset <= view.length && stride * (result.count - 1) + elementSize <= view.length - result.offset;
+	}
+
+	// binds the GL buffer of a view to target, uploading the view straight from the mapping the first time
+	void bindView(int view, GLenum target)
+	{
+		if (!buffers[view])
+		{
+			glGenBuffers(1, &buffers[view]);
+			glBindBuffer(target, buffers[view]);
+			glBufferData(target, (GLsizeiptr)views[view].length, views[view].data, GL_STATIC_DRAW);
+			uploadedBytes += views[view].length;
+			return;
+		}
+		glBindBuffer(target, buffers[view]);
+	}
+
+	void loadMeshes(const string &path)
+	{
+		static const char *attributeNames[4] = {"POSITION", "NORMAL", "TEXCOORD_0", "TANGENT"};
+		const JsonValue &meshList = gltf["meshes"];
+		meshes.assign(meshList.size(), GltfMesh());
+		for (size_t m = 0; m < meshList.size(); m++)
+		{
+			GltfMesh &mesh = meshes[m];
+			mesh.name = meshList[m]["name"].asString();
+			const JsonValue &primitives = meshList[m]["primitives"];
+			for (size_t p = 0; p < primitives.size(); p++)
+			{
+				const JsonValue &attributes = primitives[p]["attributes"];
+				Accessor position;
+				if (!accessor(attributes["POSITION"].asInt(), position) || position.components != 3)
+				{
+					cout << "ERROR::GLTF:: primitive " << p << " of mesh " << m << " in " << path << " has no usable POSITION" << endl;
+					continue;
+				}
+
+				GltfPrimitive primitive;
+				primitive.mode = (GLenum)primitives[p]["mode"].asInt(GL_TRIANGLES);
+				primitive.material = primitives[p]["material"].asInt();
+				if (primitive.material >= (int)materials.size())
+					primitive.material = -1;
+				primitive.count = (GLsizei)position.count;
+				const JsonValue &json = gltf["accessors"][(size_t)attributes["POSITION"].asInt()];
+				for (int i = 0; i < 3; i++)
+				{
+					primitive.boundingBox.min[i] = (float)json["min"][i].asNumber();
+					primitive.boundingBox.max[i] = (float)json["max"][i].asNumber();
+				}
+
+				glGenVertexArrays(1, &primitive.VAO);
+				glBindVertexArray(primitive.VAO);
+				for (unsigned int location = 0; location < 4; location++)
+				{
+					Accessor attribute;
+					if (!accessor(attributes[attributeNames[location]].asInt(), attribute))
+						continue;
+					bindView(attribute.view, GL_ARRAY_BUFFER);
+					glEnableVertexAttribArray(location);
+					glVertexAttribPointer(location, attribute.components, attribute.componentType, attribute.normalized ? GL_TRUE : GL_FALSE,
+																(GLsizei)views[attribute.view].stride, (void *)attribute.offset);
+				}
+				Accessor indices;
+				if (accessor(primitives[p]["indices"].asInt(), indices) && indices.components == 1 && indices.componentType != GL_BYTE &&
+						indices.componentType != GL_SHORT && indices.componentType != GL_FLOAT)
+				{
+					// the element buffer binding is part of the VAO
+					bindView(indices.view, GL_ELEMENT_ARRAY_BUFFER);
+					primitive.indexType = indices.componentType;
+					primitive.indexOffset = indices.offset;
+					primitive.count = (GLsizei)indices.count;
+				}
+				glBindVertexArray(0);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+				if (mesh.primitives.empty())
+					mesh.boundingBox = primitive.boundingBox;
+				else
+					mesh.boundingBox.merge(primitive.boundingBox);
+				mesh.primitives.push_back(primitive);
+			}
+		}
+	}
+
+	static glm::mat4 nodeTransform(const JsonValue &node)
+	{
+		const JsonValue &matrix = node["matrix"];
+		if (matrix.size() == 16)
+		{
+			// column major, like glm
+			glm::mat4 result;
+			for (int i = 0; i < 16; i++)
+				result[i / 4][i % 4] = (float)matrix[i].asNumber();
+			return result;
+		}
+		const JsonValue &translation = node["translation"], &rotation = node["rotation"], &scale = node["scale"];
+		glm::vec3 t(0.0f), s(1.0f);
+		glm::quat r(1.0f, 0.0f, 0.0f, 0.0f);
+		if (translation.size() == 3)
+			t = glm::vec3(translation[0].asNumber(), translation[1].asNumber(), translation[2].asNumber());
+		if (rotation.size() == 4) // glTF stores x, y, z, w
+			r = glm::quat((float)rotation[3].asNumber(), (float)rotation[0].asNumber(), (float)rotation[1].asNumber(), (float)rotation[2].asNumber());
+		if (scale.size() == 3)
+			s = glm::vec3(scale[0].asNumber(), scale[1].asNumber(), scale[2].asNumber());
+		return glm::translate(glm::mat4(1.0f), t) * glm::mat4_cast(r) * glm::scale(glm::mat4(1.0f), s);
+	}
+
+	// breadth first from the roots of the default scene (all parentless nodes when there is none)
+	void buildSceneGraph()
+	{
+		const JsonValue &nodes = gltf["nodes"];
+		vector<pair<int, int>> queue; // glTF node, scene graph parent
+		const JsonValue &scene = gltf["scenes"][(size_t)gltf["scene"].asInt(0)];
+		if (!scene.isNull())
+			for (size_t i = 0; i < scene["nodes"].size(); i++)
+				queue.push_back({scene["nodes"][i].asInt(), -1});
+		else
+		{
+			vector<unsigned char> child(nodes.size());
+			for (size_t i = 0; i < nodes.size(); i++)
+				for (size_t c = 0; c < nodes[i]["children"].size(); c++)
+					if (nodes[i]["children"][c].asInt() >= 0 && nodes[i]["children"][c].asInt() < (int)nodes.size())
+						child[nodes[i]["children"][c].asInt()] = 1;
+			for (size_t i = 0; i < nodes.size(); i++)
+				if (!child[i])
+					queue.push_back({(int)i, -1});
+		}
+
+		sceneGraph.clear();
+		vector<unsigned char> visited(nodes.size());
+		for (size_t q = 0; q < queue.size(); q++)
+		{
+			int node = queue[q].first;
+			if (node < 0 || node >= (int)nodes.size() || visited[node])
+				continue;
+			visited[node] = 1;
+			const JsonValue &json = nodes[(size_t)node];
+			int index = sceneGraph.addNode(queue[q].second, nodeTransform(json), json["name"].asString());
+			int mesh = json["mesh"].asInt();
+			if (mesh >= 0 && mesh < (int)meshes.size())
+				meshes[mesh].sceneNodes.push_back(index);
+			for (size_t c = 0; c < json["children"].size(); c++)
+				queue.push_back({json["children"][c].asInt(), index});
+		}
+
+		// one instance buffer per shared mesh, attached to all of its VAOs; updateScene fills them
+		for (unsigned int m = 0; m < meshes.size(); m++)
+			if (meshes[m].sceneNodes.size() > 1)
+				for (unsigned int p = 0; p < meshes[m].primitives.size(); p++)
+					nodeInstances[m].attach(meshes[m].primitives[p].VAO);
+		updateScene();
+	}
+
+	// union of the mesh boxes at every placement
+	void mergeBounds()
+	{
+		bool first = true;
+		for (unsigned int m = 0; m < meshes.size(); m++)
+			for (unsigned int n = 0; n < meshes[m].sceneNodes.size(); n++)
+			{
+				if (meshes[m].primitives.empty())
+					continue;
+				BoundingBox box = meshes[m].boundingBox.transform(sceneGraph.world[meshes[m].sceneNodes[n]]);
+				if (first)
+					boundingBox = box;
+				else
+					boundingBox.merge(box);
+				first = false;
+			}
+		boundingSphere.center = boundingBox.center();
+		boundingSphere.radius = glm::length(boundingBox.extent());
+	}
+};
+
+#endif
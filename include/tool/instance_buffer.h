@@ -0,0 +1,132 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// per-instance vertex attributes, after the five per-vertex ones (Position .. Bitangent)
+const unsigned int INSTANCE_ATTRIBUTE_MODEL = 5;         // 5, 6, 7, 8: mat4 columns
+const unsigned int INSTANCE_ATTRIBUTE_NORMAL_MATRIX = 9; // 9, 10, 11: mat3 columns
+const unsigned int INSTANCE_ATTRIBUTE_COLOR = 12;        // normalized RGBA8
+
+struct InstanceData
+{
+	glm::mat4 model;
+	glm::vec3 normalMatrix[3]; // transpose(inverse(mat3(model))), precomputed so the vertex shader doesn't invert per vertex
+	uint32_t color;						 // RGBA8, red in the lowest byte
+};
+
+inline uint32_t packColor(const glm::vec4 &color)
+{
+	glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+	return (uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24);
+}
+
+inline InstanceData makeInstance(const glm::mat4 &model, const glm::vec4 &color = glm::vec4(1.0f))
+{
+	InstanceData instance;
+	instance.model = model;
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+	instance.normalMatrix[0] = normalMatrix[0];
+	instance.normalMatrix[1] = normalMatrix[1];
+	instance.normalMatrix[2] = normalMatrix[2];
+	instance.color = packColor(color);
+	return instance;
+}
+
+// A GL buffer of InstanceData that can be rewritten every frame. The storage only grows (geometrically) when
+// more instances than ever before are uploaded, so the VAOs it is attached to stay valid and steady-state updates never reallocate.
+class InstanceBuffer
+{
+public:
+	unsigned int VBO = 0;
+	unsigned int count = 0;		 // instances written by the last update
+	unsigned int capacity = 0; // instances the storage can hold
+
+	InstanceBuffer(unsigned int initialCapacity = 0)
+	{
+		glGenBuffers(1, &VBO);
+		reserve(initialCapacity);
+	}
+
+	void reserve(unsigned int instances)
+	{
+		if (instances <= capacity)
+			return;
+		capacity = std::max(instances, capacity * 2);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// maps room for 'instances' entries; the previous contents are invalidated so the driver never waits on the GPU
+	InstanceData *map(unsigned int instances)
+	{
+		reserve(instances);
+		count = instances;
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		if (instances == 0)
+			return nullptr;
+		return (InstanceData *)glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)instances * sizeof(InstanceData), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+
+	void unmap()
+	{
+		if (count > 0)
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void update(const InstanceData *instances, unsigned int instanceCount)
+	{
+		InstanceData *target = map(instanceCount);
+		if (target)
+			memcpy(target, instances, (size_t)instanceCount * sizeof(InstanceData));
+		unmap();
+	}
+
+	void update(const vector<InstanceData> &instances)
+	{
+		update(instances.data(), (unsigned int)instances.size());
+	}
+
+	// adds the per-instance attributes to a VAO
+	void attach(unsigned int VAO) const
+	{
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glEnableVertexAttribArray(INSTANCE_ATTRIBUTE_MODEL + i);
+			glVertexAttribPointer(INSTANCE_ATTRIBUTE_MODEL + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+			glVertexAttribDivisor(INSTANCE_ATTRIBUTE_MODEL + i, 1);
+		}
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			glEnableVertexAttribArray(INSTANCE_ATTRIBUTE_NORMAL_MATRIX + i);
+			glVertexAttribPointer(INSTANCE_ATTRIBUTE_NORMAL_MATRIX + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec3)));
+			glVertexAttribDivisor(INSTANCE_ATTRIBUTE_NORMAL_MATRIX + i, 1);
+		}
+		glEnableVertexAttribArray(INSTANCE_ATTRIBUTE_COLOR);
+		glVertexAttribPointer(INSTANCE_ATTRIBUTE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(InstanceData), (void *)offsetof(InstanceData, color));
+		glVertexAttribDivisor(INSTANCE_ATTRIBUTE_COLOR, 1);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void dispose()
+	{
+		glDeleteBuffers(1, &VBO);
+		VBO = 0;
+		count = capacity = 0;
+	}
+};
+
+#endif
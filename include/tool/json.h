@@ -0,0 +1,369 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Small JSON DOM, enough for glTF: the whole document is parsed into JsonValues up front. Missing keys and indices
+// return a shared null value, so lookups like json["meshes"][i]["name"] never need checks in between.
+class JsonValue
+{
+public:
+	enum Type
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	Type type = JSON_NULL;
+	bool boolean = false;
+	double number = 0.0;
+	string text;
+	vector<JsonValue> items; // array elements, or object values in file order
+	vector<string> keys;		 // object keys, parallel to items
+
+	static const JsonValue &null()
+	{
+		static const JsonValue value;
+		return value;
+	}
+
+	bool isNull() const
+	{
+		return type == JSON_NULL;
+	}
+
+	size_t size() const
+	{
+		return type == JSON_ARRAY || type == JSON_OBJECT ? items.size() : 0;
+	}
+
+	bool has(const string &key) const
+	{
+		return &(*this)[key] != &null();
+	}
+
+	const JsonValue &operator[](const string &key) const
+	{
+		if (type == JSON_OBJECT)
+			for (size_t i = 0; i < keys.size(); i++)
+				if (keys[i] == key)
+					return items[i];
+		return null();
+	}
+
+	const JsonValue &operator[](size_t index) const
+	{
+		return type == JSON_ARRAY && index < items.size() ? items[index] : null();
+	}
+
+	double asNumber(double fallback = 0.0) const
+	{
+		return type == JSON_NUMBER ? number : fallback;
+	}
+
+	int asInt(int fallback = -1) const
+	{
+		return type == JSON_NUMBER ? (int)number : fallback;
+	}
+
+	bool asBool(bool fallback = false) const
+	{
+		return type == JSON_BOOL ? boolean : fallback;
+	}
+
+	const string &asString() const
+	{
+		static const string empty;
+		return type == JSON_STRING ? text : empty;
+	}
+};
+
+namespace json
+{
+	const int MAX_DEPTH = 128;
+
+	class Parser
+	{
+	public:
+		string error;
+
+		Parser(const char *begin, const char *end) : p(begin), end(end), begin(begin) {}
+
+		bool parse(JsonValue &value)
+		{
+			if (!parseValue(value, 0))
+				return false;
+			skipSpaces();
+			return p == end || fail("trailing characters");
+		}
+
+	private:
+		const char *p;
+		const char *end;
+		const char *begin;
+
+		bool fail(const char *message)
+		{
+			if (error.empty())
+				error = string(message) + " at offset " + to_string(p - begin);
+			return false;
+		}
+
+		void skipSpaces()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+				p++;
+		}
+
+		bool literal(const char *word)
+		{
+			for (const char *w = word; *w; w++, p++)
+				if (p >= end || *p != *w)
+					return fail("invalid literal");
+			return true;
+		}
+
+		bool parseValue(JsonValue &value, int depth)
+		{
+			if (depth > MAX_DEPTH)
+				return fail("nesting too deep");
+			skipSpaces();
+			if (p >= end)
+				return fail("unexpected end");
+			switch (*p)
+			{
+			case '{':
+				return parseObject(value, depth);
+			case '[':
+				return parseArray(value, depth);
+			case '"':
+				value.type = JsonValue::JSON_STRING;
+				return parseString(value.text);
+			case 't':
+				value.type = JsonValue::JSON_BOOL;
+				value.boolean = true;
+				return literal("true");
+			case 'f':
+				value.type = JsonValue::JSON_BOOL;
+				value.boolean = false;
+				return literal("false");
+			case 'n':
+				value.type = JsonValue::JSON_NULL;
+				return literal("null");
+			default:
+				return parseNumber(value);
+			}
+		}
+
+		bool parseObject(JsonValue &value, int depth)
+		{
+			value.type = JsonValue::JSON_OBJECT;
+			p++;
+			skipSpaces();
+			if (p < end && *p == '}')
+			{
+				p++;
+				return true;
+			}
+			while (true)
+			{
+				skipSpaces();
+				value.keys.push_back(string());
+				if (p >= end || *p != '"' || !parseString(value.keys.back()))
+					return fail("expected a key");
+				skipSpaces();
+				if (p >= end || *p++ != ':')
+					return fail("expected ':'");
+				value.items.push_back(JsonValue());
+				if (!parseValue(value.items.back(), depth + 1))
+					return false;
+				skipSpaces();
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				if (p < end && *p == '}')
+				{
+					p++;
+					return true;
+				}
+				return fail("expected ',' or '}'");
+			}
+		}
+
+		bool parseArray(JsonValue &value, int depth)
+		{
+			value.type = JsonValue::JSON_ARRAY;
+			p++;
+			skipSpaces();
+			if (p < end && *p == ']')
+			{
+				p++;
+				return true;
+			}
+			while (true)
+			{
+				value.items.push_back(JsonValue());
+				if (!parseValue(value.items.back(), depth + 1))
+					return false;
+				skipSpaces();
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				if (p < end && *p == ']')
+				{
+					p++;
+					return true;
+				}
+				return fail("expected ',' or ']'");
+			}
+		}
+
+		bool parseHex4(uint32_t &code)
+		{
+			code = 0;
+			for (int i = 0; i < 4; i++, p++)
+			{
+				if (p >= end)
+					return fail("bad \\u escape");
+				char c = *p;
+				code <<= 4;
+				if (c >= '0' && c <= '9')
+					code |= c - '0';
+				else if (c >= 'a' && c <= 'f')
+					code |= c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					code |= c - 'A' + 10;
+				else
+					return fail("bad \\u escape");
+			}
+			return true;
+		}
+
+		static void appendUtf8(string &out, uint32_t code)
+		{
+			if (code < 0x80)
+				out.push_back((char)code);
+			else if (code < 0x800)
+			{
+				out.push_back((char)(0xC0 | (code >> 6)));
+				out.push_back((char)(0x80 | (code & 0x3F)));
+			}
+			else if (code < 0x10000)
+			{
+				out.push_back((char)(0xE0 | (code >> 12)));
+				out.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+				out.push_back((char)(0x80 | (code & 0x3F)));
+			}
+			else
+			{
+				out.push_back((char)(0xF0 | (code >> 18)));
+				out.push_back((char)(0x80 | ((code >> 12) & 0x3F)));
+				out.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+				out.push_back((char)(0x80 | (code & 0x3F)));
+			}
+		}
+
+		bool parseString(string &out)
+		{
+			p++; // opening quote
+			while (p < end && *p != '"')
+			{
+				if (*p != '\\')
+				{
+					out.push_back(*p++);
+					continue;
+				}
+				if (++p >= end)
+					break;
+				char c = *p++;
+				switch (c)
+				{
+				case '"':
+				case '\\':
+				case '/':
+					out.push_back(c);
+					break;
+				case 'b':
+					out.push_back('\b');
+					break;
+				case 'f':
+					out.push_back('\f');
+					break;
+				case 'n':
+					out.push_back('\n');
+					break;
+				case 'r':
+					out.push_back('\r');
+					break;
+				case 't':
+					out.push_back('\t');
+					break;
+				case 'u':
+				{
+					uint32_t code;
+					if (!parseHex4(code))
+						return false;
+					// surrogate pair
+					if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+					{
+						p += 2;
+						uint32_t low;
+						if (!parseHex4(low))
+							return false;
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					appendUtf8(out, code);
+					break;
+				}
+				default:
+					return fail("bad escape");
+				}
+			}
+			if (p >= end)
+				return fail("unterminated string");
+			p++;
+			return true;
+		}
+
+		bool parseNumber(JsonValue &value)
+		{
+			// strtod needs a terminated string; JSON numbers are short
+			const char *start = p;
+			while (p < end && (*p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E' || (*p >= '0' && *p <= '9')))
+				p++;
+			string digits(start, p);
+			char *stop = nullptr;
+			value.number = strtod(digits.c_str(), &stop);
+			if (digits.empty() || stop != digits.c_str() + digits.size())
+				return fail("invalid number");
+			value.type = JsonValue::JSON_NUMBER;
+			return true;
+		}
+	};
+}
+
+// parses [begin, end) into value; on failure error describes the problem and its offset
+inline bool parseJson(const char *begin, const char *end, JsonValue &value, string &error)
+{
+	json::Parser parser(begin, end);
+	value = JsonValue();
+	if (parser.parse(value))
+		return true;
+	error = parser.error;
+	return false;
+}
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <glad/glad.h>
+
+#include <tool/texture_loader.h>
+#include <tool/mapped_file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// KTX 1.1 files holding the finished mip chain of a DecodedImage, block compressed (tool/texture_compress.h) or 8 bit
+// (tool/mipmap.h): 64 byte header, key/value data, then per level a 4 byte size and the texels.
+// The key/value data stores the source stamp plus a tag describing how the levels were built, so the file is rebuilt
+// when the image or the options change. Only files written by write() are read back.
+namespace ktx
+{
+	static const unsigned char IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+	static const char SOURCE_KEY[] = "source";
+
+	struct Header
+	{
+		unsigned char identifier[12];
+		uint32_t endianness;
+		uint32_t glType;
+		uint32_t glTypeSize;
+		uint32_t glFormat;
+		uint32_t glInternalFormat;
+		uint32_t glBaseInternalFormat;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t numberOfArrayElements;
+		uint32_t numberOfFaces;
+		uint32_t numberOfMipmapLevels;
+		uint32_t bytesOfKeyValueData;
+	};
+
+	inline string sourceValue(const string &sourcePath, const string &tag)
+	{
+		SourceStamp stamp;
+		if (!readSourceStamp(sourcePath, stamp))
+			return "";
+		return to_string(stamp.size) + " " + to_string(stamp.time) + " " + tag;
+	}
+
+	// KTX rows of uncompressed levels are padded to 4 bytes, DecodedImage keeps them tight
+	inline size_t rowPitch(int width, int components)
+	{
+		return ((size_t)width * components + 3) & ~(size_t)3;
+	}
+
+	inline GLenum baseFormat(GLenum compressedFormat)
+	{
+		switch (compressedFormat)
+		{
+		case GL_COMPRESSED_RG_RGTC2:
+			return GL_RG;
+		case 0x83F0: // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		case 0x8C4C: // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+			return GL_RGB;
+		default:
+			return GL_RGBA;
+		}
+	}
+
+	inline bool write(const string &path, const string &sourcePath, const string &tag, const DecodedImage &image)
+	{
+		if (image.levels.empty())
+			return false;
+		string value = sourceValue(sourcePath, tag);
+		// key and value, both zero terminated, padded to 4 bytes
+		string keyValue = string(SOURCE_KEY) + '\0' + value + '\0';
+		uint32_t keyValueSize = (uint32_t)keyValue.size();
+		while (keyValue.size() % 4)
+			keyValue.push_back('\0');
+
+		bool compressed = image.compressedFormat != 0;
+		Header header;
+		memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+		header.endianness = 0x04030201;
+		header.glType = compressed ? 0 : GL_UNSIGNED_BYTE;
+		header.glTypeSize = 1;
+		header.glFormat = compressed ? 0 : pixelFormat(image.components);
+		header.glInternalFormat = compressed ? image.compressedFormat : pixelInternalFormat(image.components, image.srgb);
+		header.glBaseInternalFormat = compressed ? baseFormat(image.compressedFormat) : header.glFormat;
+		header.pixelWidth = image.width;
+		header.pixelHeight = image.height;
+		header.pixelDepth = 0;
+		header.numberOfArrayElements = 0;
+		header.numberOfFaces = 1;
+		header.numberOfMipmapLevels = (uint32_t)image.levels.size();
+		header.bytesOfKeyValueData = (uint32_t)(4 + keyValue.size());
+
+		string temporaryPath = path + ".tmp";
+		{
+			ofstream out(temporaryPath, ios::binary | ios::trunc);
+			if (!out)
+				return false;
+			out.write((const char *)&header, sizeof(header));
+			out.write((const char *)&keyValueSize, 4);
+			out.write(keyValue.data(), keyValue.size());
+			static const char padding[4] = {};
+			for (unsigned int i = 0; i < image.levels.size(); i++)
+			{
+				const ImageLevel &level = image.levels[i];
+				if (compressed)
+				{
+					// block data is always a multiple of 8 bytes, no mip padding needed
+					uint32_t size = (uint32_t)level.data.size();
+					out.write((const char *)&size, 4);
+					out.write((const char *)level.data.data(), size);
+					continue;
+				}
+				size_t tight = (size_t)level.width * image.components, pitch = rowPitch(level.width, image.components);
+				uint32_t size = (uint32_t)(pitch * level.height);
+				out.write((const char *)&size, 4);
+				for (int y = 0; y < level.height; y++)
+				{
+					out.write((const char *)&level.data[y * tight], tight);
+					out.write(padding, pitch - tight);
+				}
+			}
+			if (!out)
+				return false;
+		}
+		std::remove(path.c_str());
+		return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+	}
+
+	// reads a file written by write(); fails on other layouts or when the source or the tag changed
+	inline bool read(const string &path, const string &sourcePath, const string &tag, DecodedImage &image)
+	{
+		MappedFile file;
+		if (!file.open(path) || file.size() < sizeof(Header))
+			return false;
+		const unsigned char *data = file.data();
+		Header header;
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header.endianness != 0x04030201 || header.numberOfFaces != 1 ||
+				header.numberOfMipmapLevels == 0 || header.numberOfMipmapLevels > 32)
+			return false;
+
+		bool compressed = header.glFormat == 0;
+		int components = 0;
+		if (!compressed)
+		{
+			if (header.glType != GL_UNSIGNED_BYTE)
+				return false;
+			for (int c = 1; c <= 4; c++)
+				if (pixelFormat(c) == header.glFormat)
+					components = c;
+			if (!components)
+				return false;
+		}
+
+		size_t position = sizeof(Header);
+		if (header.bytesOfKeyValueData > file.size() - position)
+			return false;
+		string expected = string(SOURCE_KEY) + '\0' + sourceValue(sourcePath, tag) + '\0';
+		uint32_t keyValueSize = 0;
+		if (header.bytesOfKeyValueData >= 4)
+			memcpy(&keyValueSize, data + position, 4);
+		if (keyValueSize != expected.size() || keyValueSize + 4 > header.bytesOfKeyValueData || memcmp(data + position + 4, expected.data(), expected.size()) != 0)
+			return false;
+		position += header.bytesOfKeyValueData;
+
+		image.width = header.pixelWidth;
+		image.height = header.pixelHeight;
+		image.components = components;
+		image.compressedFormat = compressed ? header.glInternalFormat : 0;
+		image.srgb = header.glInternalFormat == GL_SRGB8 || header.glInternalFormat == GL_SRGB8_ALPHA8;
+		image.levels.clear();
+		int width = image.width, height = image.height;
+		for (uint32_t i = 0; i < header.numberOfMipmapLevels; i++)
+		{
+			uint32_t size;
+			if (file.size() - position < 4)
+				return false;
+			memcpy(&size, data + position, 4);
+			position += 4;
+			if (size > file.size() - position)
+				return false;
+			const unsigned char *texels = data + position;
+			if (compressed)
+				image.levels.push_back({width, height, vector<unsigned char>(texels, texels + size)});
+			else
+			{
+				size_t tight = (size_t)width * components, pitch = rowPitch(width, components);
+				if (size != pitch * height)
+					return false;
+				ImageLevel level = {width, height, vector<unsigned char>(tight * height)};
+				for (int y = 0; y < height; y++)
+					memcpy(&level.data[y * tight], texels + y * pitch, tight);
+				image.levels.push_back(std::move(level));
+			}
+			position += (size + 3) & ~3u;
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		return true;
+	}
+
+	// "<image>.<name>[f][s].ktx" next to the source image
+	inline string cachePath(const string &filename, const string &name, bool flipVertically, bool srgb)
+	{
+		return filename + "." + name + (flipVertically ? "f" : "") + (srgb ? "s" : "") + ".ktx";
+	}
+}
+
+#endif
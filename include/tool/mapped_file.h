@@ -0,0 +1,162 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <sys/stat.h>
+
+// Read-only memory mapping of a whole file. The pages are loaded lazily by the OS, so handing data() straight to
+// glBufferData or a parser avoids both the read() copy and the intermediate heap buffer.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile()
+	{
+		close();
+	}
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool open(const std::string &path)
+	{
+		close();
+#ifdef _WIN32
+		fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle == NULL)
+		{
+			close();
+			return false;
+		}
+		mappedData = (const unsigned char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (mappedData == NULL)
+		{
+			close();
+			return false;
+		}
+		mappedSize = (size_t)fileSize.QuadPart;
+#else
+		fileDescriptor = ::open(path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+			return false;
+		struct stat info;
+		if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0)
+		{
+			close();
+			return false;
+		}
+		void *address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (address == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		mappedData = (const unsigned char *)address;
+		mappedSize = (size_t)info.st_size;
+#endif
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (mappedData)
+			UnmapViewOfFile(mappedData);
+		if (mappingHandle != NULL)
+			CloseHandle(mappingHandle);
+		if (fileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(fileHandle);
+		mappingHandle = NULL;
+		fileHandle = INVALID_HANDLE_VALUE;
+#else
+		if (mappedData)
+			munmap((void *)mappedData, mappedSize);
+		if (fileDescriptor >= 0)
+			::close(fileDescriptor);
+		fileDescriptor = -1;
+#endif
+		mappedData = nullptr;
+		mappedSize = 0;
+	}
+
+	bool isOpen() const
+	{
+		return mappedData != nullptr;
+	}
+
+	const unsigned char *data() const
+	{
+		return mappedData;
+	}
+
+	size_t size() const
+	{
+		return mappedSize;
+	}
+
+private:
+	const unsigned char *mappedData = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	HANDLE fileHandle = INVALID_HANDLE_VALUE;
+	HANDLE mappingHandle = NULL;
+#else
+	int fileDescriptor = -1;
+#endif
+};
+
+// identity of a source file; the content hash is only computed when the cheap size/time check is not enough
+struct SourceStamp
+{
+	uint64_t size = 0;
+	int64_t time = 0;
+};
+
+inline bool readSourceStamp(const std::string &path, SourceStamp &stamp)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	stamp.size = (uint64_t)info.st_size;
+	stamp.time = (int64_t)info.st_mtime;
+	return true;
+}
+
+// 64-bit FNV-1a, used for source file hashes and cache keys
+inline uint64_t fnv1a64(const void *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+#endif
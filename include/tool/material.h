@@ -0,0 +1,119 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include <tool/shader.h>
+#include <tool/texture_cache.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Texture
+{
+	unsigned int id;
+	string type;
+	string path;
+	TextureHandle handle; // keeps the GL texture alive, see tool/texture_cache.h
+};
+
+const unsigned int MAX_MATERIAL_TEXTURES = 16;
+
+// The bindings of one material for one shader program. build() does the string work once: the sampler names of the
+// texture_diffuseN / texture_specularN / texture_normalN / texture_heightN convention, resolved to uniform handles.
+// bind() is then a loop over the table, with no allocation and no lookup. Rebuild when the program or a texture id changes.
+struct MaterialTable
+{
+	struct Binding
+	{
+		GLuint texture;
+		UniformHandle<int> sampler; // set to the binding's unit; invalid if the program does not use it
+	};
+
+	unsigned int program = 0; // 0 until built
+	unsigned int count = 0;		// bindings; binding i goes to texture unit i
+	Binding bindings[MAX_MATERIAL_TEXTURES];
+	// per mesh uniforms of the shaders in src/24_meshes, see Mesh::bindMaterial
+	UniformHandle<glm::ivec4> textureLayers;
+	UniformHandle<glm::vec3> positionOffset;
+	UniformHandle<glm::vec3> positionScale;
+
+	void build(const Shader &shader, const vector<Texture> &textures)
+	{
+		program = shader.ID;
+		count = 0;
+		unsigned int diffuseNr = 1;
+		unsigned int specularNr = 1;
+		unsigned int normalNr = 1;
+		unsigned int heightNr = 1;
+		for (unsigned int i = 0; i < textures.size() && count < MAX_MATERIAL_TEXTURES; i++)
+		{
+			// retrieve texture number (the N in diffuse_textureN)
+			const string &name = textures[i].type;
+			unsigned int number = 0;
+			if (name == "texture_diffuse")
+				number = diffuseNr++;
+			else if (name == "texture_specular")
+				number = specularNr++;
+			else if (name == "texture_normal")
+				number = normalNr++;
+			else if (name == "texture_height")
+				number = heightNr++;
+			string uniform = number ? name + std::to_string(number) : name;
+			bindings[count++] = {textures[i].id, shader.uniform<int>(uniform, true)};
+		}
+		textureLayers = shader.uniform<glm::ivec4>("textureLayers", true);
+		positionOffset = shader.uniform<glm::vec3>("positionOffset", true);
+		positionScale = shader.uniform<glm::vec3>("positionScale", true);
+	}
+
+	bool builtFor(const Shader &shader) const
+	{
+		return program != 0 && program == shader.ID;
+	}
+
+	// binds the textures to units 0..count-1 and points their samplers at them; shader is the one the table was
+	// built for and has to be in use. The sampler units rarely change, so Shader::set mostly skips the glUniform1i.
+	void bind(const Shader &shader) const
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, bindings[i].texture);
+			shader.set(bindings[i].sampler, (int)i);
+		}
+	}
+};
+
+// the tables of one material for the programs it is drawn with; usually one or two, so a linear search
+class MaterialTables
+{
+public:
+	const MaterialTable &get(const Shader &shader, const vector<Texture> &textures)
+	{
+		// a program still linking (see ShaderBatch) has no uniforms to resolve yet; the fallback drawing in its
+		// place needs no textures
+		static const MaterialTable empty = MaterialTable();
+		if (!shader.ready())
+			return empty;
+		for (unsigned int i = 0; i < tables.size(); i++)
+			if (tables[i].builtFor(shader))
+				return tables[i];
+		tables.push_back(MaterialTable());
+		tables.back().build(shader, textures);
+		return tables.back();
+	}
+
+	// after the texture ids changed
+	void clear()
+	{
+		tables.clear();
+	}
+
+private:
+	vector<MaterialTable> tables;
+};
+
+#endif
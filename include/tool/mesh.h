@@ -6,30 +6,27 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <tool/shader.h>
+#include <geometry/Vertex.h>
+#include <geometry/PackedVertex.h>
+#include <tool/mesh_simplifier.h>
+#include <tool/mesh_optimizer.h>
+#include <tool/instance_buffer.h>
+#include <tool/geometry_arena.h>
+#include <tool/bounds.h>
+#include <tool/material.h>
+#include <tool/animation.h>
 
 #include <string>
 #include <vector>
 
 using namespace std;
 
-#ifndef BUFFER_GROMETRY
-struct Vertex
+// one level of detail: a range of the element buffer, drawn over the shared vertex buffer
+struct MeshLod
 {
-	glm::vec3 Position;	 // 顶点属性
-	glm::vec3 Normal;		 // 法线
-	glm::vec2 TexCoords; // 纹理坐标
-
-	// 切线空间属性
-	glm::vec3 Tangent;
-	glm::vec3 Bitangent;
-};
-#endif
-
-struct Texture
-{
-	unsigned int id;
-	string type;
-	string path;
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	float error; // object space error introduced by the simplifier, 0 for the full mesh
 };
 
 class Mesh
@@ -39,60 +36,262 @@ public:
 	vector<Vertex> vertices;
 	vector<unsigned int> indices;
 	vector<Texture> textures;
-	unsigned int VAO;
+	unsigned int VAO = 0;
+	bool hasTangents;
+
+	// packed vertex layout (see geometry/PackedVertex.h); positions are decoded with positionOffset/positionScale
+	bool packed = false;
+	PositionEncoding positionEncoding = POSITION_SNORM16;
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+	glm::vec3 positionScale = glm::vec3(1.0f);
+
+	// object space bounds, computed at construction
+	BoundingBox boundingBox;
+	BoundingSphere boundingSphere;
 
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+	// set of Model's texture arrays and layer per slot (tool/texture_array.h); -1 binds the 2D textures instead
+	int textureArraySet = -1;
+	glm::ivec4 textureLayers = glm::ivec4(-1);
+
+	// nodes of Model::sceneGraph that place the mesh, one per reference in the scene; Model draws a mesh placed
+	// by several nodes with one instanced call. Empty draws it with the model matrix alone.
+	vector<int> sceneNodes;
+
+	// bone influences per vertex (tool/animation.h), uploaded to their own buffer on attributes 13 / 14; empty for
+	// meshes that are not skinned. Set before upload().
+	vector<VertexSkin> skin;
+
+	// lods[0] is always the full index list; buildLods() appends the simplified levels
+	vector<MeshLod> lods;
+	// index lists of lods[1..], concatenated after 'indices' in the element buffer
+	vector<unsigned int> lodIndices;
+
+	// deferUpload keeps the mesh CPU only (no GL calls, safe on worker threads) until upload() is called on the GL thread
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, bool deferUpload = false)
 	{
 		this->vertices = vertices;
 		this->indices = indices;
 		this->textures = textures;
 
+		// only upload the tangent space when the importer actually produced one
+		hasTangents = false;
+		for (unsigned int i = 0; i < this->vertices.size() && !hasTangents; i++)
+			hasTangents = this->vertices[i].Tangent != glm::vec3(0.0f);
+
+		computeBounds(this->vertices, boundingBox, boundingSphere);
+		lods.push_back({0, (unsigned int)this->indices.size(), 0.0f});
+
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
-		setupMesh();
+		if (!deferUpload)
+			upload();
 	}
-	// render the mesh
-	void Draw(Shader &shader)
+
+	// uploads already processed data, e.g. straight from a memory mapped mesh cache (tool/mesh_cache.h).
+	// indices holds every LOD level; no CPU copy is kept, so 'vertices' and 'indices' stay empty (addTo reads the buffers back).
+	Mesh(const Vertex *vertexData, unsigned int vertexCount, const unsigned int *indexData, unsigned int indexCount, const vector<MeshLod> &lods,
+			 bool hasTangents, const BoundingBox &boundingBox, const BoundingSphere &boundingSphere, vector<Texture> textures)
+	{
+		this->textures = textures;
+		this->hasTangents = hasTangents;
+		this->boundingBox = boundingBox;
+		this->boundingSphere = boundingSphere;
+		this->lods = lods;
+		setupMesh(vertexData, vertexCount, indexData, indexCount);
+	}
+	bool uploaded() const
 	{
-		// bind appropriate textures
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		unsigned int normalNr = 1;
-		unsigned int heightNr = 1;
-		for (unsigned int i = 0; i < textures.size(); i++)
+		return VAO != 0;
+	}
+
+	// creates the GL buffers from the CPU data, including any LOD levels built so far
+	void upload()
+	{
+		if (lodIndices.empty())
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-																				// retrieve texture number (the N in diffuse_textureN)
-			string number;
-			string name = textures[i].type;
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-			else if (name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-			else if (name == "texture_height")
-				number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-			// now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-			// and finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
+			return;
 		}
+		vector<unsigned int> allIndices = indices;
+		allIndices.insert(allIndices.end(), lodIndices.begin(), lodIndices.end());
+		setupMesh(vertices.data(), vertices.size(), allIndices.data(), allIndices.size());
+	}
+
+	// render the mesh
+	void Draw(Shader &shader, unsigned int lod = 0)
+	{
+		bindMaterial(shader);
 
 		// draw mesh
 		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+		const MeshLod &level = lods[std::min(lod, (unsigned int)lods.size() - 1)];
+		glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void *)(level.indexOffset * sizeof(unsigned int)));
 		glBindVertexArray(0);
 
 		// always good practice to set everything back to defaults once configured.
 		glActiveTexture(GL_TEXTURE0);
 	}
 
+	// bakes the full-detail mesh into a static batch; textures are not part of the arena, bind them once per batch.
+	// Meshes without a CPU copy (built from the mesh cache) are read back from their buffers first, packed ones decoded.
+	unsigned int addTo(GeometryArena &arena, const glm::mat4 &transform = glm::mat4(1.0f)) const
+	{
+		if (!vertices.empty() || !uploaded())
+			return arena.add(vertices, indices, transform);
+
+		vector<Vertex> vertexData;
+		vector<unsigned int> indexData;
+		readBack(vertexData, indexData);
+		return arena.add(vertexData, indexData, transform);
+	}
+
+	// render instances.count copies of the mesh, one per entry of the instance buffer
+	void DrawInstanced(Shader &shader, const InstanceBuffer &instances, unsigned int lod = 0)
+	{
+		if (instances.count == 0)
+			return;
+		if (instanceVBO != instances.VBO)
+		{
+			instances.attach(VAO);
+			instanceVBO = instances.VBO;
+		}
+		bindMaterial(shader);
+
+		glBindVertexArray(VAO);
+		const MeshLod &level = lods[std::min(lod, (unsigned int)lods.size() - 1)];
+		glDrawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void *)(level.indexOffset * sizeof(unsigned int)), instances.count);
+		glBindVertexArray(0);
+
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void bindMaterial(Shader &shader)
+	{
+		const MaterialTable &table = materialTables.get(shader, textures);
+		if (textureArraySet >= 0)
+		{
+			// the arrays are bound by the model, only the layers change per draw
+			shader.set(table.textureLayers, textureLayers);
+		}
+		else
+			table.bind(shader);
+
+		if (packed)
+		{
+			shader.set(table.positionOffset, positionOffset);
+			shader.set(table.positionScale, positionScale);
+		}
+	}
+
+	// call after changing the texture ids, the next draw rebuilds the material tables
+	void invalidateMaterial()
+	{
+		materialTables.clear();
+	}
+
+	// simplifies the mesh into up to maxLevels coarser index lists, each roughly half of the previous one.
+	// All levels live in the same element buffer and reuse the vertex buffer.
+	void buildLods(unsigned int maxLevels = 4)
+	{
+		vector<unsigned int> previous = indices;
+		float error = 0.0f;
+		float maxError = boundingSphere.radius * 0.25f; // beyond this the shape is no longer recognisable
+		for (unsigned int level = 1; level <= maxLevels; level++)
+		{
+			size_t target = previous.size() / 6 * 3;
+			if (target < 36)
+				break;
+			float levelError = 0.0f;
+			vector<unsigned int> simplified = simplifyMesh(vertices, previous, target, maxError, &levelError);
+			// stop once the simplifier can no longer make meaningful progress (locked seams, error budget)
+			if (simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+				break;
+			optimizeVertexCache(simplified, vertices.size());
+
+			// errors of successive levels add up since each one starts from the previous level
+			error += levelError;
+			lods.push_back({(unsigned int)(indices.size() + lodIndices.size()), (unsigned int)simplified.size(), error});
+			lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+			previous.swap(simplified);
+		}
+		if (lods.size() == 1 || !uploaded())
+			return;
+
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (indices.size() + lodIndices.size()) * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(unsigned int), &indices[0]);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), lodIndices.size() * sizeof(unsigned int), &lodIndices[0]);
+		glBindVertexArray(0);
+	}
+
+	// re-upload the vertex buffer in the compact layout; the CPU copy in 'vertices' is kept
+	void usePackedVertices(PositionEncoding encoding = POSITION_SNORM16)
+	{
+		usePackedVertices(vertices, encoding);
+	}
+
+	// same, for meshes without a CPU copy (the source vertices must match the ones the mesh was built from)
+	void usePackedVertices(const vector<Vertex> &source, PositionEncoding encoding = POSITION_SNORM16)
+	{
+		PackedVertexBuffer packedBuffer = packVertices(source, hasTangents, encoding);
+		packed = true;
+		positionEncoding = encoding;
+		positionOffset = packedBuffer.positionOffset;
+		positionScale = packedBuffer.positionScale;
+
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, packedBuffer.data.size(), packedBuffer.data.data(), GL_STATIC_DRAW);
+		packedBuffer.setupAttributes();
+		glBindVertexArray(0);
+	}
+
 private:
 	// render data
-	unsigned int VBO, EBO;
+	unsigned int VBO = 0, EBO = 0;
+	unsigned int skinVBO = 0;
+	unsigned int instanceVBO = 0; // instance buffer whose attributes are currently set on the VAO
+	MaterialTables materialTables; // texture bindings per shader program, see tool/material.h
 
-	void setupMesh()
+	// copies the whole vertex buffer and the full-detail index range (lods[0]) back from the GL buffers;
+	// a packed vertex buffer is decoded back into Vertex
+	void readBack(vector<Vertex> &vertexData, vector<unsigned int> &indexData) const
+	{
+		GLint vertexBytes = 0;
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &vertexBytes);
+		if (packed)
+		{
+			PackedVertexBuffer packedBuffer;
+			packedBuffer.hasTangents = hasTangents;
+			packedBuffer.encoding = positionEncoding;
+			packedBuffer.stride = hasTangents ? sizeof(PackedTangentVertex) : sizeof(PackedVertex);
+			packedBuffer.positionOffset = positionOffset;
+			packedBuffer.positionScale = positionScale;
+			packedBuffer.data.resize(vertexBytes / packedBuffer.stride * packedBuffer.stride);
+			if (!packedBuffer.data.empty())
+				glGetBufferSubData(GL_ARRAY_BUFFER, 0, packedBuffer.data.size(), packedBuffer.data.data());
+			vertexData = unpackVertices(packedBuffer);
+		}
+		else
+		{
+			vertexData.resize(vertexBytes / sizeof(Vertex));
+			if (!vertexData.empty())
+				glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertexData.size() * sizeof(Vertex), vertexData.data());
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// the element buffer binding is VAO state, so read it through the copy target
+		indexData.resize(lods.empty() ? 0 : lods[0].indexCount);
+		if (!indexData.empty())
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, lods[0].indexOffset * sizeof(unsigned int), indexData.size() * sizeof(unsigned int), indexData.data());
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+	}
+
+	void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount)
 	{
 		// create buffers/arrays
 		glGenVertexArrays(1, &VAO);
@@ -105,10 +304,10 @@ private:
 		// A great thing about structs is that their memory layout is sequential for all its items.
 		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
 		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
 
 		// set the vertex attribute pointers
 		// vertex Positions
@@ -120,12 +319,27 @@ private:
 		// vertex texture coords
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
-		// vertex tangent
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
-		// vertex bitangent
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
+		if (hasTangents)
+		{
+			// vertex tangent
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
+			// vertex bitangent
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
+		}
+		if (!skin.empty())
+		{
+			// a separate stream, so usePackedVertices() can replace the vertex buffer without touching it
+			glGenBuffers(1, &skinVBO);
+			glBindBuffer(GL_ARRAY_BUFFER, skinVBO);
+			glBufferData(GL_ARRAY_BUFFER, skin.size() * sizeof(VertexSkin), skin.data(), GL_STATIC_DRAW);
+			// bone indices stay integers
+			glEnableVertexAttribArray(SKIN_ATTRIBUTE_BONES);
+			glVertexAttribIPointer(SKIN_ATTRIBUTE_BONES, 4, GL_UNSIGNED_BYTE, sizeof(VertexSkin), (void *)offsetof(VertexSkin, bones));
+			glEnableVertexAttribArray(SKIN_ATTRIBUTE_WEIGHTS);
+			glVertexAttribPointer(SKIN_ATTRIBUTE_WEIGHTS, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(VertexSkin), (void *)offsetof(VertexSkin, weights));
+		}
 
 		glBindVertexArray(0);
 	}
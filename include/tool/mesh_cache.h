@@ -0,0 +1,420 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <tool/mesh.h>
+#include <tool/mapped_file.h>
+#include <tool/obj_loader.h>
+#include <tool/scene_graph.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Cooked binary form of a Model's meshes, written next to the source file as "<source>.meshcache".
+// Layout: header | mesh table | node table | node references | texture table | dependency table | string table |
+// vertex blobs | index blobs (blobs 16 byte aligned).
+// Vertices are stored post optimisation and indices include every LOD level, so a warm start maps the file
+// and uploads straight from the mapping. The node table holds the scene hierarchy in SceneGraph order, and each mesh
+// lists the nodes that place it, once per reference (a mesh shared by several nodes is stored once).
+// The header records the source size, modification time and content hash, the dependency table the same for the
+// material libraries an OBJ file names; bump MESH_CACHE_VERSION whenever the import pipeline changes its output.
+
+const char MESH_CACHE_MAGIC[8] = {'M', 'E', 'S', 'H', 'C', 'C', 'H', 'E'};
+const uint32_t MESH_CACHE_VERSION = 6;
+const uint32_t MESH_CACHE_MAX_LODS = 8;
+
+struct MeshCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t meshCount;
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	uint64_t sourceHash;
+	uint64_t meshTableOffset;
+	uint64_t textureTableOffset;
+	uint64_t stringsOffset;
+	uint32_t textureCount;
+	uint32_t stringsSize;
+	uint64_t fileSize;
+	uint64_t nodeTableOffset;
+	uint32_t nodeCount;
+	uint32_t nodeRefCount;
+	uint64_t nodeRefOffset; // int32 node indices, see MeshCacheEntry::firstNodeRef
+	uint64_t dependencyOffset;
+	uint32_t dependencyCount;
+	uint32_t padding;
+};
+
+struct MeshCacheEntry
+{
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t vertexCount;
+	uint32_t indexCount; // all LOD levels together
+	uint32_t lodCount;
+	uint32_t hasTangents;
+	MeshLod lods[MESH_CACHE_MAX_LODS];
+	BoundingBox boundingBox;
+	BoundingSphere boundingSphere;
+	uint32_t firstTexture;
+	uint32_t textureCount;
+	uint32_t firstNodeRef; // nodes placing the mesh, Mesh::sceneNodes
+	uint32_t nodeRefCount;
+};
+
+struct MeshCacheNode
+{
+	int32_t parent;
+	uint32_t nameOffset; // into the string table
+	float local[16];		 // column major like glm
+};
+
+struct MeshCacheTexture
+{
+	uint32_t typeOffset; // offsets into the string table, zero terminated
+	uint32_t pathOffset;
+};
+
+// a file besides the source that the cached data was built from; size MESH_CACHE_MISSING records one that did not exist
+const uint64_t MESH_CACHE_MISSING = ~(uint64_t)0;
+
+struct MeshCacheDependency
+{
+	uint32_t pathOffset; // into the string table
+	uint32_t padding;
+	uint64_t size;
+	int64_t time;
+	uint64_t hash;
+};
+
+inline bool hashSourceFile(const string &path, uint64_t &hash)
+{
+	MappedFile file;
+	if (!file.open(path))
+		return false;
+	hash = fnv1a64(file.data(), file.size());
+	return true;
+}
+
+inline string meshCachePath(const string &sourcePath)
+{
+	return sourcePath + ".meshcache";
+}
+
+// the material libraries an OBJ file names, resolved against its directory like obj::loadObj does
+inline vector<string> meshCacheDependencies(const string &sourcePath)
+{
+	vector<string> paths;
+	MappedFile file;
+	if (!isObjFile(sourcePath) || !file.open(sourcePath))
+		return paths;
+	string directory = sourcePath.substr(0, sourcePath.find_last_of('/') + 1);
+	const char *p = (const char *)file.data();
+	const char *end = p + file.size();
+	while (p < end)
+	{
+		p = obj::skipBlanks(p, end);
+		if (obj::keyword(p, end, "mtllib", 6))
+			paths.push_back(directory + obj::restOfLine(p + 6, end));
+		while (p < end && *p != '\n')
+			p++;
+		p++;
+	}
+	return paths;
+}
+
+// Unchanged size and time are trusted, except when the time is not older than the second the cache was written in:
+// the file may have changed again within that second. Otherwise a touched but identical file is accepted after
+// hashing it.
+inline bool sourceUnchanged(const string &path, uint64_t size, int64_t time, uint64_t hash, int64_t cacheTime)
+{
+	SourceStamp stamp;
+	if (!readSourceStamp(path, stamp))
+		return size == MESH_CACHE_MISSING;
+	if (stamp.size != size)
+		return false;
+	if (stamp.time == time && stamp.time < cacheTime)
+		return true;
+	uint64_t current;
+	return hashSourceFile(path, current) && current == hash;
+}
+
+// A validated, memory mapped cache file. The pointers stay valid while the reader is alive.
+class MeshCacheReader
+{
+public:
+	const MeshCacheHeader *header = nullptr;
+	const MeshCacheEntry *entries = nullptr;
+	const MeshCacheNode *nodes = nullptr;
+	const int32_t *nodeRefs = nullptr;
+	const MeshCacheTexture *textures = nullptr;
+	const MeshCacheDependency *dependencies = nullptr;
+	const char *strings = nullptr;
+
+	// maps the cache of sourcePath; fails when it is missing, corrupt or stale
+	bool open(const string &sourcePath)
+	{
+		SourceStamp cacheStamp;
+		if (!readSourceStamp(meshCachePath(sourcePath), cacheStamp) || !file.open(meshCachePath(sourcePath)))
+			return false;
+
+		const unsigned char *data = file.data();
+		size_t size = file.size();
+		if (size < sizeof(MeshCacheHeader))
+			return fail();
+		header = (const MeshCacheHeader *)data;
+		if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 || header->version != MESH_CACHE_VERSION || header->fileSize != size)
+			return fail();
+
+		if (!sourceUnchanged(sourcePath, header->sourceSize, header->sourceTime, header->sourceHash, cacheStamp.time))
+			return fail();
+
+		if (!inside(header->meshTableOffset, (uint64_t)header->meshCount * sizeof(MeshCacheEntry)) ||
+				!inside(header->nodeTableOffset, (uint64_t)header->nodeCount * sizeof(MeshCacheNode)) ||
+				!inside(header->nodeRefOffset, (uint64_t)header->nodeRefCount * sizeof(int32_t)) ||
+				!inside(header->textureTableOffset, (uint64_t)header->textureCount * sizeof(MeshCacheTexture)) ||
+				!inside(header->dependencyOffset, (uint64_t)header->dependencyCount * sizeof(MeshCacheDependency)) ||
+				!inside(header->stringsOffset, header->stringsSize))
+			return fail();
+		entries = (const MeshCacheEntry *)(data + header->meshTableOffset);
+		nodes = (const MeshCacheNode *)(data + header->nodeTableOffset);
+		nodeRefs = (const int32_t *)(data + header->nodeRefOffset);
+		textures = (const MeshCacheTexture *)(data + header->textureTableOffset);
+		dependencies = (const MeshCacheDependency *)(data + header->dependencyOffset);
+		strings = (const char *)(data + header->stringsOffset);
+
+		// an edited material library changes the texture references stored with the meshes
+		for (uint32_t i = 0; i < header->dependencyCount; i++)
+		{
+			const MeshCacheDependency &dependency = dependencies[i];
+			if (!sourceUnchanged(text(dependency.pathOffset), dependency.size, dependency.time, dependency.hash, cacheStamp.time))
+				return fail();
+		}
+
+		for (uint32_t i = 0; i < header->meshCount; i++)
+		{
+			const MeshCacheEntry &entry = entries[i];
+			if (!inside(entry.vertexOffset, (uint64_t)entry.vertexCount * sizeof(Vertex)) ||
+					!inside(entry.indexOffset, (uint64_t)entry.indexCount * sizeof(unsigned int)) ||
+					entry.lodCount == 0 || entry.lodCount > MESH_CACHE_MAX_LODS ||
+					(uint64_t)entry.firstTexture + entry.textureCount > header->textureCount ||
+					(uint64_t)entry.firstNodeRef + entry.nodeRefCount > header->nodeRefCount)
+				return fail();
+		}
+		for (uint32_t i = 0; i < header->nodeRefCount; i++)
+			if (nodeRefs[i] < 0 || nodeRefs[i] >= (int64_t)header->nodeCount)
+				return fail();
+		// parents come first; SceneGraph::addNode checks the breadth first order itself
+		for (uint32_t i = 0; i < header->nodeCount; i++)
+			if (nodes[i].parent < -1 || nodes[i].parent >= (int64_t)i)
+				return fail();
+		return true;
+	}
+
+	// rebuilds the node hierarchy of the cached scene; false if the nodes are not in breadth first order
+	bool readSceneGraph(SceneGraph &graph) const
+	{
+		graph.clear();
+		for (uint32_t i = 0; i < header->nodeCount; i++)
+		{
+			glm::mat4 local;
+			memcpy(&local[0][0], nodes[i].local, sizeof(nodes[i].local));
+			if (graph.addNode(nodes[i].parent, local, text(nodes[i].nameOffset)) < 0)
+				return false;
+		}
+		return true;
+	}
+
+	vector<int> sceneNodes(const MeshCacheEntry &entry) const
+	{
+		return vector<int>(nodeRefs + entry.firstNodeRef, nodeRefs + entry.firstNodeRef + entry.nodeRefCount);
+	}
+
+	const Vertex *vertices(const MeshCacheEntry &entry) const
+	{
+		return (const Vertex *)(file.data() + entry.vertexOffset);
+	}
+
+	const unsigned int *indices(const MeshCacheEntry &entry) const
+	{
+		return (const unsigned int *)(file.data() + entry.indexOffset);
+	}
+
+	const char *text(uint32_t offset) const
+	{
+		return offset < header->stringsSize ? strings + offset : "";
+	}
+
+private:
+	MappedFile file;
+
+	bool inside(uint64_t offset, uint64_t bytes) const
+	{
+		return offset <= file.size() && bytes <= file.size() - offset;
+	}
+
+	bool fail()
+	{
+		file.close();
+		header = nullptr;
+		entries = nullptr;
+		nodes = nullptr;
+		nodeRefs = nullptr;
+		textures = nullptr;
+		dependencies = nullptr;
+		strings = nullptr;
+		return false;
+	}
+};
+
+// writes the cache for meshes imported from sourcePath; meshes must still hold their CPU side vertices and indices
+inline bool writeMeshCache(const string &sourcePath, const vector<Mesh> &meshes, const SceneGraph &graph)
+{
+	SourceStamp stamp;
+	uint64_t hash;
+	if (!readSourceStamp(sourcePath, stamp) || !hashSourceFile(sourcePath, hash))
+		return false;
+
+	auto align16 = [](uint64_t offset) { return (offset + 15) & ~(uint64_t)15; };
+
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.meshCount = (uint32_t)meshes.size();
+	header.sourceSize = stamp.size;
+	header.sourceTime = stamp.time;
+	header.sourceHash = hash;
+
+	vector<MeshCacheEntry> entries(meshes.size(), MeshCacheEntry()); // value initialised, padding bytes included
+	vector<MeshCacheTexture> textures;
+	vector<int32_t> nodeRefs;
+	string strings;
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		const Mesh &mesh = meshes[i];
+		if (mesh.vertices.empty() || mesh.lods.size() > MESH_CACHE_MAX_LODS)
+			return false;
+		MeshCacheEntry &entry = entries[i];
+		entry.vertexCount = (uint32_t)mesh.vertices.size();
+		entry.indexCount = (uint32_t)(mesh.indices.size() + mesh.lodIndices.size());
+		entry.lodCount = (uint32_t)mesh.lods.size();
+		entry.hasTangents = mesh.hasTangents ? 1 : 0;
+		for (unsigned int l = 0; l < mesh.lods.size(); l++)
+			entry.lods[l] = mesh.lods[l];
+		entry.boundingBox = mesh.boundingBox;
+		entry.boundingSphere = mesh.boundingSphere;
+		entry.firstTexture = (uint32_t)textures.size();
+		entry.textureCount = (uint32_t)mesh.textures.size();
+		entry.firstNodeRef = (uint32_t)nodeRefs.size();
+		entry.nodeRefCount = (uint32_t)mesh.sceneNodes.size();
+		nodeRefs.insert(nodeRefs.end(), mesh.sceneNodes.begin(), mesh.sceneNodes.end());
+		for (unsigned int t = 0; t < mesh.textures.size(); t++)
+		{
+			MeshCacheTexture texture;
+			texture.typeOffset = (uint32_t)strings.size();
+			strings.append(mesh.textures[t].type).push_back('\0');
+			texture.pathOffset = (uint32_t)strings.size();
+			strings.append(mesh.textures[t].path).push_back('\0');
+			textures.push_back(texture);
+		}
+	}
+
+	vector<MeshCacheDependency> dependencies;
+	vector<string> dependencyPaths = meshCacheDependencies(sourcePath);
+	for (unsigned int i = 0; i < dependencyPaths.size(); i++)
+	{
+		MeshCacheDependency dependency = MeshCacheDependency();
+		SourceStamp dependencyStamp;
+		dependency.pathOffset = (uint32_t)strings.size();
+		strings.append(dependencyPaths[i]).push_back('\0');
+		if (!readSourceStamp(dependencyPaths[i], dependencyStamp))
+			dependency.size = MESH_CACHE_MISSING;
+		else if (!hashSourceFile(dependencyPaths[i], dependency.hash))
+			return false;
+		else
+		{
+			dependency.size = dependencyStamp.size;
+			dependency.time = dependencyStamp.time;
+		}
+		dependencies.push_back(dependency);
+	}
+
+	vector<MeshCacheNode> nodes(graph.size(), MeshCacheNode());
+	for (unsigned int i = 0; i < graph.size(); i++)
+	{
+		nodes[i].parent = graph.parent[i];
+		nodes[i].nameOffset = (uint32_t)strings.size();
+		strings.append(graph.name[i]).push_back('\0');
+		memcpy(nodes[i].local, &graph.local[i][0][0], sizeof(nodes[i].local));
+	}
+
+	header.meshTableOffset = align16(sizeof(MeshCacheHeader));
+	header.nodeTableOffset = align16(header.meshTableOffset + entries.size() * sizeof(MeshCacheEntry));
+	header.nodeCount = (uint32_t)nodes.size();
+	header.nodeRefOffset = align16(header.nodeTableOffset + nodes.size() * sizeof(MeshCacheNode));
+	header.nodeRefCount = (uint32_t)nodeRefs.size();
+	header.textureTableOffset = align16(header.nodeRefOffset + nodeRefs.size() * sizeof(int32_t));
+	header.textureCount = (uint32_t)textures.size();
+	header.dependencyOffset = align16(header.textureTableOffset + textures.size() * sizeof(MeshCacheTexture));
+	header.dependencyCount = (uint32_t)dependencies.size();
+	header.stringsOffset = header.dependencyOffset + dependencies.size() * sizeof(MeshCacheDependency);
+	header.stringsSize = (uint32_t)strings.size();
+	uint64_t offset = align16(header.stringsOffset + strings.size());
+	for (unsigned int i = 0; i < entries.size(); i++)
+	{
+		entries[i].vertexOffset = offset;
+		offset = align16(offset + (uint64_t)entries[i].vertexCount * sizeof(Vertex));
+	}
+	for (unsigned int i = 0; i < entries.size(); i++)
+	{
+		entries[i].indexOffset = offset;
+		offset = align16(offset + (uint64_t)entries[i].indexCount * sizeof(unsigned int));
+	}
+	header.fileSize = offset;
+
+	// write to a temporary name first so a crash never leaves a truncated cache behind
+	string cachePath = meshCachePath(sourcePath);
+	string temporaryPath = cachePath + ".tmp";
+	{
+		ofstream out(temporaryPath, ios::binary | ios::trunc);
+		if (!out)
+			return false;
+		const char padding[16] = {0};
+		auto writeAt = [&](uint64_t position, const void *data, size_t bytes) {
+			uint64_t current = (uint64_t)out.tellp();
+			if (position > current)
+				out.write(padding, (streamsize)(position - current));
+			out.write((const char *)data, (streamsize)bytes);
+		};
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.meshTableOffset, entries.data(), entries.size() * sizeof(MeshCacheEntry));
+		writeAt(header.nodeTableOffset, nodes.data(), nodes.size() * sizeof(MeshCacheNode));
+		writeAt(header.nodeRefOffset, nodeRefs.data(), nodeRefs.size() * sizeof(int32_t));
+		writeAt(header.textureTableOffset, textures.data(), textures.size() * sizeof(MeshCacheTexture));
+		writeAt(header.dependencyOffset, dependencies.data(), dependencies.size() * sizeof(MeshCacheDependency));
+		writeAt(header.stringsOffset, strings.data(), strings.size());
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			writeAt(entries[i].vertexOffset, meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			writeAt(entries[i].indexOffset, meshes[i].indices.data(), meshes[i].indices.size() * sizeof(unsigned int));
+			out.write((const char *)meshes[i].lodIndices.data(), (streamsize)(meshes[i].lodIndices.size() * sizeof(unsigned int)));
+		}
+		uint64_t end = (uint64_t)out.tellp();
+		if (header.fileSize > end)
+			out.write(padding, (streamsize)(header.fileSize - end));
+		if (!out)
+			return false;
+	}
+	std::remove(cachePath.c_str());
+	return std::rename(temporaryPath.c_str(), cachePath.c_str()) == 0;
+}
+
+#endif
@@ -0,0 +1,352 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <geometry/Vertex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+// Import-time index/vertex reordering for the post-transform vertex cache, overdraw and vertex fetch.
+// All passes keep the triangle set intact; only the order of triangles (and of vertices for fetch) changes.
+
+struct VertexCacheStats
+{
+	float acmr; // average cache miss ratio: transformed vertices per triangle (0.5 is ideal for grids, 3 is worst)
+	float atvr; // average transformed vertex ratio: transformed vertices per unique vertex (1 is ideal)
+};
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// simulates a FIFO post-transform cache of cacheSize entries, which is how most hardware behaves
+inline VertexCacheStats analyzeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16)
+{
+	VertexCacheStats stats = {0.0f, 0.0f};
+	if (indices.size() < 3 || vertexCount == 0)
+		return stats;
+
+	// a vertex is in the cache when its insertion stamp is within the last cacheSize insertions
+	vector<size_t> stamp(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	size_t misses = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int v = indices[i];
+		if (time - stamp[v] > cacheSize)
+		{
+			stamp[v] = time++;
+			misses++;
+		}
+	}
+
+	size_t used = 0;
+	vector<bool> seen(vertexCount, false);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (!seen[indices[i]])
+		{
+			seen[indices[i]] = true;
+			used++;
+		}
+	}
+
+	stats.acmr = (float)misses / (float)(indices.size() / 3);
+	stats.atvr = (float)misses / (float)used;
+	return stats;
+}
+
+namespace forsyth
+{
+	const int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRI_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	inline float vertexScore(int cachePosition, unsigned int remaining)
+	{
+		if (remaining == 0)
+			return -1.0f; // no triangles left, never worth picking
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+				score = LAST_TRI_SCORE; // the three vertices of the last triangle
+			else
+				score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+		return score + VALENCE_BOOST_SCALE * std::pow((float)remaining, -VALENCE_BOOST_POWER);
+	}
+}
+
+// Tom Forsyth's linear-speed vertex cache optimisation
+inline void optimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// vertex -> triangle adjacency
+	vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		offsets[indices[i] + 1]++;
+	for (size_t i = 0; i < vertexCount; i++)
+		offsets[i + 1] += offsets[i];
+	vector<unsigned int> adjacency(triangleCount * 3);
+	vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		unsigned int v = indices[i];
+		adjacency[offsets[v] + remaining[v]++] = (unsigned int)(i / 3);
+	}
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = forsyth::vertexScore(-1, remaining[v]);
+
+	vector<float> triangleScore(triangleCount);
+	vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	vector<unsigned int> result;
+	result.reserve(indices.size());
+	vector<unsigned int> cache;
+	vector<unsigned int> nextCache;
+	cache.reserve(forsyth::CACHE_SIZE + 3);
+	nextCache.reserve(forsyth::CACHE_SIZE + 3);
+
+	size_t scanCursor = 0;
+	long best = -1;
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (best < 0)
+		{
+			// nothing in the cache is useful: take the best remaining triangle in a forward scan
+			float bestScore = -1.0f;
+			while (scanCursor < triangleCount && emitted[scanCursor])
+				scanCursor++;
+			for (size_t t = scanCursor; t < triangleCount && t < scanCursor + 256; t++)
+			{
+				if (!emitted[t] && triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = (long)t;
+				}
+			}
+		}
+
+		unsigned int tri = (unsigned int)best;
+		emitted[tri] = true;
+		const unsigned int *corners = &indices[tri * 3];
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = corners[c];
+			result.push_back(v);
+
+			// detach the triangle from its vertices
+			unsigned int *list = &adjacency[offsets[v]];
+			for (unsigned int i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] == tri)
+				{
+					std::swap(list[i], list[remaining[v] - 1]);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// the emitted vertices move to the front of the LRU cache
+		nextCache.assign(corners, corners + 3);
+		for (unsigned int i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			if (v != corners[0] && v != corners[1] && v != corners[2])
+				nextCache.push_back(v);
+		}
+		if (nextCache.size() > (size_t)forsyth::CACHE_SIZE)
+		{
+			// evicted vertices lose their cache bonus
+			for (unsigned int i = forsyth::CACHE_SIZE; i < nextCache.size(); i++)
+			{
+				cachePosition[nextCache[i]] = -1;
+				vertexScore[nextCache[i]] = forsyth::vertexScore(-1, remaining[nextCache[i]]);
+			}
+			nextCache.resize(forsyth::CACHE_SIZE);
+		}
+		cache.swap(nextCache);
+
+		// rescore the cache and pick the best triangle touching it
+		for (unsigned int i = 0; i < cache.size(); i++)
+		{
+			cachePosition[cache[i]] = (int)i;
+			vertexScore[cache[i]] = forsyth::vertexScore((int)i, remaining[cache[i]]);
+		}
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				unsigned int t = adjacency[offsets[v] + j];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triangleScore[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = (long)t;
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+// Sander et al. style cluster sort: split the cache-optimised order into clusters, then draw outward-facing clusters first.
+// threshold is how much ACMR the cluster split is allowed to cost, relative to the cache-optimised order (1.05 = 5%).
+inline void optimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold = 1.05f)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+		return;
+
+	// per-triangle cache misses with the same FIFO model as analyzeVertexCache
+	const unsigned int cacheSize = 16;
+	vector<size_t> stamp(vertices.size(), 0);
+	size_t time = cacheSize + 1;
+	vector<unsigned char> misses(triangleCount, 0);
+	size_t totalMisses = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			if (time - stamp[v] > cacheSize)
+			{
+				stamp[v] = time++;
+				misses[t]++;
+			}
+		}
+		totalMisses += misses[t];
+	}
+	float meshAcmr = (float)totalMisses / (float)triangleCount;
+
+	// hard boundaries where the cache was effectively flushed, soft boundaries while the cluster stays cheap
+	vector<size_t> clusters;
+	size_t clusterStart = 0;
+	size_t clusterMisses = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		bool hard = misses[t] == 3 && t > clusterStart;
+		if (hard)
+		{
+			clusters.push_back(clusterStart);
+			clusterStart = t;
+			clusterMisses = 0;
+		}
+		clusterMisses += misses[t];
+		size_t clusterTriangles = t - clusterStart + 1;
+		if (clusterTriangles >= 16 && (float)clusterMisses / (float)clusterTriangles <= meshAcmr * threshold && t + 1 < triangleCount)
+		{
+			clusters.push_back(clusterStart);
+			clusterStart = t + 1;
+			clusterMisses = 0;
+		}
+	}
+	clusters.push_back(clusterStart);
+	clusters.push_back(triangleCount);
+
+	// mesh centroid
+	glm::vec3 meshCentroid(0.0f);
+	for (size_t i = 0; i < indices.size(); i++)
+		meshCentroid += vertices[indices[i]].Position;
+	meshCentroid /= (float)indices.size();
+
+	size_t clusterCount = clusters.size() - 1;
+	vector<float> sortKey(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+			const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+			const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+			float a = glm::length(n);
+			centroid += (p0 + p1 + p2) * (a / 3.0f);
+			normal += n;
+			area += a;
+		}
+		centroid = area > 0.0f ? centroid / area : vertices[indices[clusters[c] * 3]].Position;
+		float nl = glm::length(normal);
+		normal = nl > 0.0f ? normal / nl : glm::vec3(0.0f);
+		sortKey[c] = glm::dot(centroid - meshCentroid, normal);
+	}
+
+	vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+	vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t i = 0; i < clusterCount; i++)
+	{
+		size_t c = order[i];
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+	indices.swap(result);
+}
+
+// renumbers vertices in first-use order so the vertex fetch walks memory linearly; unreferenced vertices are dropped.
+// remapOut, if given, receives the new index of every old vertex (~0u for dropped ones) to reorder parallel streams.
+inline void optimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<unsigned int> *remapOut = nullptr)
+{
+	const unsigned int unused = ~0u;
+	vector<unsigned int> remap(vertices.size(), unused);
+	vector<Vertex> result;
+	result.reserve(vertices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int &target = remap[indices[i]];
+		if (target == unused)
+		{
+			target = (unsigned int)result.size();
+			result.push_back(vertices[indices[i]]);
+		}
+		indices[i] = target;
+	}
+	vertices.swap(result);
+	if (remapOut)
+		remapOut->swap(remap);
+}
+
+// runs the three passes in order and reports the cache statistics before and after
+inline MeshOptimizeReport optimizeMesh(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<unsigned int> *remapOut = nullptr)
+{
+	MeshOptimizeReport report;
+	report.before = analyzeVertexCache(indices, vertices.size());
+	optimizeVertexCache(indices, vertices.size());
+	optimizeOverdraw(indices, vertices);
+	optimizeVertexFetch(vertices, indices, remapOut);
+	report.after = analyzeVertexCache(indices, vertices.size());
+	return report;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <geometry/Vertex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Quadric error metric (Garland & Heckbert) edge-collapse simplifier.
+// Vertices are collapsed onto one of their neighbours, so the result is a new index list over the SAME vertex buffer;
+// that is what lets every LOD of a Mesh share one VBO. Border and UV/normal seam vertices are locked to keep the silhouette and texturing intact.
+
+struct Quadric
+{
+	// symmetric 4x4 matrix of the plane equations, plus the accumulated area weight
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2, w;
+
+	static Quadric fromPlane(glm::dvec3 n, double d, double weight)
+	{
+		Quadric q;
+		q.a2 = n.x * n.x * weight;
+		q.ab = n.x * n.y * weight;
+		q.ac = n.x * n.z * weight;
+		q.ad = n.x * d * weight;
+		q.b2 = n.y * n.y * weight;
+		q.bc = n.y * n.z * weight;
+		q.bd = n.y * d * weight;
+		q.c2 = n.z * n.z * weight;
+		q.cd = n.z * d * weight;
+		q.d2 = d * d * weight;
+		q.w = weight;
+		return q;
+	}
+
+	void add(const Quadric &o)
+	{
+		a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+		b2 += o.b2; bc += o.bc; bd += o.bd;
+		c2 += o.c2; cd += o.cd; d2 += o.d2;
+		w += o.w;
+	}
+
+	// mean squared distance of p to the accumulated planes
+	double error(const glm::vec3 &p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x + b2 * y * y + 2 * bc * y * z + 2 * bd * y + c2 * z * z + 2 * cd * z + d2;
+		return w > 0.0 ? std::fabs(e) / w : 0.0;
+	}
+};
+
+namespace simplifier
+{
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double cost;
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3 &p) const
+		{
+			unsigned int h[3];
+			memcpy(h, &p, sizeof(h));
+			return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+		}
+	};
+
+	// locks vertices that share a position with another vertex (seams) or lie on an open edge (borders)
+	inline vector<bool> findLockedVertices(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+	{
+		vector<unsigned int> weld(vertices.size());
+		vector<unsigned int> weldCount(vertices.size(), 0);
+		unordered_map<glm::vec3, unsigned int, PositionHash> firstAt;
+		for (unsigned int i = 0; i < vertices.size(); i++)
+		{
+			auto it = firstAt.emplace(vertices[i].Position, i).first;
+			weld[i] = it->second;
+			weldCount[it->second]++;
+		}
+
+		// open edges over welded positions; an edge seen once is a border
+		unordered_map<unsigned long long, int> edges;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = weld[indices[i + e]];
+				unsigned int b = weld[indices[i + (e + 1) % 3]];
+				unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+				edges[key]++;
+			}
+		}
+		vector<bool> borderPosition(vertices.size(), false);
+		for (auto it = edges.begin(); it != edges.end(); ++it)
+		{
+			if (it->second == 1)
+			{
+				borderPosition[it->first >> 32] = true;
+				borderPosition[it->first & 0xffffffffu] = true;
+			}
+		}
+
+		vector<bool> locked(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			locked[i] = weldCount[weld[i]] > 1 || borderPosition[weld[i]];
+		return locked;
+	}
+
+	inline glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+}
+
+// Simplifies until the index count reaches targetIndexCount or the next collapse would exceed targetError (object space distance).
+// Returns the new index list; resultError receives the largest error that was introduced.
+inline vector<unsigned int> simplifyMesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t targetIndexCount, float targetError, float *resultError = nullptr)
+{
+	vector<unsigned int> result = indices;
+	double maxCost = (double)targetError * (double)targetError;
+	double worst = 0.0;
+	if (resultError)
+		*resultError = 0.0f;
+	if (indices.size() <= targetIndexCount || vertices.empty())
+		return result;
+
+	vector<bool> locked = simplifier::findLockedVertices(vertices, indices);
+
+	// vertex quadrics from the area weighted planes of their triangles
+	vector<Quadric> quadrics(vertices.size(), Quadric::fromPlane(glm::dvec3(0.0), 0.0, 0.0));
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		glm::dvec3 p0 = vertices[indices[i]].Position;
+		glm::dvec3 p1 = vertices[indices[i + 1]].Position;
+		glm::dvec3 p2 = vertices[indices[i + 2]].Position;
+		glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+		double area = glm::length(n);
+		if (area <= 0.0)
+			continue;
+		n /= area;
+		Quadric q = Quadric::fromPlane(n, -glm::dot(n, p0), area * 0.5);
+		for (int c = 0; c < 3; c++)
+			quadrics[indices[i + c]].add(q);
+	}
+
+	vector<unsigned int> remap(vertices.size());
+	vector<bool> touched(vertices.size());
+	vector<unsigned int> offsets;
+	vector<unsigned int> adjacency;
+	vector<simplifier::Collapse> candidates;
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// vertex -> triangle adjacency of the current result
+		offsets.assign(vertices.size() + 1, 0);
+		for (size_t i = 0; i < result.size(); i++)
+			offsets[result[i] + 1]++;
+		for (size_t i = 0; i < vertices.size(); i++)
+			offsets[i + 1] += offsets[i];
+		adjacency.resize(result.size());
+		vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[cursor[result[i]]++] = (unsigned int)(i / 3);
+
+		// every directed edge whose start vertex may move
+		candidates.clear();
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = result[t * 3 + e];
+				unsigned int b = result[t * 3 + (e + 1) % 3];
+				if (!locked[a])
+				{
+					Quadric q = quadrics[a];
+					q.add(quadrics[b]);
+					candidates.push_back({a, b, q.error(vertices[b].Position)});
+				}
+				if (!locked[b])
+				{
+					Quadric q = quadrics[b];
+					q.add(quadrics[a]);
+					candidates.push_back({b, a, q.error(vertices[a].Position)});
+				}
+			}
+		}
+		if (candidates.empty())
+			break;
+		std::sort(candidates.begin(), candidates.end(), [](const simplifier::Collapse &x, const simplifier::Collapse &y) { return x.cost < y.cost; });
+
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			remap[i] = i;
+		std::fill(touched.begin(), touched.end(), false);
+
+		// an interior collapse removes two triangles; stop the pass once the target would be reached
+		size_t removable = (result.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		size_t collapses = 0;
+		for (size_t c = 0; c < candidates.size() && removed < removable; c++)
+		{
+			const simplifier::Collapse &collapse = candidates[c];
+			if (collapse.cost > maxCost)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// reject collapses that would flip or degenerate a surviving triangle
+			bool flips = false;
+			const glm::vec3 &target = vertices[collapse.to].Position;
+			for (unsigned int j = offsets[collapse.from]; j < offsets[collapse.from + 1] && !flips; j++)
+			{
+				const unsigned int *tri = &result[adjacency[j] * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+					continue; // this triangle disappears
+				glm::vec3 p[3];
+				for (int k = 0; k < 3; k++)
+					p[k] = vertices[tri[k]].Position;
+				glm::vec3 before = simplifier::triangleNormal(p[0], p[1], p[2]);
+				for (int k = 0; k < 3; k++)
+					if (tri[k] == collapse.from)
+						p[k] = target;
+				glm::vec3 after = simplifier::triangleNormal(p[0], p[1], p[2]);
+				flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+			}
+			if (flips)
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			worst = std::max(worst, collapse.cost);
+			removed += 2;
+			collapses++;
+
+			// neither end nor the one-ring of the moved vertex may change again in this pass
+			for (unsigned int j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++)
+			{
+				const unsigned int *tri = &result[adjacency[j] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		}
+		if (collapses == 0)
+			break;
+
+		// apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int a = remap[result[t * 3]];
+			unsigned int b = remap[result[t * 3 + 1]];
+			unsigned int c = remap[result[t * 3 + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	if (resultError)
+		*resultError = (float)std::sqrt(worst);
+	return result;
+}
+
+#endif
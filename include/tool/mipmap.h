@@ -0,0 +1,318 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <tool/texture_loader.h>
+#include <tool/ktx.h>
+#include <tool/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAP_USE_SSE 1
+#endif
+
+using namespace std;
+
+// CPU mip chain generation, replacing glGenerateMipmap: the driver filters on the GL thread, with an unspecified
+// (usually box) kernel and, for non sRGB formats, on gamma encoded values, which darkens minified color textures.
+// Here every level is filtered from the previous one in 32 bit float RGBA: sRGB color is converted to linear light
+// first, rows and columns are resampled separately (one SSE register per pixel) and normal maps are renormalized.
+// Finished levels are converted back to 8 bit; loadMippedImage() keeps them in a KTX file next to the image, so later
+// loads only read and upload.
+
+struct MipOptions
+{
+	MipFilter filter = MIP_KAISER;
+	bool srgb = false;			// channels 0-2 are gamma encoded, filter them in linear light
+	bool normalMap = false; // channels 0-2 hold a unit vector mapped to [0, 1], renormalized per level
+	bool wrap = true;				// sample across the edges like GL_REPEAT, otherwise clamp
+};
+
+inline MipOptions mipOptions(const TextureOptions &options)
+{
+	MipOptions result;
+	result.filter = options.mipFilter;
+	result.srgb = options.srgb;
+	result.normalMap = options.normalMap;
+	return result;
+}
+
+namespace mip
+{
+	static const float KAISER_RADIUS = 3.0f; // in destination pixels
+	static const float KAISER_ALPHA = 4.0f;
+	static const int LINEAR_TO_SRGB_SIZE = 16384; // fine enough that the steepest part near black stays below half a step
+
+	inline float srgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	inline float linearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	inline const float *srgbToLinearTable()
+	{
+		static const vector<float> table = [] {
+			vector<float> values(256);
+			for (int i = 0; i < 256; i++)
+				values[i] = srgbToLinear(i / 255.0f);
+			return values;
+		}();
+		return table.data();
+	}
+
+	inline const unsigned char *linearToSrgbTable()
+	{
+		static const vector<unsigned char> table = [] {
+			vector<unsigned char> values(LINEAR_TO_SRGB_SIZE);
+			for (int i = 0; i < LINEAR_TO_SRGB_SIZE; i++)
+				values[i] = (unsigned char)(linearToSrgb(i / (float)(LINEAR_TO_SRGB_SIZE - 1)) * 255.0f + 0.5f);
+			return values;
+		}();
+		return table.data();
+	}
+
+	// zeroth order modified Bessel function of the first kind, the series converges quickly for the alphas used here
+	inline float bessel0(float x)
+	{
+		float sum = 1.0f, term = 1.0f, half = x * 0.5f;
+		for (int k = 1; k < 20; k++)
+		{
+			term *= (half / k) * (half / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	// x in destination pixels from the center of the destination pixel
+	inline float kaiser(float x)
+	{
+		if (fabs(x) >= KAISER_RADIUS)
+			return 0.0f;
+		const float pi = 3.14159265358979f;
+		float sinc = x == 0.0f ? 1.0f : sin(pi * x) / (pi * x);
+		float r = x / KAISER_RADIUS;
+		return sinc * bessel0(KAISER_ALPHA * sqrt(1.0f - r * r)) / bessel0(KAISER_ALPHA);
+	}
+
+	// normalized 1D resampling weights, 'count' source pixels per destination pixel (unused taps have weight 0)
+	struct Taps
+	{
+		int count = 0;
+		vector<int> index;
+		vector<float> weight;
+	};
+
+	inline Taps buildTaps(int source, int destination, MipFilter filter, bool wrap)
+	{
+		Taps taps;
+		float scale = (float)source / destination;
+		float support = filter == MIP_BOX ? scale * 0.5f : KAISER_RADIUS * scale;
+		taps.count = (int)ceil(support * 2.0f) + 1;
+		taps.index.resize((size_t)destination * taps.count);
+		taps.weight.resize((size_t)destination * taps.count);
+		for (int d = 0; d < destination; d++)
+		{
+			// source pixel j covers [j, j + 1]; the destination pixel is centered at (d + 0.5) * scale
+			float center = (d + 0.5f) * scale;
+			int first = (int)floor(center - support);
+			float sum = 0.0f;
+			for (int k = 0; k < taps.count; k++)
+			{
+				int j = first + k;
+				float weight;
+				if (filter == MIP_BOX)
+					weight = std::max(0.0f, std::min(j + 1.0f, center + support) - std::max((float)j, center - support));
+				else
+					weight = kaiser((j + 0.5f - center) / scale);
+				taps.index[d * taps.count + k] = wrap ? ((j % source) + source) % source : std::min(std::max(j, 0), source - 1);
+				taps.weight[d * taps.count + k] = weight;
+				sum += weight;
+			}
+			for (int k = 0; k < taps.count; k++)
+				taps.weight[d * taps.count + k] /= sum;
+		}
+		return taps;
+	}
+
+	// out[0..3] += weight * in[0..3]
+	inline void accumulate(float *out, const float *in, float weight)
+	{
+#ifdef MIPMAP_USE_SSE
+		_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(_mm_loadu_ps(in), _mm_set1_ps(weight))));
+#else
+		for (int c = 0; c < 4; c++)
+			out[c] += in[c] * weight;
+#endif
+	}
+
+	// width x height to destinationWidth x height
+	inline void filterRows(const float *source, int width, int height, const Taps &taps, float *destination, int destinationWidth)
+	{
+		parallelFor(height, 16, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++)
+			{
+				const float *row = source + y * width * 4;
+				float *out = destination + y * destinationWidth * 4;
+				for (int x = 0; x < destinationWidth; x++)
+				{
+					float *pixel = out + x * 4;
+					pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0.0f;
+					const int *index = &taps.index[x * taps.count];
+					const float *weight = &taps.weight[x * taps.count];
+					for (int k = 0; k < taps.count; k++)
+						accumulate(pixel, row + index[k] * 4, weight[k]);
+				}
+			}
+		});
+	}
+
+	// width x height to width x destinationHeight, a whole source row at a time
+	inline void filterColumns(const float *source, int width, const Taps &taps, float *destination, int destinationHeight)
+	{
+		parallelFor(destinationHeight, 8, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++)
+			{
+				float *out = destination + y * width * 4;
+				std::fill(out, out + width * 4, 0.0f);
+				for (int k = 0; k < taps.count; k++)
+				{
+					float weight = taps.weight[y * taps.count + k];
+					if (weight == 0.0f)
+						continue;
+					const float *row = source + (size_t)taps.index[y * taps.count + k] * width * 4;
+					for (int x = 0; x < width; x++)
+						accumulate(out + x * 4, row + x * 4, weight);
+				}
+			}
+		});
+	}
+
+	inline vector<float> toFloat(const unsigned char *pixels, int width, int height, int components, bool srgb)
+	{
+		vector<float> result((size_t)width * height * 4);
+		const float *linear = srgbToLinearTable();
+		parallelFor(height, 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin * width; i < end * width; i++)
+			{
+				float *out = &result[i * 4];
+				const unsigned char *in = pixels + i * components;
+				out[0] = out[1] = out[2] = 0.0f;
+				out[3] = 1.0f;
+				for (int c = 0; c < components; c++)
+					out[c] = srgb && c < 3 ? linear[in[c]] : in[c] / 255.0f;
+			}
+		});
+		return result;
+	}
+
+	inline vector<unsigned char> toBytes(const float *pixels, int width, int height, int components, bool srgb)
+	{
+		vector<unsigned char> result((size_t)width * height * components);
+		const unsigned char *encode = linearToSrgbTable();
+		parallelFor(height, 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin * width; i < end * width; i++)
+				for (int c = 0; c < components; c++)
+				{
+					// the Kaiser lobes overshoot near edges
+					float value = std::min(std::max(pixels[i * 4 + c], 0.0f), 1.0f);
+					result[i * components + c] = srgb && c < 3 ? encode[(int)(value * (LINEAR_TO_SRGB_SIZE - 1) + 0.5f)] : (unsigned char)(value * 255.0f + 0.5f);
+				}
+		});
+		return result;
+	}
+
+	// filtered normals get shorter, keep them unit length so lighting does not darken with distance
+	inline void renormalize(float *pixels, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float *p = pixels + i * 4;
+			float x = p[0] * 2.0f - 1.0f, y = p[1] * 2.0f - 1.0f, z = p[2] * 2.0f - 1.0f;
+			float length = sqrt(x * x + y * y + z * z);
+			if (length < 1e-5f)
+				continue;
+			p[0] = x / length * 0.5f + 0.5f;
+			p[1] = y / length * 0.5f + 0.5f;
+			p[2] = z / length * 0.5f + 0.5f;
+		}
+	}
+}
+
+// mip levels 1 to n (down to 1x1) of an 8 bit image, with its component count. Each dimension halves, rounding down;
+// odd sizes are resampled rather than folded, so every source pixel keeps its weight.
+inline vector<ImageLevel> generateMips(const unsigned char *pixels, int width, int height, int components, const MipOptions &options)
+{
+	vector<ImageLevel> levels;
+	bool srgb = options.srgb && components >= 3;
+	bool normalMap = options.normalMap && components >= 3;
+	vector<float> current = mip::toFloat(pixels, width, height, components, srgb), rows, next;
+	while (width > 1 || height > 1)
+	{
+		int nextWidth = std::max(1, width / 2), nextHeight = std::max(1, height / 2);
+		mip::Taps horizontal = mip::buildTaps(width, nextWidth, options.filter, options.wrap);
+		mip::Taps vertical = mip::buildTaps(height, nextHeight, options.filter, options.wrap);
+		rows.resize((size_t)nextWidth * height * 4);
+		next.resize((size_t)nextWidth * nextHeight * 4);
+		mip::filterRows(current.data(), width, height, horizontal, rows.data(), nextWidth);
+		mip::filterColumns(rows.data(), nextWidth, vertical, next.data(), nextHeight);
+		if (normalMap)
+			mip::renormalize(next.data(), (size_t)nextWidth * nextHeight);
+		levels.push_back({nextWidth, nextHeight, mip::toBytes(next.data(), nextWidth, nextHeight, components, srgb)});
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return levels;
+}
+
+// moves the stb_image pixels into levels[0] and appends the generated chain
+inline void buildMipChain(DecodedImage &image, const MipOptions &options)
+{
+	if (!image.data)
+		return;
+	image.levels.clear();
+	image.levels.push_back({image.width, image.height, vector<unsigned char>(image.data, image.data + image.size())});
+	vector<ImageLevel> mips = generateMips(image.data, image.width, image.height, image.components, options);
+	for (unsigned int i = 0; i < mips.size(); i++)
+		image.levels.push_back(std::move(mips[i]));
+	image.srgb = options.srgb && image.components >= 3;
+	freeImage(image);
+}
+
+// describes how the levels were built, stored in the KTX files so a change of filter rebuilds them
+inline string mipTag(const TextureOptions &options)
+{
+	return string(options.mipFilter == MIP_BOX ? "box" : "kaiser") + (options.srgb ? " srgb" : "") + (options.normalMap ? " normal" : "");
+}
+
+// decode-or-reuse for uncompressed textures: reads "<filename>.mips[f][s].ktx" when it is up to date, otherwise decodes,
+// builds the mip chain and writes it. Plain CPU work, safe on worker threads.
+inline DecodedImage loadMippedImage(const string &filename, const TextureOptions &options)
+{
+	DecodedImage image;
+	auto start = chrono::steady_clock::now();
+	string cachePath = ktx::cachePath(filename, "mips", options.flipVertically, options.srgb);
+	if (!ktx::read(cachePath, filename, mipTag(options), image))
+	{
+		image = decodeImage(filename, options.flipVertically);
+		if (!image.data)
+			return image;
+		buildMipChain(image, mipOptions(options));
+		if (!ktx::write(cachePath, filename, mipTag(options), image))
+			cout << "ERROR::KTX:: could not write cache for " << filename << endl;
+	}
+	image.decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return image;
+}
+
+#endif
@@ -6,7 +6,15 @@
 #include <assimp/postprocess.h>
 #include <tool\mesh.h>
 #include <tool\shader.h>
-#include <tool\stb_image.h>
+#include <tool\camera.h>
+#include <tool\mesh_optimizer.h>
+#include <tool\mesh_cache.h>
+#include <tool\texture_loader.h>
+#include <tool\texture_array.h>
+#include <tool\scene_graph.h>
+#include <tool\animation.h>
+#include <tool\obj_loader.h>
+#include <tool\thread_pool.h>
 
 #include <string>
 #include <fstream>
@@ -14,29 +22,396 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <memory>
 using namespace std;
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+
+// How much GPU upload work a streaming load may do in one frame. At least one upload is always allowed,
+// so a single item larger than the budget still makes progress.
+struct UploadBudget
+{
+	size_t bytes;
+	double milliseconds;
+	size_t spentBytes = 0;
+	unsigned int uploads = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	UploadBudget(size_t bytes = 8 * 1024 * 1024, double milliseconds = 4.0) : bytes(bytes), milliseconds(milliseconds) {}
+
+	static UploadBudget unlimited()
+	{
+		return UploadBudget((size_t)-1, 1e30);
+	}
+
+	bool allows() const
+	{
+		return uploads == 0 || (spentBytes < bytes && chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() < milliseconds);
+	}
+
+	void spend(size_t uploadBytes)
+	{
+		spentBytes += uploadBytes;
+		uploads++;
+	}
+};
+
 class Model
 {
 public:
-	vector<Texture> textures_loaded; // stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
 	vector<Mesh> meshes;
 	string directory;
-	bool gammaCorrection;
+	bool gammaCorrection; // diffuse maps are sRGB: SRGB8(_ALPHA8) or sRGB block formats, mips filtered in linear light
+	bool packedVertices; // upload meshes in the compact layout from geometry/PackedVertex.h
+	bool compressedTextures; // BC1/BC3/BC7 color and BC5 normal maps, cached as KTX next to the images (tool/texture_compress.h)
+	bool arrayTextures;			 // textures packed into one array per slot, small ones atlased (tool/texture_array.h)
+	vector<array<TextureArray, TEXTURE_SLOTS>> textureArrays; // [0] is shared by most meshes, see Mesh::textureArraySet
+	SceneGraph sceneGraph; // Assimp's node hierarchy; move nodes with sceneGraph.setLocal, meshes are placed by Mesh::sceneNodes
+	BoundingBox boundingBox; // union of the mesh bounds placed by their nodes, object space
+	BoundingSphere boundingSphere;
+	Skeleton skeleton;									// bones of the skinned meshes over the scene graph nodes, empty if nothing is skinned
+	vector<AnimationClip> animations;		// Assimp's animations of the skeleton, resampled (tool/animation.h)
+	MeshOptimizeReport cacheReport; // triangle weighted vertex cache statistics of all meshes, before and after optimizeMesh
 
-	Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+	Model(string const &path, bool gamma = false, bool packed = false, bool compressed = false, bool arrays = false) : Model(gamma, packed, compressed, arrays)
 	{
 		loadModel(path);
 	}
 
-	void Draw(Shader &shader)
+	// Starts loading on the thread pool and returns at once: Assimp import (or the mesh cache), optimisation, LODs and
+	// texture decodes all run on workers. streamUploads() then moves the results to the GPU a few per frame; meanwhile
+	// 'meshes' only holds what is uploaded, drawn with single texel placeholders until the real textures arrive.
+	static shared_ptr<Model> loadAsync(string const &path, bool gamma = false, bool packed = false, bool compressed = false, bool arrays = false)
+	{
+		shared_ptr<Model> model(new Model(gamma, packed, compressed, arrays));
+		model->sourcePath = path;
+		model->directory = path.substr(0, path.find_last_of('/'));
+		model->streaming = true;
+		// the job keeps the model alive until the import finished, even if the caller drops it
+		model->importJob = ThreadPool::global().submit([model]() {
+			if (!*model->cancelled)
+				model->importMeshes(model->sourcePath, true);
+			model->importDone = true;
+		});
+		return model;
+	}
+
+	// GL thread: stops an async load. Queued import and decode jobs are skipped; the call waits for the ones already
+	// running, so no job touches the model or the texture cache afterwards. The model stays partially loaded.
+	void cancelLoading()
+	{
+		*cancelled = true;
+		if (importJob.valid())
+			importJob.wait();
+		for (auto it = decodes.begin(); it != decodes.end(); ++it)
+			if (it->second.valid())
+				it->second.wait();
+		for (unsigned int i = 0; i < pendingTextures.size(); i++)
+			if (pendingTextures[i].image.valid())
+				pendingTextures[i].image.wait();
+	}
+
+	bool isLoaded() const
+	{
+		return !streaming;
+	}
+
+	// GL thread, once per frame: uploads finished meshes and decoded textures of an async load within budget.
+	// Returns true once the model is complete.
+	bool streamUploads(UploadBudget &budget)
+	{
+		if (!streaming)
+			return true;
+		if (!importDone)
+			return false;
+
+		uploadStagedMeshes(budget);
+		if (arrayTextures)
+			uploadArrayTextures(&budget, false);
+		for (unsigned int i = 0; i < pendingTextures.size() && budget.allows();)
+		{
+			if (pendingTextures[i].image.wait_for(chrono::seconds(0)) != future_status::ready)
+			{
+				i++;
+				continue;
+			}
+			uploadPendingTexture(pendingTextures[i], &budget);
+			pendingTextures.erase(pendingTextures.begin() + i);
+		}
+		if (nextStagedMesh < stagedMeshes.size() || !pendingTextures.empty() || (arrayTextures && !decodes.empty()))
+			return false;
+
+		releaseUnusedDecodes();
+		printTextureReport(sourcePath, -1.0);
+		streaming = false;
+		return true;
+	}
+
+	// recomputes the world matrices of nodes moved since the last call, and the model bounds with them.
+	// The Draw functions call it too; call it yourself before culling against boundingBox.
+	void updateScene()
 	{
+		if (!meshes.empty() && sceneGraph.needsUpdate())
+			mergeMeshBounds();
+		updateNodeInstances();
+	}
+
+	// node transform of a mesh placed by at most one node, relative to the model
+	glm::mat4 meshMatrix(const Mesh &mesh) const
+	{
+		return mesh.sceneNodes.empty() ? glm::mat4(1.0f) : sceneGraph.world[mesh.sceneNodes[0]];
+	}
+
+	// sets the "model" uniform to model times the node transform of each mesh
+	void Draw(Shader &shader, const glm::mat4 &model = glm::mat4(1.0f))
+	{
+		updateScene();
+		int boundSet = -1;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			bindTextureArrays(shader, meshes[i], boundSet);
+			drawMesh(shader, i, model, 0);
+		}
+	}
+
+	// registers every placement of the meshes into a static batch, with the current node transforms; returns the handles
+	// in mesh order, a shared mesh once per node
+	vector<unsigned int> addTo(GeometryArena &arena, const glm::mat4 &transform = glm::mat4(1.0f))
+	{
+		updateScene();
+		vector<unsigned int> handles;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			if (meshes[i].sceneNodes.size() < 2)
+				handles.push_back(meshes[i].addTo(arena, transform * meshMatrix(meshes[i])));
+			else
+				for (unsigned int n = 0; n < meshes[i].sceneNodes.size(); n++)
+					handles.push_back(meshes[i].addTo(arena, transform * sceneGraph.world[meshes[i].sceneNodes[n]]));
+		}
+		return handles;
+	}
+
+	// draws every mesh once per entry of the instance buffer, see tool/instance_buffer.h for the attribute layout.
+	// The node transform goes to the "nodeMatrix" / "nodeNormalMatrix" uniforms, applied before the instance matrix;
+	// a mesh shared by several nodes is drawn once per node.
+	void DrawInstanced(Shader &shader, const InstanceBuffer &instances)
+	{
+		updateScene();
+		int boundSet = -1;
 		for (unsigned int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shader);
+		{
+			Mesh &mesh = meshes[i];
+			bindTextureArrays(shader, mesh, boundSet);
+			for (unsigned int n = 0; n < std::max<size_t>(mesh.sceneNodes.size(), 1); n++)
+			{
+				glm::mat4 node = mesh.sceneNodes.empty() ? glm::mat4(1.0f) : sceneGraph.world[mesh.sceneNodes[n]];
+				shader.setMat4("nodeMatrix", node);
+				shader.setMat3("nodeNormalMatrix", glm::transpose(glm::inverse(glm::mat3(node))));
+				mesh.DrawInstanced(shader, instances);
+			}
+		}
+	}
+
+	// draws instances.count animated copies of the skinned meshes, one instanced call per mesh: copy i is placed by entry i
+	// of the instance buffer and posed by entry i of the palette (see SkinningPalette), through the shader's "skinned"
+	// switch. Meshes without skin are not drawn.
+	void DrawSkinned(Shader &shader, const InstanceBuffer &instances, const SkinningPalette &palette)
+	{
+		palette.bind(shader);
+		shader.setBool("instanced", true);
+		shader.setBool("skinned", true);
+		shader.setMat4("model", glm::mat4(1.0f));
+		int boundSet = -1;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			if (meshes[i].skin.empty())
+				continue;
+			bindTextureArrays(shader, meshes[i], boundSet);
+			meshes[i].DrawInstanced(shader, instances);
+		}
+		shader.setBool("skinned", false);
+		shader.setBool("instanced", false);
+	}
+
+	// sets the "model" uniform per mesh and draws each at the coarsest LOD whose error projects to at most pixelError pixels;
+	// a shared mesh takes the finest LOD any of its placements needs
+	void Draw(Shader &shader, const Camera &camera, const glm::mat4 &model, float viewportHeight, float pixelError = 1.0f)
+	{
+		updateScene();
+
+		// pixels covered by one world unit at distance 1
+		float pixelsPerUnit = viewportHeight / (2.0f * glm::tan(glm::radians(camera.Zoom) * 0.5f));
+		int boundSet = -1;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			Mesh &mesh = meshes[i];
+			bindTextureArrays(shader, mesh, boundSet);
+			unsigned int lod = mesh.lods.size() - 1;
+			for (unsigned int n = 0; n < std::max<size_t>(mesh.sceneNodes.size(), 1); n++)
+			{
+				glm::mat4 meshModel = model * (mesh.sceneNodes.empty() ? glm::mat4(1.0f) : sceneGraph.world[mesh.sceneNodes[n]]);
+				BoundingSphere sphere = mesh.boundingSphere.transform(meshModel);
+				float scale = mesh.boundingSphere.radius > 0.0f ? sphere.radius / mesh.boundingSphere.radius : 1.0f;
+				float distance = glm::max(glm::length(camera.Position - sphere.center) - sphere.radius, 1e-3f);
+
+				unsigned int placementLod = 0;
+				while (placementLod + 1 < mesh.lods.size() && mesh.lods[placementLod + 1].error * scale * pixelsPerUnit / distance <= pixelError)
+					placementLod++;
+				lod = std::min(lod, placementLod);
+			}
+			drawMesh(shader, i, model, lod);
+		}
+	}
+
+	// binds the texture arrays of a mesh to units 0-3 unless they are bound already; no-op for meshes with 2D textures
+	void bindTextureArrays(Shader &shader, const Mesh &mesh, int &boundSet)
+	{
+		if (mesh.textureArraySet < 0 || mesh.textureArraySet == boundSet)
+			return;
+		boundSet = mesh.textureArraySet;
+		for (int slot = 0; slot < TEXTURE_SLOTS; slot++)
+		{
+			glActiveTexture(GL_TEXTURE0 + slot);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, textureArrays[boundSet][slot].id);
+			shader.setInt(textureArrayUniform(slot), slot);
+		}
+		glActiveTexture(GL_TEXTURE0);
 	}
 
 private:
+	TextureOptions textureOptions;
+	string sourcePath;
+
+	// node matrices of the meshes placed by several nodes, by mesh index; drawn as instances of one call
+	map<unsigned int, InstanceBuffer> nodeInstances;
+	bool nodeInstancesDirty = false;
+
+	// a mesh placed by several nodes is drawn in one instanced call: the shader's "instanced" switch makes it place
+	// vertices with model * instanceModel, and is reset afterwards. Any other mesh gets model times its node transform as "model".
+	void drawMesh(Shader &shader, unsigned int index, const glm::mat4 &model, unsigned int lod)
+	{
+		Mesh &mesh = meshes[index];
+		if (mesh.sceneNodes.size() > 1)
+		{
+			shader.setBool("instanced", true);
+			shader.setMat4("model", model);
+			mesh.DrawInstanced(shader, nodeInstances[index], lod);
+			shader.setBool("instanced", false);
+		}
+		else
+		{
+			shader.setMat4("model", model * meshMatrix(mesh));
+			mesh.Draw(shader, lod);
+		}
+	}
+
+	// GL thread: rewrites the instance buffers of the shared meshes after the scene graph or the mesh list changed
+	void updateNodeInstances()
+	{
+		if (!nodeInstancesDirty)
+			return;
+		nodeInstancesDirty = false;
+		vector<InstanceData> instances;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			const Mesh &mesh = meshes[i];
+			if (mesh.sceneNodes.size() < 2)
+				continue;
+			instances.clear();
+			for (unsigned int n = 0; n < mesh.sceneNodes.size(); n++)
+				instances.push_back(makeInstance(sceneGraph.world[mesh.sceneNodes[n]]));
+			nodeInstances[i].update(instances);
+		}
+	}
+
+	// meshes processed on the CPU but not uploaded yet, see uploadStagedMeshes
+	vector<Mesh> stagedMeshes;
+	unsigned int nextStagedMesh = 0;
+
+	// async loading state; the import worker only writes the staged data before it sets importDone
+	bool streaming = false;
+	atomic<bool> importDone{false};
+	future<void> importJob;
+	// shared with the decode jobs, which may outlive the model
+	shared_ptr<atomic<bool>> cancelled = make_shared<atomic<bool>>(false);
+
+	Model(bool gamma, bool packed, bool compressed, bool arrays) : gammaCorrection(gamma), packedVertices(packed), compressedTextures(compressed), arrayTextures(arrays)
+	{
+		// flipped like the chapters' stbi_set_flip_vertically_on_load(true), which model textures always used to inherit
+		textureOptions.flipVertically = true;
+		textureOptions.compressed = compressed;
+		// the format choice happens on workers, the GL query has to happen here
+		if (compressed)
+			compressionSupport();
+	}
+
+	TextureOptions optionsFor(const string &typeName) const
+	{
+		TextureOptions options = textureOptions;
+		// only diffuse maps hold gamma encoded color, specular / normal / height maps are data
+		options.srgb = gammaCorrection && typeName == "texture_diffuse";
+		options.normalMap = typeName == "texture_normal";
+		return options;
+	}
+
 	void loadModel(string const &path)
+	{
+		// retrieve the directory path of the filepath
+		directory = path.substr(0, path.find_last_of('/'));
+
+		// warm start: the cooked cache skips Assimp, optimisation and LOD generation entirely.
+		// Texture arrays remap the texture coordinates, so they take the copying path of importMeshes
+		if (!arrayTextures && loadFromCache(path))
+		{
+			mergeMeshBounds();
+			finishTextureLoads(path);
+			return;
+		}
+
+		if (!importMeshes(path, arrayTextures))
+			return;
+		UploadBudget budget = UploadBudget::unlimited();
+		uploadStagedMeshes(budget);
+		finishTextureLoads(path);
+	}
+
+	// CPU half of loading, safe on a worker thread: fills stagedMeshes and queues texture decodes, never calls GL.
+	// copyFromCache lets async loads read the mesh cache too; synchronous loads map it in loadFromCache instead.
+	bool importMeshes(string const &path, bool copyFromCache)
+	{
+		if (copyFromCache && stageFromCache(path))
+		{
+			planArrays(path);
+			return true;
+		}
+
+		cacheReport = {{0.0f, 0.0f}, {0.0f, 0.0f}};
+		optimizedTriangles = 0;
+		optimizedVertices = 0;
+		skeleton = Skeleton();
+		animations.clear();
+		// OBJ files take the native reader, Assimp reads everything else and the OBJ files the reader rejects
+		if (!(isObjFile(path) && importObj(path)) && !importAssimp(path))
+			return false;
+		// the cache has no bone data, skinned models are imported every time
+		if (skeleton.empty() && !writeMeshCache(path, stagedMeshes, sceneGraph))
+			cout << "ERROR::MESH_CACHE:: could not write " << meshCachePath(path) << endl;
+
+		if (optimizedTriangles > 0)
+		{
+			cacheReport.before.acmr /= optimizedTriangles;
+			cacheReport.after.acmr /= optimizedTriangles;
+			cacheReport.before.atvr /= optimizedVertices;
+			cacheReport.after.atvr /= optimizedVertices;
+			cout << "MODEL::OPTIMIZE " << path << " ACMR " << cacheReport.before.acmr << " -> " << cacheReport.after.acmr
+					 << ", ATVR " << cacheReport.before.atvr << " -> " << cacheReport.after.atvr << endl;
+		}
+		planArrays(path);
+		return true;
+	}
+
+	bool importAssimp(string const &path)
 	{
 		// read file via ASSIMP
 		Assimp::Importer importer;
@@ -45,32 +420,448 @@ private:
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
 			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+			return false;
+		}
+		processNodes(scene, path);
+		processAnimations(scene, path);
+		return true;
+	}
+
+	// tool/obj_loader.h: same meshes as the Assimp path, with a root node and one child node per OBJ object
+	bool importObj(string const &path)
+	{
+		auto start = chrono::steady_clock::now();
+		ObjScene obj;
+		if (!loadObj(path, obj))
+			return false;
+		double parseMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		sceneGraph.clear();
+		int root = sceneGraph.addNode(-1, glm::mat4(1.0f), path.substr(path.find_last_of('/') + 1));
+		map<string, int> objectNodes;
+		for (unsigned int i = 0; i < obj.meshes.size(); i++)
+			if (objectNodes.find(obj.meshes[i].object) == objectNodes.end())
+				objectNodes[obj.meshes[i].object] = sceneGraph.addNode(root, glm::mat4(1.0f), obj.meshes[i].object);
+
+		for (unsigned int i = 0; i < obj.meshes.size(); i++)
+		{
+			ObjMesh &mesh = obj.meshes[i];
+			vector<Texture> textures;
+			if (mesh.material >= 0)
+			{
+				// the texture order of processMesh: diffuse, specular, normal, height
+				const ObjMaterial &material = obj.materials[mesh.material];
+				const string *maps[4] = {&material.diffuse, &material.specular, &material.normal, &material.height};
+				const char *types[4] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+				for (int t = 0; t < 4; t++)
+					if (!maps[t]->empty())
+						textures.push_back(requestTexture(maps[t]->c_str(), types[t]));
+			}
+			optimizeImported(mesh.vertices, mesh.indices);
+			stagedMeshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), textures, true));
+			stagedMeshes.back().buildLods();
+			stagedMeshes.back().sceneNodes.push_back(objectNodes[mesh.object]);
+		}
+		cout << "MODEL::OBJ " << path << " " << obj.meshes.size() << " meshes, " << obj.positionCount << " positions, read in " << parseMs << " ms" << endl;
+		return true;
+	}
+
+	// builds the meshes from a valid "<path>.meshcache"; vertex and index data go from the mapping straight to glBufferData
+	bool loadFromCache(string const &path)
+	{
+		MeshCacheReader cache;
+		if (!cache.open(path) || !cache.readSceneGraph(sceneGraph))
+			return false;
+
+		for (unsigned int i = 0; i < cache.header->meshCount; i++)
+		{
+			const MeshCacheEntry &entry = cache.entries[i];
+			vector<MeshLod> lods(entry.lods, entry.lods + entry.lodCount);
+			meshes.push_back(Mesh(cache.vertices(entry), entry.vertexCount, cache.indices(entry), entry.indexCount, lods,
+														entry.hasTangents != 0, entry.boundingBox, entry.boundingSphere, cachedTextures(cache, entry)));
+			meshes.back().sceneNodes = cache.sceneNodes(entry);
+			resolveTextures(meshes.back());
+			if (packedVertices)
+				meshes.back().usePackedVertices(vector<Vertex>(cache.vertices(entry), cache.vertices(entry) + entry.vertexCount));
+		}
+		cout << "MODEL::CACHE " << path << " " << meshes.size() << " meshes from " << meshCachePath(path) << endl;
+		return true;
+	}
+
+	// worker side variant of loadFromCache: the mapping does not outlive the job, so the blobs are copied into staged meshes
+	bool stageFromCache(string const &path)
+	{
+		MeshCacheReader cache;
+		if (!cache.open(path) || !cache.readSceneGraph(sceneGraph))
+			return false;
+
+		for (unsigned int i = 0; i < cache.header->meshCount; i++)
+		{
+			const MeshCacheEntry &entry = cache.entries[i];
+			const Vertex *vertices = cache.vertices(entry);
+			const unsigned int *indices = cache.indices(entry);
+			unsigned int fullCount = entry.lods[0].indexCount;
+			stagedMeshes.push_back(Mesh(vector<Vertex>(vertices, vertices + entry.vertexCount), vector<unsigned int>(indices, indices + fullCount),
+																	cachedTextures(cache, entry), true));
+			stagedMeshes.back().lodIndices.assign(indices + fullCount, indices + entry.indexCount);
+			stagedMeshes.back().lods.assign(entry.lods, entry.lods + entry.lodCount);
+			stagedMeshes.back().sceneNodes = cache.sceneNodes(entry);
+		}
+		cout << "MODEL::CACHE " << path << " " << stagedMeshes.size() << " meshes from " << meshCachePath(path) << endl;
+		return true;
+	}
+
+	vector<Texture> cachedTextures(const MeshCacheReader &cache, const MeshCacheEntry &entry)
+	{
+		vector<Texture> textures;
+		for (unsigned int t = 0; t < entry.textureCount; t++)
+		{
+			const MeshCacheTexture &texture = cache.textures[entry.firstTexture + t];
+			textures.push_back(requestTexture(cache.text(texture.pathOffset), cache.text(texture.typeOffset)));
+		}
+		return textures;
+	}
+
+	// GL thread: uploads staged meshes until the budget is used up
+	void uploadStagedMeshes(UploadBudget &budget)
+	{
+		while (nextStagedMesh < stagedMeshes.size() && budget.allows())
+		{
+			Mesh &mesh = stagedMeshes[nextStagedMesh++];
+			budget.spend(mesh.vertices.size() * sizeof(Vertex) + (mesh.indices.size() + mesh.lodIndices.size()) * sizeof(unsigned int));
+			if (!arrayTextures)
+				resolveTextures(mesh);
+			mesh.upload();
+			if (packedVertices)
+				mesh.usePackedVertices();
+			meshes.push_back(std::move(mesh));
+			mergeMeshBounds();
+		}
+		if (nextStagedMesh == stagedMeshes.size())
+		{
+			stagedMeshes.clear();
+			nextStagedMesh = 0;
+		}
+	}
+
+	// union of the mesh bounds at every placement, with the current world matrices of the nodes
+	void mergeMeshBounds()
+	{
+		sceneGraph.update();
+		nodeInstancesDirty = true;
+		vector<glm::mat4> placements;
+		vector<unsigned int> placedMesh;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			if (meshes[i].sceneNodes.empty())
+				placements.push_back(glm::mat4(1.0f));
+			for (unsigned int n = 0; n < meshes[i].sceneNodes.size(); n++)
+				placements.push_back(sceneGraph.world[meshes[i].sceneNodes[n]]);
+			placedMesh.resize(placements.size(), i);
+		}
+		for (unsigned int p = 0; p < placements.size(); p++)
+		{
+			BoundingBox box = meshes[placedMesh[p]].boundingBox.transform(placements[p]);
+			if (p == 0)
+				boundingBox = box;
+			else
+				boundingBox.merge(box);
+		}
+		boundingSphere.center = boundingBox.center();
+		boundingSphere.radius = 0.0f;
+		for (unsigned int p = 0; p < placements.size(); p++)
+		{
+			BoundingSphere sphere = meshes[placedMesh[p]].boundingSphere.transform(placements[p]);
+			boundingSphere.radius = glm::max(boundingSphere.radius, glm::length(sphere.center - boundingSphere.center) + sphere.radius);
+		}
+	}
+
+	// a texture whose GL name is already handed out to meshes while its image is still being decoded on the pool
+	struct PendingTexture
+	{
+		TextureHandle texture;
+		future<DecodedImage> image;
+	};
+	vector<PendingTexture> pendingTextures;
+	// decodes started by the CPU half, by canonical path and options key; resolveTextures claims them
+	map<string, future<DecodedImage>> decodes;
+
+	// totals for the load time breakdown
+	unsigned int texturesUploaded = 0;
+	size_t textureBytes = 0;
+	double textureDecodeMs = 0.0;
+	double textureUploadMs = 0.0;
+
+	void uploadPendingTexture(PendingTexture &pending, UploadBudget *budget)
+	{
+		DecodedImage image = pending.image.get();
+		textureDecodeMs += image.decodeMs;
+
+		auto uploadStart = chrono::steady_clock::now();
+		TextureResource &texture = *pending.texture;
+		if (uploadImage(texture.id, image))
+			textureBytes += image.size();
+		else
+			std::cout << "Texture failed to load at path: " << texture.path << std::endl;
+		TextureCache::global().setUploaded(texture, image);
+		textureUploadMs += chrono::duration<double, milli>(chrono::steady_clock::now() - uploadStart).count();
+		texturesUploaded++;
+		if (budget)
+			budget->spend(image.levels.empty() ? image.size() * 4 / 3 : image.size()); // with the mip chain
+		freeImage(image);
+	}
+
+	// waits for the decode jobs in submission order and uploads each one as soon as it is ready
+	void finishTextureLoads(string const &path)
+	{
+		auto start = chrono::steady_clock::now();
+		if (arrayTextures)
+			uploadArrayTextures(nullptr, true);
+		for (unsigned int i = 0; i < pendingTextures.size(); i++)
+			uploadPendingTexture(pendingTextures[i], nullptr);
+		pendingTextures.clear();
+		releaseUnusedDecodes();
+		printTextureReport(path, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+
+	// where the decodes go in the texture arrays, by decode key
+	TextureArrayPlan arrayPlan;
+
+	// CPU side of the texture arrays, after the meshes are staged: image sizes from the file headers, the packing plan,
+	// and the atlas rects applied to the texture coordinates. The array storage itself is allocated by the first upload.
+	void planArrays(string const &path)
+	{
+		if (!arrayTextures)
 			return;
+		vector<MeshTextureSet> sets(stagedMeshes.size());
+		for (unsigned int m = 0; m < stagedMeshes.size(); m++)
+		{
+			const Mesh &mesh = stagedMeshes[m];
+			MeshTextureSet &set = sets[m];
+			for (unsigned int i = 0; i < mesh.textures.size(); i++)
+			{
+				const Texture &texture = mesh.textures[i];
+				// the shaders sample one texture per slot, like texture_diffuse1 of the 2D path
+				int slot = textureSlot(texture.type);
+				if (slot < 0 || !set.keys[slot].empty())
+					continue;
+				string filename = TextureCache::canonicalPath(this->directory + '/' + texture.path);
+				set.keys[slot] = filename + '|' + optionsFor(texture.type).key();
+				int components;
+				if (!stbi_info(filename.c_str(), &set.width[slot], &set.height[slot], &components))
+					set.width[slot] = set.height[slot] = 0;
+			}
+			set.uvInUnitSquare = true;
+			for (unsigned int i = 0; i < mesh.vertices.size() && set.uvInUnitSquare; i++)
+			{
+				const glm::vec2 &uv = mesh.vertices[i].TexCoords;
+				set.uvInUnitSquare = uv.x >= 0.0f && uv.x <= 1.0f && uv.y >= 0.0f && uv.y <= 1.0f;
+			}
 		}
-		// retrieve the directory path of the filepath
-		directory = path.substr(0, path.find_last_of('/'));
 
-		// process ASSIMP's root node recursively
-		processNode(scene->mRootNode, scene);
+		arrayPlan = planTextureArrays(sets);
+		for (unsigned int m = 0; m < stagedMeshes.size(); m++)
+		{
+			Mesh &mesh = stagedMeshes[m];
+			mesh.textureArraySet = arrayPlan.meshSet[m];
+			mesh.textureLayers = arrayPlan.meshLayers[m];
+			glm::vec4 rect = arrayPlan.meshUvTransform[m];
+			if (rect == glm::vec4(1.0f, 1.0f, 0.0f, 0.0f))
+				continue;
+			for (unsigned int i = 0; i < mesh.vertices.size(); i++)
+				mesh.vertices[i].TexCoords = mesh.vertices[i].TexCoords * glm::vec2(rect.x, rect.y) + glm::vec2(rect.z, rect.w);
+		}
+
+		unsigned int layers = 0;
+		textureArrays.assign(arrayPlan.sets.size(), array<TextureArray, TEXTURE_SLOTS>());
+		for (unsigned int i = 0; i < arrayPlan.sets.size(); i++)
+			for (int slot = 0; slot < TEXTURE_SLOTS; slot++)
+			{
+				const TextureArrayPlan::ArrayShape &shape = arrayPlan.sets[i][slot];
+				if (shape.layers)
+					textureArrays[i][slot] = TextureArray(shape.width, shape.height, shape.layers);
+				layers += shape.layers;
+			}
+		cout << "MODEL::TEXTURE_ARRAYS " << path << " " << layers << " layers of " << arrayPlan.layerWidth << "x" << arrayPlan.layerHeight << ", "
+				 << arrayPlan.atlasTiles << " atlas tiles on " << arrayPlan.atlasPages << " pages, " << arrayPlan.sets.size() - 1 << " meshes with own arrays" << endl;
 	}
 
-	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void processNode(aiNode *node, const aiScene *scene)
+	// GL thread: copies finished decodes into their layers and atlas tiles; with wait it blocks until all of them are done
+	void uploadArrayTextures(UploadBudget *budget, bool wait)
 	{
-		// process each mesh located at the current node
-		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		for (auto it = decodes.begin(); it != decodes.end() && (!budget || budget->allows());)
 		{
+			if (!wait && it->second.wait_for(chrono::seconds(0)) != future_status::ready)
+			{
+				++it;
+				continue;
+			}
+			DecodedImage image = it->second.get();
+			textureDecodeMs += image.decodeMs;
+
+			auto uploadStart = chrono::steady_clock::now();
+			auto destinations = arrayPlan.destinations.find(it->first);
+			if (!image.valid())
+				std::cout << "Texture failed to load at path: " << it->first.substr(0, it->first.find('|')) << std::endl;
+			else if (destinations != arrayPlan.destinations.end())
+			{
+				for (unsigned int i = 0; i < destinations->second.size(); i++)
+				{
+					const TextureDestination &destination = destinations->second[i];
+					TextureArray &target = textureArrays[destination.set][destination.slot];
+					if (!target.compatible(image) || (!destination.tile && (image.width != target.width || image.height != target.height)))
+					{
+						cout << "ERROR::TEXTURE_ARRAY:: " << it->first << " does not match the format or size of its array" << endl;
+						continue;
+					}
+					if (!target.allocated())
+						target.allocate(image);
+					if (destination.tile)
+						target.uploadTile(destination.layer, destination.x, destination.y, image);
+					else
+						target.uploadLayer(destination.layer, image);
+				}
+				textureBytes += image.size();
+				texturesUploaded++;
+			}
+			textureUploadMs += chrono::duration<double, milli>(chrono::steady_clock::now() - uploadStart).count();
+			if (budget)
+				budget->spend(image.size());
+			freeImage(image);
+			it = decodes.erase(it);
+		}
+	}
+
+	// decodes of textures another model uploaded in the meantime
+	void releaseUnusedDecodes()
+	{
+		for (auto it = decodes.begin(); it != decodes.end(); ++it)
+		{
+			DecodedImage image = it->second.get();
+			freeImage(image);
+		}
+		decodes.clear();
+	}
+
+	void printTextureReport(string const &path, double waitMs)
+	{
+		if (texturesUploaded == 0)
+			return;
+		// decode time is summed over the workers, so it can exceed the wall clock time
+		cout << "MODEL::TEXTURES " << path << " " << texturesUploaded << " textures, " << textureBytes / (1024 * 1024) << " MB, decode "
+				 << textureDecodeMs << " ms on " << ThreadPool::global().size() << " workers, upload " << textureUploadMs << " ms";
+		if (waitMs >= 0.0)
+			cout << ", wait + upload " << waitMs << " ms";
+		cout << endl;
+		TextureCache::global().printStatistics();
+	}
+
+	// running totals for cacheReport while the scene is processed
+	float optimizedTriangles;
+	float optimizedVertices;
+
+	// walks the node tree breadth first, the order SceneGraph stores it in: each node becomes a scene graph node with its
+	// local transform. Each aiMesh is processed once, at its first reference; every node referencing it is added to its sceneNodes.
+	void processNodes(const aiScene *scene, const string &path)
+	{
+		sceneGraph.clear();
+		map<unsigned int, unsigned int> stagedIndex; // aiMesh index -> stagedMeshes
+		unsigned int references = 0;
+		vector<pair<const aiNode *, int>> queue = {{scene->mRootNode, -1}};
+		for (size_t q = 0; q < queue.size(); q++)
+		{
+			const aiNode *node = queue[q].first;
+			int index = sceneGraph.addNode(queue[q].second, toMat4(node->mTransformation), node->mName.C_Str());
 			// the node object only contains indices to index the actual objects in the scene.
 			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-			aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			for (unsigned int i = 0; i < node->mNumMeshes; i++)
+			{
+				references++;
+				auto processed = stagedIndex.find(node->mMeshes[i]);
+				if (processed != stagedIndex.end())
+				{
+					stagedMeshes[processed->second].sceneNodes.push_back(index);
+					continue;
+				}
+				aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
+				stagedIndex[node->mMeshes[i]] = (unsigned int)stagedMeshes.size();
+				stagedMeshes.push_back(processMesh(mesh, scene));
+				stagedMeshes.back().buildLods();
+				stagedMeshes.back().sceneNodes.push_back(index);
+			}
+			for (unsigned int i = 0; i < node->mNumChildren; i++)
+				queue.push_back({node->mChildren[i], index});
 		}
-		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-		for (unsigned int i = 0; i < node->mNumChildren; i++)
+		if (references > stagedMeshes.size())
+			cout << "MODEL::INSTANCING " << path << " " << references << " mesh references share " << stagedMeshes.size() << " meshes" << endl;
+		// processMesh collected the bones by name; their nodes are known now
+		if (!skeleton.boneName.empty())
+			skeleton.setJoints(sceneGraph);
+	}
+
+	// aiMatrix4x4 is row major, glm takes columns
+	static glm::mat4 toMat4(const aiMatrix4x4 &m)
+	{
+		return glm::mat4(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3, m.c3, m.d3, m.a4, m.b4, m.c4, m.d4);
+	}
+
+	// resamples the animations of the skeleton's joints into clips; channels of other nodes are dropped
+	void processAnimations(const aiScene *scene, const string &path)
+	{
+		if (skeleton.empty())
+			return;
+		for (unsigned int a = 0; a < scene->mNumAnimations; a++)
 		{
-			processNode(node->mChildren[i], scene);
+			const aiAnimation *animation = scene->mAnimations[a];
+			double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+			vector<JointKeys> tracks;
+			for (unsigned int c = 0; c < animation->mNumChannels; c++)
+			{
+				const aiNodeAnim *channel = animation->mChannels[c];
+				JointKeys keys;
+				keys.joint = sceneGraph.find(channel->mNodeName.C_Str());
+				if (keys.joint < 0)
+					continue;
+				for (unsigned int k = 0; k < channel->mNumPositionKeys; k++)
+				{
+					const aiVectorKey &key = channel->mPositionKeys[k];
+					keys.positionTimes.push_back((float)(key.mTime / ticksPerSecond));
+					keys.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+				}
+				for (unsigned int k = 0; k < channel->mNumRotationKeys; k++)
+				{
+					const aiQuatKey &key = channel->mRotationKeys[k];
+					keys.rotationTimes.push_back((float)(key.mTime / ticksPerSecond));
+					keys.rotations.push_back(glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+				}
+				for (unsigned int k = 0; k < channel->mNumScalingKeys; k++)
+				{
+					const aiVectorKey &key = channel->mScalingKeys[k];
+					keys.scaleTimes.push_back((float)(key.mTime / ticksPerSecond));
+					keys.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+				}
+				tracks.push_back(std::move(keys));
+			}
+			animations.push_back(AnimationClip());
+			animations.back().build(skeleton, animation->mName.C_Str(), (float)(animation->mDuration / ticksPerSecond), tracks);
 		}
+		cout << "MODEL::ANIMATION " << path << " " << skeleton.boneCount() << " bones on " << skeleton.jointCount() << " joints, "
+				 << animations.size() << " clips" << endl;
 	}
+	// reorder for the post-transform cache, overdraw and vertex fetch, and add the result to cacheReport.
+	// remap receives the new index of every old vertex, see optimizeVertexFetch
+	void optimizeImported(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<unsigned int> *remap = nullptr)
+	{
+		MeshOptimizeReport report = optimizeMesh(vertices, indices, remap);
+		float triangles = indices.size() / 3.0f;
+		cacheReport.before.acmr += report.before.acmr * triangles;
+		cacheReport.after.acmr += report.after.acmr * triangles;
+		cacheReport.before.atvr += report.before.atvr * vertices.size();
+		cacheReport.after.atvr += report.after.atvr * vertices.size();
+		optimizedTriangles += triangles;
+		optimizedVertices += vertices.size();
+	}
+
 	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
 	{
 		// data to fill
@@ -81,7 +872,7 @@ private:
 		// walk through each of the mesh's vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
-			Vertex vertex;
+			Vertex vertex = {};
 			glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
 												// positions
 			vector.x = mesh->mVertices[i].x;
@@ -105,16 +896,19 @@ private:
 				vec.x = mesh->mTextureCoords[0][i].x;
 				vec.y = mesh->mTextureCoords[0][i].y;
 				vertex.TexCoords = vec;
-				// tangent
-				vector.x = mesh->mTangents[i].x;
-				vector.y = mesh->mTangents[i].y;
-				vector.z = mesh->mTangents[i].z;
-				vertex.Tangent = vector;
-				// bitangent
-				vector.x = mesh->mBitangents[i].x;
-				vector.y = mesh->mBitangents[i].y;
-				vector.z = mesh->mBitangents[i].z;
-				vertex.Bitangent = vector;
+				if (mesh->HasTangentsAndBitangents())
+				{
+					// tangent
+					vector.x = mesh->mTangents[i].x;
+					vector.y = mesh->mTangents[i].y;
+					vector.z = mesh->mTangents[i].z;
+					vertex.Tangent = vector;
+					// bitangent
+					vector.x = mesh->mBitangents[i].x;
+					vector.y = mesh->mBitangents[i].y;
+					vector.z = mesh->mBitangents[i].z;
+					vertex.Bitangent = vector;
+				}
 			}
 			else
 				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
@@ -129,6 +923,18 @@ private:
 			for (unsigned int j = 0; j < face.mNumIndices; j++)
 				indices.push_back(face.mIndices[j]);
 		}
+		// bone weights, by vertex; the palette index of a bone is its position in the model wide bone list
+		vector<SkinInfluences> influences(mesh->HasBones() ? mesh->mNumVertices : 0);
+		for (unsigned int b = 0; b < mesh->mNumBones; b++)
+		{
+			const aiBone *bone = mesh->mBones[b];
+			unsigned int index = skeleton.addBone(bone->mName.C_Str(), toMat4(bone->mOffsetMatrix));
+			for (unsigned int w = 0; w < bone->mNumWeights; w++)
+				if (bone->mWeights[w].mVertexId < influences.size())
+					influences[bone->mWeights[w].mVertexId].add(index, bone->mWeights[w].mWeight);
+		}
+		vector<unsigned int> remap;
+		optimizeImported(vertices, indices, influences.empty() ? nullptr : &remap);
 		// process materials
 		aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 		// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -152,7 +958,15 @@ private:
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 		// return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		Mesh result(vertices, indices, textures, true);
+		if (!influences.empty())
+		{
+			result.skin.resize(result.vertices.size());
+			for (unsigned int i = 0; i < remap.size(); i++)
+				if (remap[i] != ~0u)
+					result.skin[remap[i]] = influences[i].pack();
+		}
+		return result;
 	}
 
 	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
@@ -162,69 +976,132 @@ private:
 		{
 			aiString str;
 			mat->GetTexture(type, i, &str);
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
+			textures.push_back(requestTexture(str.C_Str(), typeName));
+		}
+		return textures;
+	}
+
+	// CPU side: a texture reference without a GL name yet; the decode starts right away unless the cache already has the texture
+	Texture requestTexture(const char *path, const string &typeName)
+	{
+		Texture texture;
+		texture.id = 0;
+		texture.type = typeName;
+		texture.path = path;
+
+		string filename = TextureCache::canonicalPath(this->directory + '/' + texture.path);
+		TextureOptions options = optionsFor(typeName);
+		string key = filename + '|' + options.key();
+		// arrays copy the texels, so they need the decode even if a 2D texture of the image is cached
+		if (decodes.find(key) == decodes.end() && (arrayTextures || !TextureCache::global().contains(filename, options)))
+			decodes[key] = submitDecode(filename, options);
+		return texture;
+	}
+
+	// GL side: binds the references of a mesh to cached textures. Textures shared with other models (or referenced twice by this one)
+	// come back from the cache uploaded or queued; new ones show a placeholder texel until their decode is uploaded.
+	void resolveTextures(Mesh &mesh)
+	{
+		for (unsigned int i = 0; i < mesh.textures.size(); i++)
+		{
+			Texture &texture = mesh.textures[i];
+			if (texture.handle)
+				continue;
+			bool created;
+			TextureOptions options = optionsFor(texture.type);
+			texture.handle = TextureCache::global().acquire(this->directory + '/' + texture.path, options, &created);
+			texture.id = texture.handle->id;
+			if (!created)
+				continue;
+
+			uploadPlaceholder(texture.id, placeholderTexel(texture.type));
+			PendingTexture pending;
+			pending.texture = texture.handle;
+			auto decode = decodes.find(texture.handle->path + '|' + options.key());
+			if (decode != decodes.end())
 			{
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
+				pending.image = std::move(decode->second);
+				decodes.erase(decode);
 			}
-			if (!skip)
-			{ // if texture hasn't been loaded already, load it
-				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
-				texture.type = typeName;
-				texture.path = str.C_Str();
-				textures.push_back(texture);
-				textures_loaded.push_back(texture); // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+			else
+			{
+				string filename = texture.handle->path;
+				pending.image = submitDecode(filename, options);
 			}
+			pendingTextures.push_back(std::move(pending));
 		}
-		return textures;
+		mesh.invalidateMaterial();
 	}
-};
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
-{
-	string filename = string(path);
-	filename = directory + '/' + filename;
+	// decode job on the pool, skipped once the load is cancelled
+	future<DecodedImage> submitDecode(const string &filename, const TextureOptions &options)
+	{
+		shared_ptr<atomic<bool>> cancelled = this->cancelled;
+		return ThreadPool::global().submit([filename, options, cancelled]() {
+			if (*cancelled)
+				return DecodedImage();
+			return TextureCache::loadImage(filename, options);
+		});
+	}
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	// neutral values: grey albedo, no specular, flat normal, no displacement
+	static const unsigned char *placeholderTexel(const string &type)
+	{
+		static const unsigned char diffuse[4] = {128, 128, 128, 255};
+		static const unsigned char normal[4] = {128, 128, 255, 255};
+		static const unsigned char black[4] = {0, 0, 0, 255};
+		if (type == "texture_diffuse")
+			return diffuse;
+		if (type == "texture_normal")
+			return normal;
+		return black;
+	}
+
+};
 
-	int width, height, nrComponents;
-	unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
+// Owns the models that are still streaming in and advances them once per frame.
+class ModelStreamer
+{
+public:
+	~ModelStreamer()
 	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
+		cancel();
+	}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+	// stops the loads still in progress (see Model::cancelLoading); call before the texture cache shuts down
+	void cancel()
+	{
+		for (unsigned int i = 0; i < loading.size(); i++)
+			loading[i]->cancelLoading();
+		loading.clear();
+	}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	shared_ptr<Model> load(string const &path, bool gamma = false, bool packed = false, bool compressed = false, bool arrays = false)
+	{
+		shared_ptr<Model> model = Model::loadAsync(path, gamma, packed, compressed, arrays);
+		loading.push_back(model);
+		return model;
+	}
 
-		stbi_image_free(data);
+	// call once per frame on the GL thread; the budget is shared by all loading models
+	void update(UploadBudget budget = UploadBudget())
+	{
+		for (unsigned int i = 0; i < loading.size();)
+		{
+			if (loading[i]->streamUploads(budget))
+				loading.erase(loading.begin() + i);
+			else
+				i++;
+		}
 	}
-	else
+
+	unsigned int pending() const
 	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+		return (unsigned int)loading.size();
 	}
 
-	return textureID;
-}
+private:
+	vector<shared_ptr<Model>> loading;
+};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,639 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <geometry/Vertex.h>
+#include <geometry/Tangents.h>
+#include <tool/mapped_file.h>
+#include <tool/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Native Wavefront OBJ / MTL reader, the fast path of Model for the formats in static/model.
+// The file is mapped and cut into line aligned chunks that are parsed in parallel with a hand written number parser.
+// Faces are then grouped into one mesh per object and material, each built on its own job: v/vt/vn tuples are
+// deduplicated with a hash table, polygons are fanned into triangles, V is flipped, normals are generated when the
+// file has none and tangents are computed, matching Model's Assimp flags. Statements the reader does not support
+// (curves, lines, points, ...) make loadObj fail, so the caller can fall back to Assimp.
+
+struct ObjMaterial
+{
+	string name;
+	// texture paths as written in the MTL file, relative to the model directory
+	string diffuse;	 // map_Kd
+	string specular; // map_Ks
+	string normal;	 // map_Bump / bump, Assimp's aiTextureType_HEIGHT
+	string height;	 // map_Ka, Assimp's aiTextureType_AMBIENT
+};
+
+struct ObjMesh
+{
+	string object;		// name of the 'o' / 'g' statement the faces belong to
+	int material = -1; // into ObjScene::materials, -1 without usemtl or for unknown names
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	bool hasTexCoords = false;
+};
+
+struct ObjScene
+{
+	vector<ObjMesh> meshes; // in order of first appearance
+	vector<ObjMaterial> materials;
+	unsigned int positionCount = 0;
+	unsigned int texCoordCount = 0;
+	unsigned int normalCount = 0;
+};
+
+namespace obj
+{
+	// chunks smaller than this are not worth a job
+	const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline const char *skipBlanks(const char *p, const char *end)
+	{
+		while (p < end && isBlank(*p))
+			p++;
+		return p;
+	}
+
+	inline double powerOfTen(int exponent)
+	{
+		// exact up to 1e22, so one multiply or divide rounds correctly for up to 15 significant digits
+		static const double powers[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+																			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+		return exponent <= 22 ? powers[exponent] : std::pow(10.0, exponent);
+	}
+
+	// [+-]digits[.digits][(e|E)[+-]digits] without locale or allocation; returns the end of the number, nullptr if there is none
+	inline const char *parseFloat(const char *p, const char *end, float &value)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+		uint64_t mantissa = 0;
+		int digits = 0, exponent = 0;
+		bool any = false;
+		for (; p < end && *p >= '0' && *p <= '9'; p++, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+			}
+			else
+				exponent++;
+		}
+		if (p < end && *p == '.')
+			for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true)
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					digits += mantissa != 0;
+					exponent--;
+				}
+		if (!any)
+			return nullptr;
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char *q = p + 1;
+			bool negativeExponent = false;
+			if (q < end && (*q == '-' || *q == '+'))
+				negativeExponent = *q++ == '-';
+			if (q < end && *q >= '0' && *q <= '9')
+			{
+				int e = 0;
+				for (; q < end && *q >= '0' && *q <= '9'; q++)
+					e = std::min(e * 10 + (*q - '0'), 10000);
+				exponent += negativeExponent ? -e : e;
+				p = q;
+			}
+		}
+		double number = (double)mantissa;
+		number = exponent < 0 ? number / powerOfTen(-exponent) : number * powerOfTen(exponent);
+		value = (float)(negative ? -number : number);
+		return p;
+	}
+
+	inline const char *parseInt(const char *p, const char *end, int &value)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+		if (p >= end || *p < '0' || *p > '9')
+			return nullptr;
+		int64_t number = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+			number = std::min<int64_t>(number * 10 + (*p - '0'), INT32_MAX);
+		value = (int)(negative ? -number : number);
+		return p;
+	}
+
+	// an object, group or material change before face 'face' of a chunk
+	struct Switch
+	{
+		unsigned int face;
+		bool material; // usemtl, otherwise o / g
+		string name;
+	};
+
+	// what one chunk of lines contributed
+	struct Chunk
+	{
+		vector<glm::vec3> positions;
+		vector<glm::vec2> texCoords;
+		vector<glm::vec3> normals;
+		// v, vt, vn of each face corner: 0 based, -1 when missing. Negative OBJ indices are stored relative to the
+		// chunk's first element and listed in 'relative' until the chunk bases are known.
+		vector<int> corners;
+		vector<unsigned int> relative;
+		vector<unsigned int> faceStart; // first corner of each face, plus one past the last
+		vector<Switch> switches;
+		vector<string> materialLibraries;
+		string error;
+	};
+
+	inline string lineText(const char *line, const char *end)
+	{
+		const char *stop = line;
+		while (stop < end && *stop != '\n' && *stop != '\r')
+			stop++;
+		return string(line, stop);
+	}
+
+	// the rest of the line without surrounding blanks
+	inline string restOfLine(const char *p, const char *end)
+	{
+		p = skipBlanks(p, end);
+		const char *stop = p;
+		while (stop < end && *stop != '\n')
+			stop++;
+		while (stop > p && isBlank(stop[-1]))
+			stop--;
+		return string(p, stop);
+	}
+
+	inline const char *parseFloats(const char *p, const char *end, float *values, int required, int optional)
+	{
+		for (int i = 0; i < required + optional; i++)
+		{
+			p = skipBlanks(p, end);
+			const char *next = parseFloat(p, end, values[i]);
+			if (!next)
+				return i < required ? nullptr : p;
+			p = next;
+		}
+		return p;
+	}
+
+	// one corner "v", "v/vt", "v//vn" or "v/vt/vn"
+	inline const char *parseCorner(const char *p, const char *end, Chunk &chunk)
+	{
+		int counts[3] = {(int)chunk.positions.size(), (int)chunk.texCoords.size(), (int)chunk.normals.size()};
+		for (int component = 0; component < 3; component++)
+		{
+			int index = 0;
+			const char *next = component == 0 || (p < end && *p != '/' && !isBlank(*p) && *p != '\n') ? parseInt(p, end, index) : p;
+			if (!next || (component == 0 && index == 0))
+				return nullptr;
+			p = next;
+			if (index > 0)
+				chunk.corners.push_back(index - 1);
+			else if (index < 0)
+			{
+				chunk.relative.push_back((unsigned int)chunk.corners.size());
+				chunk.corners.push_back(counts[component] + index);
+			}
+			else
+				chunk.corners.push_back(-1);
+			if (component < 2)
+			{
+				if (p < end && *p == '/')
+					p++;
+				else
+				{
+					// the remaining components are missing
+					for (int missing = component + 1; missing < 3; missing++)
+						chunk.corners.push_back(-1);
+					return p;
+				}
+			}
+		}
+		return p;
+	}
+
+	inline bool keyword(const char *p, const char *end, const char *word, size_t length)
+	{
+		return (size_t)(end - p) >= length && memcmp(p, word, length) == 0 && ((size_t)(end - p) == length || isBlank(p[length]) || p[length] == '\n');
+	}
+
+	// parses the lines of [begin, end); stops at the first error
+	inline void parseChunk(const char *begin, const char *end, Chunk &chunk)
+	{
+		const char *p = begin;
+		while (p < end)
+		{
+			const char *line = p = skipBlanks(p, end);
+			bool ok = true;
+			if (p >= end || *p == '\n' || *p == '#')
+			{
+			}
+			else if (keyword(p, end, "v", 1))
+			{
+				float values[3];
+				ok = (p = parseFloats(p + 1, end, values, 3, 0)) != nullptr;
+				if (ok)
+					chunk.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+			}
+			else if (keyword(p, end, "vt", 2))
+			{
+				float values[2] = {0.0f, 0.0f};
+				ok = (p = parseFloats(p + 2, end, values, 1, 1)) != nullptr;
+				if (ok)
+					chunk.texCoords.push_back(glm::vec2(values[0], values[1]));
+			}
+			else if (keyword(p, end, "vn", 2))
+			{
+				float values[3];
+				ok = (p = parseFloats(p + 2, end, values, 3, 0)) != nullptr;
+				if (ok)
+					chunk.normals.push_back(glm::vec3(values[0], values[1], values[2]));
+			}
+			else if (keyword(p, end, "f", 1))
+			{
+				size_t first = chunk.corners.size();
+				p++;
+				while (ok)
+				{
+					p = skipBlanks(p, end);
+					if (p >= end || *p == '\n' || *p == '#')
+						break;
+					ok = (p = parseCorner(p, end, chunk)) != nullptr;
+				}
+				if (ok && chunk.corners.size() - first < 9)
+					ok = false; // fewer than three corners
+				if (ok)
+					chunk.faceStart.push_back((unsigned int)(first / 3));
+			}
+			else if (keyword(p, end, "o", 1) || keyword(p, end, "g", 1))
+				chunk.switches.push_back({(unsigned int)chunk.faceStart.size(), false, restOfLine(p + 1, end)});
+			else if (keyword(p, end, "usemtl", 6))
+				chunk.switches.push_back({(unsigned int)chunk.faceStart.size(), true, restOfLine(p + 6, end)});
+			else if (keyword(p, end, "mtllib", 6))
+				chunk.materialLibraries.push_back(restOfLine(p + 6, end));
+			else if (keyword(p, end, "s", 1))
+			{
+				// smoothing groups, the normals come from vn or from generateNormals
+			}
+			else
+				ok = false;
+
+			if (!ok)
+			{
+				chunk.error = lineText(line, end);
+				return;
+			}
+			while (p < end && *p != '\n')
+				p++;
+			p++;
+		}
+	}
+
+	// open addressing table from (a, b, c) index tuples to dense entry numbers
+	class TupleTable
+	{
+	public:
+		vector<int> keys; // three per entry
+
+		TupleTable(size_t maxEntries)
+		{
+			size_t capacity = 64;
+			while (capacity < maxEntries * 2)
+				capacity <<= 1;
+			slots.assign(capacity, EMPTY);
+			mask = (uint32_t)capacity - 1;
+		}
+
+		unsigned int size() const
+		{
+			return (unsigned int)(keys.size() / 3);
+		}
+
+		// entry number of the tuple; new tuples are appended, which is reported through 'added'
+		unsigned int insert(int a, int b, int c, bool &added)
+		{
+			uint32_t hash = (uint32_t)a * 0x9E3779B1u ^ (uint32_t)b * 0x85EBCA77u ^ (uint32_t)c * 0xC2B2AE3Du;
+			hash ^= hash >> 15;
+			for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+			{
+				unsigned int entry = slots[slot];
+				if (entry == EMPTY)
+				{
+					slots[slot] = size();
+					keys.push_back(a);
+					keys.push_back(b);
+					keys.push_back(c);
+					added = true;
+					return slots[slot];
+				}
+				if (keys[entry * 3] == a && keys[entry * 3 + 1] == b && keys[entry * 3 + 2] == c)
+				{
+					added = false;
+					return entry;
+				}
+			}
+		}
+
+	private:
+		static constexpr unsigned int EMPTY = 0xFFFFFFFFu;
+		vector<unsigned int> slots;
+		uint32_t mask;
+	};
+
+	// faces [faceBegin, faceEnd) of a chunk
+	struct Run
+	{
+		unsigned int chunk;
+		unsigned int faceBegin;
+		unsigned int faceEnd;
+	};
+
+	struct Attributes
+	{
+		vector<glm::vec3> positions;
+		vector<glm::vec2> texCoords;
+		vector<glm::vec3> normals;
+	};
+
+	// aiProcess_GenSmoothNormals for meshes without vn: area weighted face normals summed per position
+	inline void generateNormals(ObjMesh &mesh, const TupleTable &tuples)
+	{
+		TupleTable positions(mesh.vertices.size());
+		vector<unsigned int> shared(mesh.vertices.size());
+		for (unsigned int i = 0; i < mesh.vertices.size(); i++)
+		{
+			bool added;
+			shared[i] = positions.insert(tuples.keys[i * 3], -1, -1, added);
+		}
+		vector<glm::vec3> sums(positions.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			const unsigned int *triangle = &mesh.indices[i];
+			glm::vec3 a = mesh.vertices[triangle[0]].Position, b = mesh.vertices[triangle[1]].Position, c = mesh.vertices[triangle[2]].Position;
+			glm::vec3 normal = glm::cross(b - a, c - a); // length is twice the area
+			for (int corner = 0; corner < 3; corner++)
+				sums[shared[triangle[corner]]] += normal;
+		}
+		for (unsigned int i = 0; i < mesh.vertices.size(); i++)
+		{
+			float length = glm::length(sums[shared[i]]);
+			mesh.vertices[i].Normal = length > 0.0f ? sums[shared[i]] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+	}
+
+	// deduplicates the corners of the runs into vertices and fans the polygons into triangles
+	inline bool buildMesh(const vector<Chunk> &chunks, const vector<Run> &runs, const Attributes &attributes, ObjMesh &mesh)
+	{
+		size_t cornerCount = 0;
+		for (unsigned int r = 0; r < runs.size(); r++)
+		{
+			const Chunk &chunk = chunks[runs[r].chunk];
+			cornerCount += chunk.faceStart[runs[r].faceEnd] - chunk.faceStart[runs[r].faceBegin];
+		}
+		TupleTable tuples(cornerCount);
+		mesh.vertices.reserve(cornerCount / 2);
+		mesh.indices.reserve(cornerCount * 2);
+		bool missingNormals = false;
+		vector<unsigned int> polygon;
+		for (unsigned int r = 0; r < runs.size(); r++)
+		{
+			const Chunk &chunk = chunks[runs[r].chunk];
+			for (unsigned int face = runs[r].faceBegin; face < runs[r].faceEnd; face++)
+			{
+				polygon.clear();
+				for (unsigned int corner = chunk.faceStart[face]; corner < chunk.faceStart[face + 1]; corner++)
+				{
+					int v = chunk.corners[corner * 3], t = chunk.corners[corner * 3 + 1], n = chunk.corners[corner * 3 + 2];
+					if (v < 0 || v >= (int)attributes.positions.size() || t >= (int)attributes.texCoords.size() || n >= (int)attributes.normals.size() || t < -1 || n < -1)
+						return false;
+					bool added;
+					unsigned int index = tuples.insert(v, t, n, added);
+					if (added)
+					{
+						Vertex vertex = {};
+						vertex.Position = attributes.positions[v];
+						if (n >= 0)
+							vertex.Normal = attributes.normals[n];
+						else
+							missingNormals = true;
+						if (t >= 0)
+						{
+							// aiProcess_FlipUVs
+							vertex.TexCoords = glm::vec2(attributes.texCoords[t].x, 1.0f - attributes.texCoords[t].y);
+							mesh.hasTexCoords = true;
+						}
+						mesh.vertices.push_back(vertex);
+					}
+					polygon.push_back(index);
+				}
+				for (unsigned int i = 1; i + 1 < polygon.size(); i++)
+				{
+					mesh.indices.push_back(polygon[0]);
+					mesh.indices.push_back(polygon[i]);
+					mesh.indices.push_back(polygon[i + 1]);
+				}
+			}
+		}
+		if (missingNormals)
+			generateNormals(mesh, tuples);
+		if (mesh.hasTexCoords)
+			computeTangentFrames(mesh.vertices, mesh.indices);
+		return true;
+	}
+
+	// last blank separated token, the file name after options like "-bm 0.5"
+	inline string mapFile(const string &value)
+	{
+		size_t start = value.find_last_of(" \t");
+		return start == string::npos ? value : value.substr(start + 1);
+	}
+
+	// the texture statements of an MTL file; unknown statements are ignored
+	inline bool parseMaterials(const string &path, vector<ObjMaterial> &materials)
+	{
+		MappedFile file;
+		if (!file.open(path))
+			return false;
+		const char *p = (const char *)file.data(), *end = p + file.size();
+		while (p < end)
+		{
+			p = skipBlanks(p, end);
+			const char *word = p;
+			while (p < end && !isBlank(*p) && *p != '\n')
+				p++;
+			string key(word, p);
+			string value = restOfLine(p, end);
+			if (key == "newmtl")
+				materials.push_back({value, "", "", "", ""});
+			else if (!materials.empty())
+			{
+				ObjMaterial &material = materials.back();
+				if (key == "map_Kd")
+					material.diffuse = mapFile(value);
+				else if (key == "map_Ks")
+					material.specular = mapFile(value);
+				else if (key == "map_Bump" || key == "map_bump" || key == "bump")
+					material.normal = mapFile(value);
+				else if (key == "map_Ka")
+					material.height = mapFile(value);
+			}
+			while (p < end && *p != '\n')
+				p++;
+			p++;
+		}
+		return true;
+	}
+}
+
+// reads an OBJ file and the MTL files it references; false (with the reason printed) for files the reader does not support
+inline bool loadObj(const string &path, ObjScene &scene)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		cout << "ERROR::OBJ:: could not open " << path << endl;
+		return false;
+	}
+	const char *data = (const char *)file.data();
+	size_t size = file.size();
+
+	// line aligned chunks, one per thread at most
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(ThreadPool::global().size() + 1, size / obj::MIN_CHUNK_BYTES));
+	vector<size_t> bounds(chunkCount + 1, size);
+	bounds[0] = 0;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		size_t position = std::max(bounds[i - 1], size * i / chunkCount);
+		const void *newline = position < size ? memchr(data + position, '\n', size - position) : nullptr;
+		bounds[i] = newline ? (const char *)newline - data + 1 : size;
+	}
+	vector<obj::Chunk> chunks(chunkCount);
+	parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			obj::parseChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+			chunks[i].faceStart.push_back((unsigned int)(chunks[i].corners.size() / 3));
+		}
+	});
+	for (size_t i = 0; i < chunkCount; i++)
+		if (!chunks[i].error.empty())
+		{
+			cout << "ERROR::OBJ:: unsupported line \"" << chunks[i].error << "\" in " << path << endl;
+			return false;
+		}
+
+	// concatenate the attributes and resolve negative indices against the chunk bases
+	obj::Attributes attributes;
+	vector<int> bases(chunkCount * 3);
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		bases[i * 3] = (int)attributes.positions.size();
+		bases[i * 3 + 1] = (int)attributes.texCoords.size();
+		bases[i * 3 + 2] = (int)attributes.normals.size();
+		attributes.positions.insert(attributes.positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+		attributes.texCoords.insert(attributes.texCoords.end(), chunks[i].texCoords.begin(), chunks[i].texCoords.end());
+		attributes.normals.insert(attributes.normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+	}
+	for (size_t i = 0; i < chunkCount; i++)
+		for (unsigned int r = 0; r < chunks[i].relative.size(); r++)
+		{
+			unsigned int corner = chunks[i].relative[r];
+			chunks[i].corners[corner] += bases[i * 3 + corner % 3];
+		}
+	scene.positionCount = (unsigned int)attributes.positions.size();
+	scene.texCoordCount = (unsigned int)attributes.texCoords.size();
+	scene.normalCount = (unsigned int)attributes.normals.size();
+
+	string directory = path.substr(0, path.find_last_of('/') + 1);
+	for (size_t i = 0; i < chunkCount; i++)
+		for (unsigned int l = 0; l < chunks[i].materialLibraries.size(); l++)
+			if (!obj::parseMaterials(directory + chunks[i].materialLibraries[l], scene.materials))
+				cout << "ERROR::OBJ:: could not open " << directory + chunks[i].materialLibraries[l] << endl;
+	map<string, int> materialIndex;
+	for (unsigned int i = 0; i < scene.materials.size(); i++)
+		materialIndex.insert({scene.materials[i].name, (int)i});
+
+	// one mesh per object and material, like Assimp's OBJ importer
+	map<pair<string, string>, unsigned int> meshIndex;
+	vector<vector<obj::Run>> runs;
+	string object = "defaultobject", material;
+	for (unsigned int c = 0; c < chunkCount; c++)
+	{
+		const obj::Chunk &chunk = chunks[c];
+		unsigned int faceCount = (unsigned int)chunk.faceStart.size() - 1;
+		unsigned int face = 0;
+		for (unsigned int s = 0; s <= chunk.switches.size(); s++)
+		{
+			unsigned int runEnd = s < chunk.switches.size() ? chunk.switches[s].face : faceCount;
+			if (runEnd > face)
+			{
+				auto key = make_pair(object, material);
+				auto found = meshIndex.find(key);
+				if (found == meshIndex.end())
+				{
+					found = meshIndex.insert({key, (unsigned int)scene.meshes.size()}).first;
+					scene.meshes.push_back(ObjMesh());
+					scene.meshes.back().object = object;
+					auto known = materialIndex.find(material);
+					scene.meshes.back().material = known != materialIndex.end() ? known->second : -1;
+					runs.push_back(vector<obj::Run>());
+				}
+				runs[found->second].push_back({c, face, runEnd});
+				face = runEnd;
+			}
+			if (s < chunk.switches.size())
+				(chunk.switches[s].material ? material : object) = chunk.switches[s].name;
+		}
+	}
+
+	vector<unsigned char> built(scene.meshes.size());
+	parallelFor(scene.meshes.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			built[i] = obj::buildMesh(chunks, runs[i], attributes, scene.meshes[i]);
+	});
+	for (unsigned int i = 0; i < built.size(); i++)
+		if (!built[i])
+		{
+			cout << "ERROR::OBJ:: face index out of range in " << path << endl;
+			return false;
+		}
+	return true;
+}
+
+inline bool isObjFile(const string &path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == string::npos)
+		return false;
+	string extension = path.substr(dot + 1);
+	for (unsigned int i = 0; i < extension.size(); i++)
+		extension[i] = (char)tolower((unsigned char)extension[i]);
+	return extension == "obj";
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <tool/thread_pool.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCENE_GRAPH_USE_SSE 1
+#endif
+
+using namespace std;
+
+// out = a * b, column major like glm; out must not alias a or b
+inline void multiplyMatrix(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+#ifdef SCENE_GRAPH_USE_SSE
+	__m128 a0 = _mm_loadu_ps(&a[0][0]);
+	__m128 a1 = _mm_loadu_ps(&a[1][0]);
+	__m128 a2 = _mm_loadu_ps(&a[2][0]);
+	__m128 a3 = _mm_loadu_ps(&a[3][0]);
+	for (int column = 0; column < 4; column++)
+	{
+		__m128 result = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+		_mm_storeu_ps(&out[column][0], result);
+	}
+#else
+	out = a * b;
+#endif
+}
+
+// Flat node hierarchy. Nodes are stored breadth first: parents always come before their children and every depth
+// is one contiguous range, so update() walks the arrays front to back, one depth at a time. Only nodes whose own
+// local matrix changed, or that sit below such a node, are recomputed; the multiplies of one depth are independent
+// and run as one batch (spread over the thread pool when the batch is large).
+class SceneGraph
+{
+public:
+	vector<int> parent; // -1 for roots
+	vector<glm::mat4> local;
+	vector<glm::mat4> world;
+	vector<string> name;
+
+	unsigned int size() const
+	{
+		return (unsigned int)parent.size();
+	}
+
+	// appends a node below parentIndex (-1 for a root); nodes have to be added breadth first, returns -1 otherwise
+	int addNode(int parentIndex, const glm::mat4 &transform, const string &nodeName = "")
+	{
+		int nodeDepth = parentIndex < 0 ? 0 : (parentIndex < (int)size() ? depth[parentIndex] + 1 : -1);
+		if (nodeDepth < 0 || (!depth.empty() && nodeDepth < depth.back()))
+		{
+			cout << "ERROR::SCENE_GRAPH:: node " << nodeName << " not added in breadth first order" << endl;
+			return -1;
+		}
+		if (depth.empty() || nodeDepth > depth.back())
+			levelStart.push_back(size());
+
+		parent.push_back(parentIndex);
+		local.push_back(transform);
+		world.push_back(transform);
+		name.push_back(nodeName);
+		depth.push_back(nodeDepth);
+		dirty.push_back(1);
+		changed.push_back(0);
+		return (int)size() - 1;
+	}
+
+	void setLocal(int node, const glm::mat4 &transform)
+	{
+		local[node] = transform;
+		dirty[node] = 1;
+	}
+
+	// first node with that name, -1 if there is none
+	int find(const string &nodeName) const
+	{
+		for (unsigned int i = 0; i < size(); i++)
+			if (name[i] == nodeName)
+				return (int)i;
+		return -1;
+	}
+
+	bool needsUpdate() const
+	{
+		for (unsigned int i = 0; i < size(); i++)
+			if (dirty[i])
+				return true;
+		return false;
+	}
+
+	// recomputes the world matrices of dirty subtrees; returns how many were recomputed
+	unsigned int update()
+	{
+		unsigned int recomputed = 0;
+		for (unsigned int level = 0; level < levelStart.size(); level++)
+		{
+			unsigned int begin = levelStart[level];
+			unsigned int end = level + 1 < levelStart.size() ? levelStart[level + 1] : size();
+			batch.clear();
+			for (unsigned int i = begin; i < end; i++)
+			{
+				changed[i] = dirty[i] || (parent[i] >= 0 && changed[parent[i]]);
+				dirty[i] = 0;
+				if (changed[i])
+					batch.push_back(i);
+			}
+			parallelFor(batch.size(), 1024, [&](size_t first, size_t last) {
+				for (size_t b = first; b < last; b++)
+				{
+					unsigned int i = batch[b];
+					if (parent[i] < 0)
+						world[i] = local[i];
+					else
+						multiplyMatrix(world[parent[i]], local[i], world[i]);
+				}
+			});
+			recomputed += (unsigned int)batch.size();
+		}
+		return recomputed;
+	}
+
+	void clear()
+	{
+		parent.clear();
+		local.clear();
+		world.clear();
+		name.clear();
+		depth.clear();
+		dirty.clear();
+		changed.clear();
+		levelStart.clear();
+	}
+
+private:
+	vector<int> depth;
+	vector<unsigned char> dirty;	 // local matrix set since the last update
+	vector<unsigned char> changed; // world matrix recomputed by the running update
+	vector<unsigned int> levelStart;
+	vector<unsigned int> batch;
+};
+
+#endif
@@ -5,11 +5,102 @@
 
 #include <glm/glm.hpp>
 
+#include <tool/mapped_file.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// binding points of the uniform blocks shared by all programs, see include/tool/uniform_buffer.h; a program that
+// declares a block of one of these names is attached to its binding point when it is linked
+const unsigned int FRAME_BLOCK_BINDING = 0;
+const unsigned int MATERIAL_BLOCK_BINDING = 1;
+
+// binary program cache, written next to the vertex shader as "<vertex>.<fragment file name>.program"; see Shader::loadProgramBinary
+const char PROGRAM_CACHE_MAGIC[8] = {'P', 'R', 'O', 'G', 'R', 'A', 'M', 'B'};
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t binaryFormat; // of glGetProgramBinary
+    uint64_t key;          // sources plus vendor, renderer and version strings of the driver
+    uint64_t binarySize;
+};
+
+struct ShaderStatistics
+{
+    unsigned int compiled = 0; // from source
+    unsigned int restored = 0; // from the binary cache
+    unsigned int shared = 0;   // same sources as an earlier Shader, no new program
+    double milliseconds = 0.0;
+};
+
+// GL_KHR_parallel_shader_compile (or the ARB twin): the driver compiles and links on its own threads and
+// GL_COMPLETION_STATUS_KHR tells, without waiting, whether a shader or program is done. Not in our glad, which is core only.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+class ShaderBatch;
+
+// Compile-time switches of a shader permutation, written as #define lines right after the #version line. Programs
+// are cached by their preprocessed sources, so every (source, defines) pair compiles once per process and is kept in
+// its own binary cache file.
+class ShaderDefines
+{
+public:
+    ShaderDefines &set(const std::string &name, const std::string &value = "1")
+    {
+        values[name] = value;
+        return *this;
+    }
+    ShaderDefines &set(const std::string &name, int value)
+    {
+        return set(name, std::to_string(value));
+    }
+    bool empty() const
+    {
+        return values.empty();
+    }
+    // sorted by name, so equal sets give equal text
+    std::string source() const
+    {
+        std::string text;
+        for (std::map<std::string, std::string>::const_iterator it = values.begin(); it != values.end(); ++it)
+            text += "#define " + it->first + " " + it->second + "\n";
+        return text;
+    }
+
+private:
+    std::map<std::string, std::string> values;
+};
+
+// A uniform of a Shader's reflected table. Resolve it once with Shader::uniform<T>(name) and set it with
+// Shader::set(handle, value); T is the C++ type of the value (bool, int, float, glm::vecN, glm::ivec4, glm::matN).
+// Like location -1, an invalid handle (inactive uniform, wrong type) makes set() a no-op.
+template <typename T>
+struct UniformHandle
+{
+    int index = -1;
+
+    bool valid() const
+    {
+        return index >= 0;
+    }
+};
+
 class Shader
 {
 public:
@@ -20,6 +111,78 @@ public:
     // ------------------------------------------------------------------------
     Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr)
     {
+        load(vertexPath, fragmentPath, geometryPath, ShaderDefines(), nullptr);
+    }
+    // a permutation: the sources with the defines, see ShaderDefines
+    Shader(const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines, const char *geometryPath = nullptr)
+    {
+        load(vertexPath, fragmentPath, geometryPath, defines, nullptr);
+    }
+    // submits the compile and link without waiting for them; the batch checks the result later, see ShaderBatch.
+    // Until then use() binds the fallback program (setFallback), the string setters write to it and handles are invalid.
+    Shader(ShaderBatch &batch, const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr);
+    Shader(ShaderBatch &batch, const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines, const char *geometryPath = nullptr);
+
+    // startup cost of all the Shaders constructed so far
+    static ShaderStatistics &statistics()
+    {
+        static ShaderStatistics current;
+        return current;
+    }
+    static void printStatistics()
+    {
+        const ShaderStatistics &current = statistics();
+        std::cout << "SHADER:: " << current.compiled << " compiled, " << current.restored << " from the binary cache, " << current.shared
+                  << " shared, " << current.milliseconds << " ms" << std::endl;
+    }
+    // drawn with while a program of a batch is still linking; the fallback itself is an ordinary, linked Shader
+    static void setFallback(const Shader &shader)
+    {
+        fallbackProgram() = shader.program;
+    }
+    // false while the link of a batch is in flight
+    bool ready() const
+    {
+        return program->linked;
+    }
+    // finishes a submitted link; with block = false only if the driver reports it complete. Without
+    // GL_KHR_parallel_shader_compile there is no way to ask, and the driver compiles on our thread anyway, so it blocks.
+    bool finishLink(bool block) const
+    {
+        if (program->linked)
+            return true;
+        auto start = std::chrono::steady_clock::now();
+        if (!block && parallelCompileSupported())
+        {
+            GLint complete = 0;
+            glGetProgramiv(program->id, GL_COMPLETION_STATUS_KHR, &complete);
+            if (!complete)
+                return false;
+        }
+        // the status queries below wait for the driver, which is why they come last
+        bool success = true;
+        const char *stageTypes[3] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+        for (unsigned int i = 0; i < program->stageCount; i++)
+            success &= checkCompileErrors(program->stages[i], stageTypes[i]);
+        success &= checkCompileErrors(program->id, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        for (unsigned int i = 0; i < program->stageCount; i++)
+            glDeleteShader(program->stages[i]);
+        program->stageCount = 0;
+        if (success)
+            saveProgramBinary(program->cachePath, program->cacheKey);
+        prepare();
+        auto end = std::chrono::steady_clock::now();
+        statistics().milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "SHADER::PROGRAM " << program->label << " compiled in "
+                  << std::chrono::duration<double, std::milli>(end - program->submitted).count() << " ms" << std::endl;
+        return true;
+    }
+
+private:
+    void load(const char *vertexPath, const char *fragmentPath, const char *geometryPath, const ShaderDefines &defines, ShaderBatch *batch)
+    {
+        auto start = std::chrono::steady_clock::now();
 
         std::string vert_string = vertexPath;
         std::string frag_string = fragmentPath;
@@ -75,113 +238,638 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
+        vertexCode = preprocess(vertexCode, vert_string, defines);
+        fragmentCode = preprocess(fragmentCode, frag_string, defines);
         if (geometryPath != nullptr)
+            geometryCode = preprocess(geometryCode, gemo_string, defines);
+        // 2. the program: the one of an earlier Shader with the same sources, restored from the binary cache, or compiled
+        uint64_t sourceHash = hashSources(vertexCode, fragmentCode, geometryCode);
+        std::shared_ptr<ProgramState> &shared = programs()[sourceHash];
+        std::string label = vert_string + " + " + frag_string;
+        const char *origin = nullptr;
+        if (shared)
         {
-            const char *gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            program = shared;
+            origin = "shared";
+            statistics().shared++;
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr)
-            glDeleteShader(geometry);
+        else
+        {
+            program = std::make_shared<ProgramState>();
+            program->label = label;
+            program->cachePath = programCachePath(vert_string, frag_string, defines);
+            program->cacheKey = programCacheKey(sourceHash);
+            if (loadProgramBinary(program->cachePath, program->cacheKey))
+            {
+                prepare();
+                origin = "binary cache";
+                statistics().restored++;
+            }
+            else
+            {
+                // finishLink reports the compile itself
+                submit(vertexCode, fragmentCode, geometryCode, geometryPath != nullptr);
+                program->submitted = start;
+                statistics().compiled++;
+            }
+            shared = program;
+        }
+        ID = program->id;
+        statistics().milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (origin)
+            std::cout << "SHADER::PROGRAM " << label << " " << origin << " in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+        if (!batch)
+            finishLink(true);
     }
+
+public:
     // activate the shader
     // ------------------------------------------------------------------------
     void use()
     {
-        glUseProgram(ID);
+        GLuint id = ID;
+        if (!program->linked && !finishLink(!fallbackProgram()))
+            id = fallbackProgram()->id;
+        glUseProgram(id);
+        currentProgram() = id;
     }
-    // utility uniform functions
+    // typed handles, resolved once the program is ready(); a program still linking has no table yet and hands out
+    // invalid handles, so resolve them (again) after ready() turned true. A ready program reports names it has no
+    // active uniform for, unless the uniform is optional (probed by callers that serve several shaders)
+    // ------------------------------------------------------------------------
+    template <typename T>
+    UniformHandle<T> uniform(const std::string &name, bool optional = false) const
+    {
+        UniformHandle<T> handle;
+        int index = findUniform(name);
+        if (index < 0)
+        {
+            if (program->linked && !optional)
+                std::cout << "ERROR::SHADER::UNIFORM_NOT_FOUND " << name << " is not an active uniform of " << program->label << std::endl;
+            return handle;
+        }
+        if (!accepts(program->uniforms[index].type, (const T *)nullptr))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE " << name << " does not match the requested type" << std::endl;
+            return handle;
+        }
+        handle.index = index;
+        return handle;
+    }
+    // skips the glUniform call when the program already holds the value. The program has to be the one bound by
+    // use(); otherwise (e.g. the fallback is bound in its place) the call is dropped, its locations mean nothing there
+    template <typename T>
+    void set(UniformHandle<T> handle, const T &value) const
+    {
+        if (handle.index >= 0 && changed(program->uniforms[handle.index], &value, sizeof(T)))
+            upload(program->uniforms[handle.index].location, value);
+    }
+    void set(UniformHandle<bool> handle, bool value) const
+    {
+        int word = (int)value;
+        if (handle.index >= 0 && changed(program->uniforms[handle.index], &word, sizeof(word)))
+            glUniform1i(program->uniforms[handle.index].location, word);
+    }
+    // utility uniform functions: the string keyed fallback, a hash lookup in the reflected table (of the fallback
+    // program while this one is still linking)
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setByName(name, value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setByName(name, value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setByName(name, value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setByName(name, value);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        setVec2(name, glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setByName(name, value);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setVec3(name, glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setByName(name, value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w)
+    void setVec4(const std::string &name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        setVec4(name, glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setByName(name, mat);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setByName(name, mat);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setByName(name, mat);
+    }
+    // index of an active uniform in the reflected table, -1 if the program has none of that name.
+    // Array elements are listed one by one ("lights[2]"), the bare array name is element 0.
+    int findUniform(const std::string &name) const
+    {
+        const std::vector<UniformName> &buckets = program->buckets;
+        if (buckets.empty())
+            return -1;
+        uint32_t hash = hashName(name.data(), name.size());
+        for (size_t b = hash & (buckets.size() - 1);; b = (b + 1) & (buckets.size() - 1))
+        {
+            const UniformName &entry = buckets[b];
+            if (entry.slot < 0)
+                return -1;
+            if (entry.hash == hash && entry.name == name)
+                return entry.slot;
+        }
+    }
+    unsigned int uniformCount() const
+    {
+        return (unsigned int)program->uniforms.size();
+    }
+    // forget the shadow values, e.g. after glUniform calls that bypassed this class
+    void invalidateUniforms() const
+    {
+        for (size_t i = 0; i < program->uniforms.size(); i++)
+            program->uniforms[i].known = false;
     }
 
 private:
+    struct UniformSlot
+    {
+        GLint location;
+        GLenum type;
+        unsigned int offset; // first word of the shadow value
+        unsigned int words;
+        bool known;          // the shadow holds what the program has
+    };
+    struct UniformName
+    {
+        std::string name;
+        uint32_t hash = 0;
+        int slot = -1; // -1: empty bucket
+    };
+    // a linked program and its reflection, shared by the Shaders built from the same sources so their shadows agree
+    struct ProgramState
+    {
+        GLuint id = 0;
+        bool linked = false;
+        // a submitted link, see finishLink
+        GLuint stages[3] = {0, 0, 0};
+        unsigned int stageCount = 0;
+        std::string label;
+        std::string cachePath;
+        uint64_t cacheKey = 0;
+        std::chrono::steady_clock::time_point submitted;
+        std::vector<UniformSlot> uniforms;
+        std::vector<UniformName> buckets; // open addressing, power of two size
+        std::vector<uint32_t> shadow;
+    };
+    std::shared_ptr<ProgramState> program;
+
+    static std::shared_ptr<ProgramState> &fallbackProgram()
+    {
+        static std::shared_ptr<ProgramState> program;
+        return program;
+    }
+
+    template <typename T>
+    void setByName(const std::string &name, const T &value) const
+    {
+        if (!program->linked && fallbackProgram())
+        {
+            Shader standIn = *this;
+            standIn.program = fallbackProgram();
+            standIn.ID = standIn.program->id;
+            standIn.set(UniformHandle<T>{standIn.findUniform(name)}, value);
+            return;
+        }
+        set(UniformHandle<T>{findUniform(name)}, value);
+    }
+
+    // a linked program: the uniform table and the block bindings
+    void prepare() const
+    {
+        reflectUniforms();
+        bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+        bindUniformBlock("MaterialBlock", MATERIAL_BLOCK_BINDING);
+        program->linked = true;
+    }
+
+    static bool parallelCompileSupported()
+    {
+        static int supported = -1;
+        if (supported < 0)
+        {
+            supported = 0;
+            GLint extensions = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+            for (GLint i = 0; i < extensions; i++)
+            {
+                const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+                if (name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+                    supported = 1;
+            }
+        }
+        return supported == 1;
+    }
+
+    // programs by source hash; like before, programs live as long as the process
+    static std::unordered_map<uint64_t, std::shared_ptr<ProgramState>> &programs()
+    {
+        static std::unordered_map<uint64_t, std::shared_ptr<ProgramState>> table;
+        return table;
+    }
+
+    // the program glUniform* currently writes to, as far as Shader::use knows; set() on any other program is dropped
+    static GLuint &currentProgram()
+    {
+        static GLuint program = 0;
+        return program;
+    }
+
+    static uint32_t hashName(const char *name, size_t length)
+    {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; i++)
+            hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+        return hash;
+    }
+
+    // 32 bit words of a value of the GL type
+    static unsigned int typeWords(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_FLOAT_VEC2:
+        case GL_INT_VEC2:
+        case GL_UNSIGNED_INT_VEC2:
+        case GL_BOOL_VEC2:
+            return 2;
+        case GL_FLOAT_VEC3:
+        case GL_INT_VEC3:
+        case GL_UNSIGNED_INT_VEC3:
+        case GL_BOOL_VEC3:
+            return 3;
+        case GL_FLOAT_VEC4:
+        case GL_INT_VEC4:
+        case GL_UNSIGNED_INT_VEC4:
+        case GL_BOOL_VEC4:
+        case GL_FLOAT_MAT2:
+            return 4;
+        case GL_FLOAT_MAT2x3:
+        case GL_FLOAT_MAT3x2:
+            return 6;
+        case GL_FLOAT_MAT2x4:
+        case GL_FLOAT_MAT4x2:
+            return 8;
+        case GL_FLOAT_MAT3:
+            return 9;
+        case GL_FLOAT_MAT3x4:
+        case GL_FLOAT_MAT4x3:
+            return 12;
+        case GL_FLOAT_MAT4:
+            return 16;
+        default:
+            return 1; // scalars and samplers
+        }
+    }
+
+    static bool accepts(GLenum type, const float *) { return type == GL_FLOAT; }
+    static bool accepts(GLenum type, const glm::vec2 *) { return type == GL_FLOAT_VEC2; }
+    static bool accepts(GLenum type, const glm::vec3 *) { return type == GL_FLOAT_VEC3; }
+    static bool accepts(GLenum type, const glm::vec4 *) { return type == GL_FLOAT_VEC4; }
+    static bool accepts(GLenum type, const glm::ivec4 *) { return type == GL_INT_VEC4 || type == GL_BOOL_VEC4; }
+    static bool accepts(GLenum type, const glm::mat2 *) { return type == GL_FLOAT_MAT2; }
+    static bool accepts(GLenum type, const glm::mat3 *) { return type == GL_FLOAT_MAT3; }
+    static bool accepts(GLenum type, const glm::mat4 *) { return type == GL_FLOAT_MAT4; }
+    // glUniform1i sets ints, bools and samplers
+    static bool accepts(GLenum type, const int *) { return type != GL_FLOAT && typeWords(type) == 1; }
+    static bool accepts(GLenum type, const bool *) { return type != GL_FLOAT && typeWords(type) == 1; }
+
+    static void upload(GLint location, int value) { glUniform1i(location, value); }
+    static void upload(GLint location, float value) { glUniform1f(location, value); }
+    static void upload(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::ivec4 &value) { glUniform4iv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::mat2 &value) { glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]); }
+    static void upload(GLint location, const glm::mat3 &value) { glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); }
+    static void upload(GLint location, const glm::mat4 &value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+
+    // compares the value with the shadow copy and records it; false when the program holds it already or is not
+    // the bound one
+    bool changed(UniformSlot &slot, const void *value, size_t bytes) const
+    {
+        if (currentProgram() != ID)
+            return false;
+        if (bytes > slot.words * sizeof(uint32_t))
+            return true; // type mismatch through the string fallback: upload and let GL report it, like before
+        uint32_t *stored = &program->shadow[slot.offset];
+        if (slot.known && memcmp(stored, value, bytes) == 0)
+            return false;
+        memcpy(stored, value, bytes);
+        slot.known = true;
+        return true;
+    }
+
+    void addUniformName(const std::string &name, int slot) const
+    {
+        UniformName entry;
+        entry.name = name;
+        entry.hash = hashName(name.data(), name.size());
+        entry.slot = slot;
+        program->buckets.push_back(entry);
+    }
+
+    // GLSL 330 has no layout(binding = N) for blocks, the program is told instead
+    void bindUniformBlock(const char *name, unsigned int binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(program->id, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program->id, index, binding);
+    }
+
+    // enumerates the active uniforms after linking into the slot table and the name hash table
+    void reflectUniforms() const
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program->id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program->id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+        unsigned int words = 0;
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program->id, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            // members of uniform blocks have no location
+            GLint location = glGetUniformLocation(program->id, name.c_str());
+            if (location < 0)
+                continue;
+            bool array = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+            std::string base = array ? name.substr(0, name.size() - 3) : name;
+            for (GLint element = 0; element < (array ? size : 1); element++)
+            {
+                std::string elementName = array ? base + "[" + std::to_string(element) + "]" : name;
+                UniformSlot slot;
+                slot.location = element == 0 ? location : glGetUniformLocation(program->id, elementName.c_str());
+                slot.type = type;
+                slot.offset = words;
+                slot.words = typeWords(type);
+                slot.known = false;
+                words += slot.words;
+                program->uniforms.push_back(slot);
+                addUniformName(elementName, (int)program->uniforms.size() - 1);
+                if (array && element == 0)
+                    addUniformName(base, (int)program->uniforms.size() - 1);
+            }
+        }
+        program->shadow.assign(words, 0);
+
+        // at most half full
+        std::vector<UniformName> &buckets = program->buckets;
+        std::vector<UniformName> names;
+        names.swap(buckets);
+        size_t capacity = 16;
+        while (capacity < names.size() * 2)
+            capacity *= 2;
+        buckets.assign(capacity, UniformName());
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            size_t b = names[i].hash & (capacity - 1);
+            while (buckets[b].slot >= 0)
+                b = (b + 1) & (capacity - 1);
+            buckets[b] = names[i];
+        }
+    }
+
+    static uint64_t hashSources(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+    {
+        // the terminating zeros keep "ab" + "c" and "a" + "bc" apart
+        uint64_t hash = fnv1a64(vertexCode.c_str(), vertexCode.size() + 1);
+        hash = fnv1a64(fragmentCode.c_str(), fragmentCode.size() + 1, hash);
+        return fnv1a64(geometryCode.c_str(), geometryCode.size() + 1, hash);
+    }
+
+    // permutations get the hash of their defines in the name, so they don't overwrite each other
+    static std::string programCachePath(const std::string &vertexPath, const std::string &fragmentPath, const ShaderDefines &defines)
+    {
+        size_t slash = fragmentPath.find_last_of("/\\");
+        std::string path = vertexPath + "." + (slash == std::string::npos ? fragmentPath : fragmentPath.substr(slash + 1));
+        if (!defines.empty())
+        {
+            std::string text = defines.source();
+            char hash[17];
+            snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)fnv1a64(text.data(), text.size()));
+            path += std::string(".") + hash;
+        }
+        return path + ".program";
+    }
+
+    static bool readFile(const std::string &path, std::string &text)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
+
+    // resolves #include "file" (relative to the including file; each file once per stage, so shared files need no
+    // guards) and puts the defines after the #version line. #line directives keep the error messages pointing at the
+    // right line, with the source string number telling the files apart: 0 is the stage's own file, includes count
+    // from 1 in the order they are first met.
+    static std::string preprocess(const std::string &code, const std::string &path, const ShaderDefines &defines)
+    {
+        std::vector<std::string> included;
+        std::string text;
+        expandIncludes(code, path, 0, &defines, included, text);
+        return text;
+    }
+
+    static void expandIncludes(const std::string &code, const std::string &path, int fileNumber, const ShaderDefines *defines,
+                               std::vector<std::string> &included, std::string &text)
+    {
+        size_t slash = path.find_last_of("/\\");
+        std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        std::istringstream lines(code);
+        std::string line;
+        int number = 0;
+        while (std::getline(lines, line))
+        {
+            number++;
+            size_t first = line.find_first_not_of(" \t");
+            if (first != std::string::npos && defines && line.compare(first, 8, "#version") == 0)
+            {
+                text += line + "\n" + defines->source() + "#line " + std::to_string(number + 1) + " " + std::to_string(fileNumber) + "\n";
+                continue;
+            }
+            if (first == std::string::npos || line.compare(first, 8, "#include") != 0)
+            {
+                text += line + "\n";
+                continue;
+            }
+            size_t open = line.find('"', first + 8);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (close == std::string::npos)
+                std::cout << "ERROR::SHADER::INCLUDE_SYNTAX " << path << ":" << number << std::endl;
+            else
+            {
+                std::string includePath = directory + line.substr(open + 1, close - open - 1);
+                std::string includeCode;
+                bool seen = std::find(included.begin(), included.end(), includePath) != included.end();
+                if (!seen && !readFile(includePath, includeCode))
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << includePath << " in " << path << std::endl;
+                else if (!seen)
+                {
+                    included.push_back(includePath);
+                    int includeNumber = (int)included.size();
+                    text += "#line 1 " + std::to_string(includeNumber) + "\n";
+                    expandIncludes(includeCode, includePath, includeNumber, nullptr, included, text);
+                }
+            }
+            text += "#line " + std::to_string(number + 1) + " " + std::to_string(fileNumber) + "\n";
+        }
+    }
+
+    // a binary is only valid for the driver that produced it
+    static uint64_t programCacheKey(uint64_t sourceHash)
+    {
+        const GLenum names[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+        uint64_t key = sourceHash;
+        for (int i = 0; i < 3; i++)
+        {
+            const char *value = (const char *)glGetString(names[i]);
+            if (value)
+                key = fnv1a64(value, strlen(value) + 1, key);
+        }
+        return key;
+    }
+
+    // glGetProgramBinary is core in GL 4.1; older contexts (or drivers without any binary format) always compile
+    static bool programBinariesSupported()
+    {
+        static int supported = -1;
+        if (supported < 0)
+        {
+            GLint formats = 0;
+            if (glad_glGetProgramBinary && glad_glProgramBinary && glad_glProgramParameteri)
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            supported = formats > 0 ? 1 : 0;
+        }
+        return supported == 1;
+    }
+
+    // restores the program from the cache; false when there is none, it is stale, or the driver rejects it
+    bool loadProgramBinary(const std::string &cachePath, uint64_t key)
+    {
+        if (!programBinariesSupported())
+            return false;
+        MappedFile file;
+        if (!file.open(cachePath) || file.size() < sizeof(ProgramCacheHeader))
+            return false;
+        const ProgramCacheHeader *header = (const ProgramCacheHeader *)file.data();
+        if (memcmp(header->magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0 || header->version != PROGRAM_CACHE_VERSION ||
+            header->key != key || header->binarySize != file.size() - sizeof(ProgramCacheHeader))
+            return false;
+        program->id = glCreateProgram();
+        glProgramBinary(program->id, header->binaryFormat, file.data() + sizeof(ProgramCacheHeader), (GLsizei)header->binarySize);
+        GLint success = 0;
+        glGetProgramiv(program->id, GL_LINK_STATUS, &success);
+        if (success)
+            return true;
+        // e.g. a driver update that kept the version string; compile from source and overwrite the cache
+        glDeleteProgram(program->id);
+        program->id = 0;
+        return false;
+    }
+
+    void saveProgramBinary(const std::string &cachePath, uint64_t key) const
+    {
+        if (!programBinariesSupported())
+            return;
+        GLint length = 0;
+        glGetProgramiv(program->id, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program->id, length, &length, &format, binary.data());
+
+        ProgramCacheHeader header;
+        memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+        header.version = PROGRAM_CACHE_VERSION;
+        header.binaryFormat = format;
+        header.key = key;
+        header.binarySize = (uint64_t)length;
+        std::string temporaryPath = cachePath + ".tmp";
+        {
+            std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return;
+            out.write((const char *)&header, sizeof(header));
+            out.write(binary.data(), length);
+            if (!out)
+                return;
+        }
+        std::remove(cachePath.c_str());
+        std::rename(temporaryPath.c_str(), cachePath.c_str());
+    }
+
+    // hands the sources to the driver and starts the link without asking for any status, which would wait for it;
+    // finishLink checks the result
+    void submit(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode, bool hasGeometry)
+    {
+        const std::string *sources[3] = {&vertexCode, &fragmentCode, &geometryCode};
+        const GLenum types[3] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+        program->stageCount = hasGeometry ? 3 : 2;
+        program->id = glCreateProgram();
+        for (unsigned int i = 0; i < program->stageCount; i++)
+        {
+            const char *code = sources[i]->c_str();
+            program->stages[i] = glCreateShader(types[i]);
+            glShaderSource(program->stages[i], 1, &code, NULL);
+            glCompileShader(program->stages[i]);
+            glAttachShader(program->id, program->stages[i]);
+        }
+        if (programBinariesSupported())
+            glProgramParameteri(program->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program->id);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type) const
     {
         GLint success;
         GLchar infoLog[1024];
@@ -205,7 +893,68 @@ private:
                           << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
+    }
+};
+
+// Compiles a set of programs side by side: every Shader constructed with the batch is submitted to the driver
+// first, the statuses are only checked afterwards. With GL_KHR_parallel_shader_compile the driver links them on
+// its own threads; poll() picks up the finished ones without waiting, wait() is the warmup that finishes all of them
+// during loading so no program is first linked in the middle of a frame. Without the extension poll() (and use())
+// finish the links on the spot, nothing would ever report them done otherwise.
+// While a program is linking, anything built from its uniform table (handles, material tables) has to wait for
+// Shader::ready().
+class ShaderBatch
+{
+public:
+    void add(const Shader &shader)
+    {
+        if (!shader.ready())
+            pending.push_back(shader);
+    }
+
+    unsigned int pendingCount() const
+    {
+        return (unsigned int)pending.size();
+    }
+
+    // finishes the programs the driver is done with; returns how many are still linking
+    unsigned int poll()
+    {
+        for (size_t i = 0; i < pending.size();)
+        {
+            if (pending[i].finishLink(false))
+            {
+                pending[i] = pending.back();
+                pending.pop_back();
+            }
+            else
+                i++;
+        }
+        return (unsigned int)pending.size();
+    }
+
+    void wait()
+    {
+        for (size_t i = 0; i < pending.size(); i++)
+            pending[i].finishLink(true);
+        pending.clear();
     }
+
+private:
+    std::vector<Shader> pending; // copies, they share the program state with the caller's Shaders
 };
 
+inline Shader::Shader(ShaderBatch &batch, const char *vertexPath, const char *fragmentPath, const char *geometryPath)
+{
+    load(vertexPath, fragmentPath, geometryPath, ShaderDefines(), &batch);
+    batch.add(*this);
+}
+
+inline Shader::Shader(ShaderBatch &batch, const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines, const char *geometryPath)
+{
+    load(vertexPath, fragmentPath, geometryPath, defines, &batch);
+    batch.add(*this);
+}
+
 #endif
\ No newline at end of file
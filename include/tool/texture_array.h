@@ -0,0 +1,427 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tool/texture_loader.h>
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Material textures packed into GL_TEXTURE_2D_ARRAYs, one array per texture slot, so the meshes of a model are drawn
+// back to back with the arrays bound once and only a layer index (ivec4 textureLayers, one per slot) set per draw.
+// Textures of the common layer size become whole layers. Small square power of two textures share atlas layers; the
+// rect of a mesh is applied to its texture coordinates at import, so it has to be the same for all slots of the mesh
+// and the coordinates must stay inside [0, 1]. Tiles sit at multiples of their size, so every mip level of a tile
+// stays aligned to texels (and to 4x4 blocks down to a tile size of 4); bilinear filtering still blends across the
+// tile border at the smallest levels. Meshes that fit neither get a private set of one layer arrays.
+
+enum TextureSlot
+{
+	SLOT_DIFFUSE,
+	SLOT_SPECULAR,
+	SLOT_NORMAL,
+	SLOT_HEIGHT,
+	TEXTURE_SLOTS
+};
+
+// slot of a "texture_diffuse" / "texture_specular" / "texture_normal" / "texture_height" type name, -1 for others
+inline int textureSlot(const string &type)
+{
+	static const char *names[TEXTURE_SLOTS] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+	for (int i = 0; i < TEXTURE_SLOTS; i++)
+		if (type == names[i])
+			return i;
+	return -1;
+}
+
+// sampler uniform of a slot's array in the shaders
+inline const char *textureArrayUniform(int slot)
+{
+	static const char *names[TEXTURE_SLOTS] = {"diffuseArray", "specularArray", "normalArray", "heightArray"};
+	return names[slot];
+}
+
+// One GL_TEXTURE_2D_ARRAY. The storage is allocated with the format of the first image that arrives (8 bit images
+// are stored as RGBA8, or SRGB8_ALPHA8, whatever their component count); layers and tiles are filled as their decodes
+// finish. All mip levels down to 1x1 are allocated, every uploaded image has to bring its full chain.
+class TextureArray
+{
+public:
+	unsigned int id = 0;
+	int width = 0;
+	int height = 0;
+	int layers = 0;
+	int levels = 0;
+	GLenum compressedFormat = 0;
+	bool srgb = false;
+
+	TextureArray() {}
+	TextureArray(int width, int height, int layers) : width(width), height(height), layers(layers)
+	{
+		levels = 1;
+		while ((std::max(width, height) >> levels) > 0)
+			levels++;
+	}
+
+	bool allocated() const
+	{
+		return id != 0;
+	}
+
+	// false if the image cannot share this array: block compressed in a different format, or plain where the array is compressed
+	bool compatible(const DecodedImage &image) const
+	{
+		return !image.levels.empty() && (!allocated() || image.compressedFormat == compressedFormat);
+	}
+
+	void allocate(const DecodedImage &format)
+	{
+		compressedFormat = format.compressedFormat;
+		srgb = format.srgb;
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		for (int i = 0; i < levels; i++)
+		{
+			int w = std::max(1, width >> i), h = std::max(1, height >> i);
+			if (compressedFormat)
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, compressedFormat, w, h, layers, 0, (GLsizei)(blockBytes() * blocks(w) * blocks(h) * layers), NULL);
+			else
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, i, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, w, h, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	// a whole layer; the image has the array's size
+	void uploadLayer(int layer, const DecodedImage &image)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int i = 0; i < levels && i < (int)image.levels.size(); i++)
+			uploadRect(i, 0, 0, layer, image.levels[i], image.components);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	// an atlas tile with its top left corner at x, y (multiples of the tile size). Levels below the tile's 1x1 reuse
+	// its last level; compressed levels smaller than a block write the tile's single block over the 4x4 block around it.
+	void uploadTile(int layer, int x, int y, const DecodedImage &image)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int i = 0; i < levels; i++)
+		{
+			const ImageLevel &level = image.levels[std::min(i, (int)image.levels.size() - 1)];
+			int px = x >> i, py = y >> i;
+			if (!compressedFormat || (level.width >= 4 && level.height >= 4))
+			{
+				uploadRect(i, px, py, layer, level, image.components);
+				continue;
+			}
+			int levelWidth = std::max(1, width >> i), levelHeight = std::max(1, height >> i);
+			int bx = px & ~3, by = py & ~3;
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, bx, by, layer, std::min(4, levelWidth - bx), std::min(4, levelHeight - by), 1, compressedFormat,
+																(GLsizei)blockBytes(), level.data.data());
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	// bytes of all levels and layers
+	size_t size() const
+	{
+		size_t bytes = 0;
+		for (int i = 0; i < levels; i++)
+		{
+			int w = std::max(1, width >> i), h = std::max(1, height >> i);
+			bytes += compressedFormat ? blockBytes() * blocks(w) * blocks(h) : (size_t)w * h * 4;
+		}
+		return bytes * layers;
+	}
+
+	void dispose()
+	{
+		glDeleteTextures(1, &id);
+		id = 0;
+	}
+
+private:
+	static size_t blocks(int pixels)
+	{
+		return (size_t)(pixels + 3) / 4;
+	}
+
+	// BC1 blocks are 8 bytes, BC3 / BC5 / BC7 16
+	size_t blockBytes() const
+	{
+		bool bc1 = compressedFormat == 0x83F0 || compressedFormat == 0x8C4C; // GL_COMPRESSED_(S)RGB_S3TC_DXT1_EXT
+		return bc1 ? 8 : 16;
+	}
+
+	void uploadRect(int level, int x, int y, int layer, const ImageLevel &data, int components)
+	{
+		if (compressedFormat)
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x, y, layer, data.width, data.height, 1, compressedFormat, (GLsizei)data.data.size(), data.data.data());
+		else
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x, y, layer, data.width, data.height, 1, pixelFormat(components), GL_UNSIGNED_BYTE, data.data.data());
+	}
+};
+
+// Shelf packer for square power of two tiles on pages of width x height. Tiles have to arrive largest first; each
+// tile then lands on a multiple of its own size.
+class AtlasPacker
+{
+public:
+	int width;
+	int height;
+	int pages = 0;
+
+	AtlasPacker(int width, int height) : width(width), height(height) {}
+
+	bool add(int size, int &page, int &x, int &y)
+	{
+		if (size > width || size > height)
+			return false;
+		if (pages == 0 || cursorX + size > width)
+		{
+			cursorX = 0;
+			cursorY += shelfHeight;
+			shelfHeight = 0;
+		}
+		if (pages == 0 || cursorY + size > height)
+		{
+			pages++;
+			cursorX = cursorY = shelfHeight = 0;
+		}
+		page = pages - 1;
+		x = cursorX;
+		y = cursorY;
+		cursorX += size;
+		shelfHeight = std::max(shelfHeight, size);
+		return true;
+	}
+
+private:
+	int cursorX = 0;
+	int cursorY = 0;
+	int shelfHeight = 0;
+};
+
+// what the planner needs to know about one mesh
+struct MeshTextureSet
+{
+	string keys[TEXTURE_SLOTS]; // identifies the image (the decode key); empty if the slot is unused
+	int width[TEXTURE_SLOTS] = {};
+	int height[TEXTURE_SLOTS] = {};
+	bool uvInUnitSquare = false; // all texture coordinates inside [0, 1], so they can be squeezed into an atlas rect
+};
+
+// where an image goes: a whole layer, or a tile at x, y of a layer
+struct TextureDestination
+{
+	int set;
+	int slot;
+	int layer;
+	bool tile;
+	int x;
+	int y;
+};
+
+// Import time packing: array sizes, per mesh set / layers / UV rect, and the destinations of every image.
+// Set 0 holds the shared arrays, the others belong to one mesh each.
+struct TextureArrayPlan
+{
+	struct ArrayShape
+	{
+		int width = 0;
+		int height = 0;
+		int layers = 0;
+	};
+	vector<array<ArrayShape, TEXTURE_SLOTS>> sets;
+	vector<int> meshSet;
+	vector<glm::ivec4> meshLayers;			// -1 for unused slots
+	vector<glm::vec4> meshUvTransform; // uv * xy + zw
+	map<string, vector<TextureDestination>> destinations;
+	int layerWidth = 0;
+	int layerHeight = 0;
+	unsigned int atlasTiles = 0;
+	int atlasPages = 0;
+};
+
+inline bool isPowerOfTwo(int value)
+{
+	return value > 0 && (value & (value - 1)) == 0;
+}
+
+inline TextureArrayPlan planTextureArrays(const vector<MeshTextureSet> &meshes)
+{
+	TextureArrayPlan plan;
+	plan.sets.resize(1);
+	plan.meshSet.assign(meshes.size(), 0);
+	plan.meshLayers.assign(meshes.size(), glm::ivec4(-1));
+	plan.meshUvTransform.assign(meshes.size(), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f));
+
+	// the layer size is the most common image size
+	map<pair<int, int>, int> sizeCount;
+	for (unsigned int m = 0; m < meshes.size(); m++)
+		for (int s = 0; s < TEXTURE_SLOTS; s++)
+			if (!meshes[m].keys[s].empty() && meshes[m].width[s] > 0)
+				sizeCount[make_pair(meshes[m].width[s], meshes[m].height[s])]++;
+	int best = 0;
+	for (auto it = sizeCount.begin(); it != sizeCount.end(); ++it)
+		if (it->second > best)
+		{
+			best = it->second;
+			plan.layerWidth = it->first.first;
+			plan.layerHeight = it->first.second;
+		}
+	bool atlasAllowed = isPowerOfTwo(plan.layerWidth) && isPowerOfTwo(plan.layerHeight);
+
+	// sort the meshes into whole layers, atlas tiles (by tile size) and private sets
+	enum Kind
+	{
+		UNUSED,
+		LAYERS,
+		TILE,
+		PRIVATE
+	};
+	vector<Kind> kinds(meshes.size(), UNUSED);
+	vector<int> tileSize(meshes.size(), 0);
+	for (unsigned int m = 0; m < meshes.size(); m++)
+	{
+		const MeshTextureSet &mesh = meshes[m];
+		bool any = false, full = true, tile = atlasAllowed && mesh.uvInUnitSquare;
+		int size = 0;
+		for (int s = 0; s < TEXTURE_SLOTS; s++)
+		{
+			if (mesh.keys[s].empty())
+				continue;
+			any = true;
+			full = full && mesh.width[s] == plan.layerWidth && mesh.height[s] == plan.layerHeight;
+			tile = tile && mesh.width[s] == mesh.height[s] && isPowerOfTwo(mesh.width[s]) && (size == 0 || size == mesh.width[s]) &&
+						 mesh.width[s] * 2 <= std::min(plan.layerWidth, plan.layerHeight);
+			size = mesh.width[s];
+		}
+		kinds[m] = !any ? UNUSED : (full ? LAYERS : (tile ? TILE : PRIVATE));
+		tileSize[m] = size;
+	}
+
+	// whole layers, one per distinct image and slot
+	array<map<string, int>, TEXTURE_SLOTS> layerOf;
+	for (unsigned int m = 0; m < meshes.size(); m++)
+	{
+		if (kinds[m] != LAYERS)
+			continue;
+		for (int s = 0; s < TEXTURE_SLOTS; s++)
+		{
+			const string &key = meshes[m].keys[s];
+			if (key.empty())
+				continue;
+			auto found = layerOf[s].find(key);
+			if (found == layerOf[s].end())
+			{
+				found = layerOf[s].insert(make_pair(key, plan.sets[0][s].layers++)).first;
+				plan.destinations[key].push_back({0, s, found->second, false, 0, 0});
+			}
+			plan.meshLayers[m][s] = found->second;
+		}
+	}
+
+	// atlas tiles, largest first; meshes with the same images share a rect
+	vector<unsigned int> tiled;
+	for (unsigned int m = 0; m < meshes.size(); m++)
+		if (kinds[m] == TILE)
+			tiled.push_back(m);
+	stable_sort(tiled.begin(), tiled.end(), [&](unsigned int a, unsigned int b) { return tileSize[a] > tileSize[b]; });
+	AtlasPacker packer(plan.layerWidth, plan.layerHeight);
+	struct Rect
+	{
+		int page, x, y;
+	};
+	map<string, Rect> rects;
+	vector<Rect> meshRect(meshes.size());
+	array<bool, TEXTURE_SLOTS> slotTiled = {};
+	for (unsigned int i = 0; i < tiled.size(); i++)
+	{
+		unsigned int m = tiled[i];
+		string material;
+		for (int s = 0; s < TEXTURE_SLOTS; s++)
+			material += meshes[m].keys[s] + '\n';
+		auto found = rects.find(material);
+		if (found == rects.end())
+		{
+			Rect rect;
+			packer.add(tileSize[m], rect.page, rect.x, rect.y);
+			found = rects.insert(make_pair(material, rect)).first;
+			plan.atlasTiles++;
+			for (int s = 0; s < TEXTURE_SLOTS; s++)
+				if (!meshes[m].keys[s].empty())
+					slotTiled[s] = true;
+		}
+		meshRect[m] = found->second;
+		float size = (float)tileSize[m];
+		plan.meshUvTransform[m] = glm::vec4(size / plan.layerWidth, size / plan.layerHeight, (float)found->second.x / plan.layerWidth,
+																				(float)found->second.y / plan.layerHeight);
+	}
+	plan.atlasPages = packer.pages;
+
+	// the atlas pages follow the whole layers of each slot
+	set<string> queued;
+	for (unsigned int i = 0; i < tiled.size(); i++)
+	{
+		unsigned int m = tiled[i];
+		const Rect &rect = meshRect[m];
+		for (int s = 0; s < TEXTURE_SLOTS; s++)
+		{
+			const string &key = meshes[m].keys[s];
+			if (key.empty())
+				continue;
+			int layer = plan.sets[0][s].layers + rect.page;
+			plan.meshLayers[m][s] = layer;
+			if (queued.insert(to_string(s) + ' ' + to_string(layer) + ' ' + to_string(rect.x) + ' ' + to_string(rect.y)).second)
+				plan.destinations[key].push_back({0, s, layer, true, rect.x, rect.y});
+		}
+	}
+	for (int s = 0; s < TEXTURE_SLOTS; s++)
+	{
+		if (slotTiled[s])
+			plan.sets[0][s].layers += plan.atlasPages;
+		if (plan.sets[0][s].layers)
+		{
+			plan.sets[0][s].width = plan.layerWidth;
+			plan.sets[0][s].height = plan.layerHeight;
+		}
+	}
+
+	// everything else: one layer arrays of the image's own size
+	for (unsigned int m = 0; m < meshes.size(); m++)
+	{
+		if (kinds[m] != PRIVATE)
+			continue;
+		plan.meshSet[m] = (int)plan.sets.size();
+		plan.sets.push_back(array<TextureArrayPlan::ArrayShape, TEXTURE_SLOTS>());
+		for (int s = 0; s < TEXTURE_SLOTS; s++)
+		{
+			const string &key = meshes[m].keys[s];
+			if (key.empty() || meshes[m].width[s] <= 0)
+				continue;
+			plan.sets.back()[s] = {meshes[m].width[s], meshes[m].height[s], 1};
+			plan.meshLayers[m][s] = 0;
+			plan.destinations[key].push_back({plan.meshSet[m], s, 0, false, 0, 0});
+		}
+	}
+	return plan;
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <tool/texture_loader.h>
+#include <tool/mipmap.h>
+#include <tool/texture_compress.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// One GL texture object. The name is generated when the resource is created, the texels may be uploaded later
+// (see Model, which decodes on the thread pool). The texture is deleted with the last handle.
+struct TextureResource
+{
+	unsigned int id = 0;
+	string path; // canonical path
+	TextureOptions options;
+	int width = 0;
+	int height = 0;
+	size_t bytes = 0; // level 0 size as uploaded
+
+	~TextureResource();
+};
+
+typedef shared_ptr<TextureResource> TextureHandle;
+
+struct TextureCacheStats
+{
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int live = 0;	// textures currently owned by at least one handle
+	size_t liveBytes = 0;
+};
+
+// Process-wide texture cache keyed by canonical path plus options. The map only holds weak references,
+// so it never keeps a texture alive by itself; entries of released textures are reused on the next miss.
+class TextureCache
+{
+public:
+	static TextureCache &global()
+	{
+		static TextureCache cache;
+		return cache;
+	}
+
+	// returns the texture for path, creating the GL name on a miss; *created tells the caller it has to upload the texels
+	TextureHandle acquire(const string &path, const TextureOptions &options, bool *created)
+	{
+		string canonical = canonicalPath(path);
+		string key = canonical + '|' + options.key();
+		if (options.compressed)
+			compressionSupport();
+
+		lock_guard<mutex> lock(guard);
+		weak_ptr<TextureResource> &entry = entries[key];
+		TextureHandle handle = entry.lock();
+		if (handle)
+		{
+			stats.hits++;
+			*created = false;
+			return handle;
+		}
+
+		stats.misses++;
+		handle = make_shared<TextureResource>();
+		glGenTextures(1, &handle->id);
+		handle->path = canonical;
+		handle->options = options;
+		entry = handle;
+		*created = true;
+		return handle;
+	}
+
+	// true if the texture is alive in the cache; no GL calls, so workers may use it to skip decodes
+	bool contains(const string &path, const TextureOptions &options)
+	{
+		string key = canonicalPath(path) + '|' + options.key();
+		lock_guard<mutex> lock(guard);
+		auto it = entries.find(key);
+		return it != entries.end() && !it->second.expired();
+	}
+
+	// synchronous load: decode and upload on the calling thread, which must own the GL context
+	TextureHandle load(const string &path, const TextureOptions &options = TextureOptions())
+	{
+		bool created;
+		TextureHandle handle = acquire(path, options, &created);
+		if (created)
+		{
+			DecodedImage image = loadImage(handle->path, options);
+			if (!uploadImage(handle->id, image))
+				std::cout << "Texture failed to load at path: " << path << std::endl;
+			setUploaded(*handle, image);
+			freeImage(image);
+		}
+		return handle;
+	}
+
+	// CPU side of load(): the full mip chain, 8 bit or block compressed, from (or into) the KTX cache next to the image.
+	// Safe on worker threads; with options.compressed the GL thread must have called compressionSupport() first, acquire() does.
+	static DecodedImage loadImage(const string &filename, const TextureOptions &options)
+	{
+		if (options.compressed)
+			return loadCompressedImage(filename, options);
+		return loadMippedImage(filename, options);
+	}
+
+	// records the size of a texture that was filled outside of load()
+	void setUploaded(TextureResource &texture, const DecodedImage &image)
+	{
+		texture.width = image.width;
+		texture.height = image.height;
+		texture.bytes = image.valid() ? image.size() : 0;
+	}
+
+	TextureCacheStats statistics()
+	{
+		lock_guard<mutex> lock(guard);
+		TextureCacheStats result = stats;
+		for (auto it = entries.begin(); it != entries.end(); ++it)
+		{
+			TextureHandle handle = it->second.lock();
+			if (handle)
+			{
+				result.live++;
+				result.liveBytes += handle->bytes;
+			}
+		}
+		return result;
+	}
+
+	void printStatistics()
+	{
+		TextureCacheStats current = statistics();
+		cout << "TEXTURE_CACHE:: " << current.hits << " hits, " << current.misses << " misses, " << current.live << " live textures, "
+				 << current.liveBytes / (1024 * 1024) << " MB" << endl;
+	}
+
+	// call before the GL context goes away; textures still referenced afterwards are not deleted again
+	void shutdown()
+	{
+		lock_guard<mutex> lock(guard);
+		for (auto it = entries.begin(); it != entries.end(); ++it)
+		{
+			TextureHandle handle = it->second.lock();
+			if (handle && handle->id)
+			{
+				glDeleteTextures(1, &handle->id);
+				handle->id = 0;
+			}
+		}
+		entries.clear();
+		contextAlive = false;
+	}
+
+	bool hasContext() const
+	{
+		return contextAlive;
+	}
+
+	// lexical normalisation: '\' to '/', "." and "dir/.." removed; case is kept, so on Windows differently cased paths miss
+	static string canonicalPath(const string &path)
+	{
+		string normalized = path;
+		replace(normalized.begin(), normalized.end(), '\\', '/');
+		bool absolute = !normalized.empty() && normalized[0] == '/';
+
+		vector<string> parts;
+		size_t begin = 0;
+		while (begin <= normalized.size())
+		{
+			size_t end = normalized.find('/', begin);
+			if (end == string::npos)
+				end = normalized.size();
+			string part = normalized.substr(begin, end - begin);
+			if (part == ".." && !parts.empty() && parts.back() != "..")
+				parts.pop_back();
+			else if (!part.empty() && part != ".")
+				parts.push_back(part);
+			begin = end + 1;
+		}
+
+		string result = absolute ? "/" : "";
+		for (unsigned int i = 0; i < parts.size(); i++)
+			result += (i ? "/" : "") + parts[i];
+		return result;
+	}
+
+private:
+	mutex guard;
+	unordered_map<string, weak_ptr<TextureResource>> entries;
+	TextureCacheStats stats;
+	bool contextAlive = true;
+};
+
+inline TextureResource::~TextureResource()
+{
+	if (id && TextureCache::global().hasContext())
+		glDeleteTextures(1, &id);
+}
+
+#endif
@@ -0,0 +1,579 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tool/texture_loader.h>
+#include <tool/mipmap.h>
+#include <tool/ktx.h>
+#include <tool/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESS_USE_SSE 1
+#endif
+
+// S3TC is an extension, glad was generated for the core profile only
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+using namespace std;
+
+// CPU block compression to BC1 (opaque color), BC3 (color + alpha), BC5 (two channel normal maps) and BC7 (mode 6 only:
+// one subset, 7 bit RGBA endpoints with a p-bit, 4 bit indices). Endpoints come from the principal axis of the block,
+// indices from projecting onto the quantized endpoints, followed by one least squares refit.
+// The mip chain comes from tool/mipmap.h and is cached with the blocks as KTX 1.1 file next to the source image
+// ("<image>.<format>[f][s].ktx", see tool/ktx.h). sRGB color uses the sRGB variant of the format.
+// BC5 only stores x and y: shaders sampling a texture_normal slot rebuild z = sqrt(1 - dot(xy, xy)).
+
+enum BlockFormat
+{
+	BLOCK_BC1,
+	BLOCK_BC3,
+	BLOCK_BC5,
+	BLOCK_BC7
+};
+
+inline GLenum blockFormatGL(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BLOCK_BC1:
+		return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BLOCK_BC3:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BLOCK_BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	default:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+}
+
+inline const char *blockFormatName(BlockFormat format)
+{
+	static const char *names[] = {"bc1", "bc3", "bc5", "bc7"};
+	return names[format];
+}
+
+inline unsigned int blockFormatBytes(BlockFormat format)
+{
+	return format == BLOCK_BC1 ? 8 : 16;
+}
+
+// Formats the driver can sample. Must first be called on the GL thread; after that any thread may read it.
+struct CompressionSupport
+{
+	bool s3tc = false;
+	bool bptc = false;
+	bool rgtc = false;
+};
+
+inline const CompressionSupport &compressionSupport()
+{
+	static CompressionSupport support;
+	static atomic<bool> queried(false);
+	if (queried)
+		return support;
+
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+	vector<GLint> formats(count > 0 ? count : 0);
+	if (count > 0)
+		glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+	for (unsigned int i = 0; i < formats.size(); i++)
+	{
+		support.s3tc |= formats[i] == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		support.bptc |= formats[i] == GL_COMPRESSED_RGBA_BPTC_UNORM;
+		support.rgtc |= formats[i] == GL_COMPRESSED_RG_RGTC2;
+	}
+	// core profiles may leave extension formats out of the list
+	GLint extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for (GLint i = 0; i < extensions; i++)
+	{
+		const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (!name)
+			continue;
+		support.s3tc |= strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+		support.bptc |= strcmp(name, "GL_ARB_texture_compression_bptc") == 0;
+	}
+	support.bptc |= GLAD_GL_VERSION_4_2 != 0;
+	support.rgtc = true; // core since 3.0
+	queried = true;
+	return support;
+}
+
+namespace bc
+{
+	// one 4x4 block as floats, channel major so four pixels go through one SSE register
+	struct Block
+	{
+		float channel[4][16];
+	};
+
+	inline void loadBlock(const unsigned char *pixels, int width, int height, int components, int blockX, int blockY, Block &block)
+	{
+		for (int y = 0; y < 4; y++)
+			for (int x = 0; x < 4; x++)
+			{
+				// edge blocks of sizes that are not a multiple of 4 repeat the last row / column
+				int px = std::min(blockX * 4 + x, width - 1);
+				int py = std::min(blockY * 4 + y, height - 1);
+				const unsigned char *p = pixels + ((size_t)py * width + px) * components;
+				int i = y * 4 + x;
+				if (components >= 3)
+				{
+					block.channel[0][i] = p[0];
+					block.channel[1][i] = p[1];
+					block.channel[2][i] = p[2];
+				}
+				else
+					block.channel[0][i] = block.channel[1][i] = block.channel[2][i] = p[0];
+				block.channel[3][i] = components == 4 ? p[3] : (components == 2 ? p[1] : 255.0f);
+			}
+	}
+
+	// t = clamp(dot(p - origin, axis) * scale, 0, 1) * (levels - 1), rounded, for the 16 pixels of the first 'channels' channels
+	inline void projectIndices(const Block &block, int channels, const float origin[4], const float axis[4], float scale, int levels, int indices[16])
+	{
+#ifdef TEXTURE_COMPRESS_USE_SSE
+		__m128 maxIndex = _mm_set1_ps((float)(levels - 1));
+		__m128 half = _mm_set1_ps(0.5f);
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 dot = _mm_setzero_ps();
+			for (int c = 0; c < channels; c++)
+			{
+				__m128 d = _mm_sub_ps(_mm_loadu_ps(&block.channel[c][i]), _mm_set1_ps(origin[c]));
+				dot = _mm_add_ps(dot, _mm_mul_ps(d, _mm_set1_ps(axis[c])));
+			}
+			__m128 t = _mm_mul_ps(dot, _mm_set1_ps(scale * (levels - 1)));
+			t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), maxIndex);
+			_mm_storeu_si128((__m128i *)&indices[i], _mm_cvttps_epi32(_mm_add_ps(t, half)));
+		}
+#else
+		for (int i = 0; i < 16; i++)
+		{
+			float dot = 0.0f;
+			for (int c = 0; c < channels; c++)
+				dot += (block.channel[c][i] - origin[c]) * axis[c];
+			float t = std::min(std::max(dot * scale * (levels - 1), 0.0f), (float)(levels - 1));
+			indices[i] = (int)(t + 0.5f);
+		}
+#endif
+	}
+
+	// principal axis of the block (power iteration on the covariance); returns the mean and the projected range along the axis
+	inline void principalAxis(const Block &block, int channels, float mean[4], float axis[4], float &minT, float &maxT)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			mean[c] = 0.0f;
+			for (int i = 0; i < 16; i++)
+				mean[c] += block.channel[c][i];
+			mean[c] /= 16.0f;
+		}
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++)
+			for (int a = 0; a < channels; a++)
+				for (int b = a; b < channels; b++)
+					covariance[a][b] += (block.channel[a][i] - mean[a]) * (block.channel[b][i] - mean[b]);
+		for (int a = 0; a < channels; a++)
+			for (int b = 0; b < a; b++)
+				covariance[a][b] = covariance[b][a];
+
+		// start from the covariance row of the widest channel, a fixed start vector can be orthogonal to the answer
+		int widest = 0;
+		for (int c = 1; c < channels; c++)
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		for (int c = 0; c < 4; c++)
+			axis[c] = c < channels ? covariance[widest][c] : 0.0f;
+		if (covariance[widest][widest] <= 0.0f)
+			axis[0] = 1.0f;
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			for (int a = 0; a < channels; a++)
+				for (int b = 0; b < channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+			float length = 0.0f;
+			for (int c = 0; c < channels; c++)
+				length = std::max(length, std::fabs(next[c]));
+			if (length < 1e-6f)
+				break;
+			for (int c = 0; c < channels; c++)
+				axis[c] = next[c] / length;
+		}
+		float length = 0.0f;
+		for (int c = 0; c < channels; c++)
+			length += axis[c] * axis[c];
+		length = std::sqrt(length);
+		for (int c = 0; c < channels; c++)
+			axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+
+		minT = 1e30f, maxT = -1e30f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < channels; c++)
+				t += (block.channel[c][i] - mean[c]) * axis[c];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+	}
+
+	// endpoints minimising the squared error for fixed interpolation weights (index -> weight in [0, 1])
+	inline bool refitEndpoints(const Block &block, int channels, const int indices[16], const float *weights, float e0[4], float e1[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			float b = weights[indices[i]], a = 1.0f - b;
+			aa += a * a, ab += a * b, bb += b * b;
+			for (int c = 0; c < channels; c++)
+			{
+				ax[c] += a * block.channel[c][i];
+				bx[c] += b * block.channel[c][i];
+			}
+		}
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+		for (int c = 0; c < channels; c++)
+		{
+			e0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			e1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	inline void endpointsFromAxis(const float mean[4], const float axis[4], float minT, float maxT, int channels, float e0[4], float e1[4])
+	{
+		// pull the endpoints in a little: the extremes are usually single outliers
+		float inset = (maxT - minT) / 32.0f;
+		minT += inset, maxT -= inset;
+		for (int c = 0; c < channels; c++)
+		{
+			e0[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+			e1[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+		}
+	}
+
+	inline void setupProjection(const float e0[4], const float e1[4], int channels, float axis[4], float &scale)
+	{
+		float length2 = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			axis[c] = c < channels ? e1[c] - e0[c] : 0.0f;
+			length2 += axis[c] * axis[c];
+		}
+		scale = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+	}
+
+	inline uint16_t packRGB565(const float color[4])
+	{
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	inline void unpackRGB565(uint16_t packed, float color[4])
+	{
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (float)((r << 3) | (r >> 2));
+		color[1] = (float)((g << 2) | (g >> 4));
+		color[2] = (float)((b << 3) | (b >> 2));
+	}
+
+	inline void encodeBC1(const Block &block, unsigned char *output)
+	{
+		float mean[4], axis[4], minT, maxT, e0[4] = {}, e1[4] = {};
+		principalAxis(block, 3, mean, axis, minT, maxT);
+		endpointsFromAxis(mean, axis, minT, maxT, 3, e0, e1);
+
+		// weights along e0 -> e1 in projection order
+		static const float weights[4] = {0.0f, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f};
+		int order[16];
+		float projectionAxis[4], scale;
+		setupProjection(e0, e1, 3, projectionAxis, scale);
+		projectIndices(block, 3, e0, projectionAxis, scale, 4, order);
+		refitEndpoints(block, 3, order, weights, e0, e1);
+
+		uint16_t c0 = packRGB565(e1), c1 = packRGB565(e0);
+		float q0[4], q1[4];
+		unpackRGB565(c0, q0);
+		unpackRGB565(c1, q1);
+		uint32_t bits = 0;
+		if (c0 != c1)
+		{
+			// 4 color mode needs c0 > c1; the palette runs c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+			static const int toPalette[4] = {1, 3, 2, 0}; // projection from c1 to c0
+			if (c0 < c1)
+			{
+				std::swap(c0, c1);
+				std::swap(q0, q1);
+			}
+			setupProjection(q1, q0, 3, projectionAxis, scale);
+			projectIndices(block, 3, q1, projectionAxis, scale, 4, order);
+			for (int i = 0; i < 16; i++)
+				bits |= (uint32_t)toPalette[order[i]] << (2 * i);
+		}
+		memcpy(output, &c0, 2);
+		memcpy(output + 2, &c1, 2);
+		memcpy(output + 4, &bits, 4);
+	}
+
+	// one channel, 8 value mode (a0 > a1); used for BC3 alpha and both BC5 channels
+	inline void encodeBC4(const Block &block, int channel, unsigned char *output)
+	{
+		float low = 255.0f, high = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			low = std::min(low, block.channel[channel][i]);
+			high = std::max(high, block.channel[channel][i]);
+		}
+		int a0 = (int)(high + 0.5f), a1 = (int)(low + 0.5f);
+		uint64_t bits = 0;
+		if (a0 > a1)
+		{
+			Block single;
+			memcpy(single.channel[0], block.channel[channel], sizeof(single.channel[0]));
+			float origin[4] = {(float)a1}, axis[4] = {1.0f};
+			int steps[16];
+			projectIndices(single, 1, origin, axis, 1.0f / (a0 - a1), 8, steps);
+			// step k has weight k/7 towards a0; palette index 0 is a0, 1 is a1, i = 2..7 weighs a0 by (8 - i)/7
+			for (int i = 0; i < 16; i++)
+			{
+				int k = steps[i];
+				uint64_t index = k == 7 ? 0 : (k == 0 ? 1 : 8 - k);
+				bits |= index << (3 * i);
+			}
+		}
+		output[0] = (unsigned char)a0;
+		output[1] = (unsigned char)a1;
+		for (int i = 0; i < 6; i++)
+			output[2 + i] = (unsigned char)(bits >> (8 * i));
+	}
+
+	inline void encodeBC3(const Block &block, unsigned char *output)
+	{
+		encodeBC4(block, 3, output);
+		encodeBC1(block, output + 8);
+	}
+
+	inline void encodeBC5(const Block &block, unsigned char *output)
+	{
+		encodeBC4(block, 0, output);
+		encodeBC4(block, 1, output + 8);
+	}
+
+	// little endian bit writer for the 128 bit BC7 block
+	struct BitWriter
+	{
+		unsigned char *output;
+		int position = 0;
+
+		void write(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; i++, position++)
+				if ((value >> i) & 1)
+					output[position >> 3] |= (unsigned char)(1 << (position & 7));
+		}
+	};
+
+	inline void encodeBC7(const Block &block, unsigned char *output)
+	{
+		static const int weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+		static const float weights[16] = {0.0f / 64, 4.0f / 64, 9.0f / 64, 13.0f / 64, 17.0f / 64, 21.0f / 64, 26.0f / 64, 30.0f / 64,
+																			34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64, 51.0f / 64, 55.0f / 64, 60.0f / 64, 1.0f};
+
+		float mean[4], axis[4], minT, maxT, e0[4], e1[4];
+		principalAxis(block, 4, mean, axis, minT, maxT);
+		endpointsFromAxis(mean, axis, minT, maxT, 4, e0, e1);
+		int indices[16];
+		float projectionAxis[4], scale;
+		setupProjection(e0, e1, 4, projectionAxis, scale);
+		projectIndices(block, 4, e0, projectionAxis, scale, 16, indices);
+		refitEndpoints(block, 4, indices, weights, e0, e1);
+
+		// try the four p-bit combinations on the quantized endpoints, keep the one with the lowest error
+		float bestError = 1e30f;
+		int bestQ0[4] = {}, bestQ1[4] = {}, bestP0 = 0, bestP1 = 0, bestIndices[16] = {};
+		for (int p = 0; p < 4; p++)
+		{
+			int p0 = p & 1, p1 = p >> 1, q0[4], q1[4];
+			float v0[4], v1[4];
+			for (int c = 0; c < 4; c++)
+			{
+				q0[c] = std::min(std::max((int)((e0[c] - p0) * 0.5f + 0.5f), 0), 127);
+				q1[c] = std::min(std::max((int)((e1[c] - p1) * 0.5f + 0.5f), 0), 127);
+				v0[c] = (float)(q0[c] * 2 + p0);
+				v1[c] = (float)(q1[c] * 2 + p1);
+			}
+			int candidate[16];
+			setupProjection(v0, v1, 4, projectionAxis, scale);
+			projectIndices(block, 4, v0, projectionAxis, scale, 16, candidate);
+
+			float error = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				int w = weights4[candidate[i]];
+				for (int c = 0; c < 4; c++)
+				{
+					float value = (float)((((64 - w) * (int)v0[c] + w * (int)v1[c] + 32) >> 6));
+					float d = value - block.channel[c][i];
+					error += d * d;
+				}
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestQ0, q0, sizeof(q0));
+				memcpy(bestQ1, q1, sizeof(q1));
+				bestP0 = p0, bestP1 = p1;
+				memcpy(bestIndices, candidate, sizeof(candidate));
+			}
+		}
+
+		// the anchor (pixel 0) index is stored with 3 bits, so its top bit must be clear
+		if (bestIndices[0] >= 8)
+		{
+			std::swap(bestQ0, bestQ1);
+			std::swap(bestP0, bestP1);
+			for (int i = 0; i < 16; i++)
+				bestIndices[i] = 15 - bestIndices[i];
+		}
+
+		memset(output, 0, 16);
+		BitWriter writer = {output};
+		writer.write(1u << 6, 7); // mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			writer.write(bestQ0[c], 7);
+			writer.write(bestQ1[c], 7);
+		}
+		writer.write(bestP0, 1);
+		writer.write(bestP1, 1);
+		writer.write(bestIndices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writer.write(bestIndices[i], 4);
+	}
+}
+
+// Compresses one RGBA8/RGB8/RG8/R8 image. Block rows are spread over the thread pool (inline when called from a worker).
+inline ImageLevel compressLevel(const unsigned char *pixels, int width, int height, int components, BlockFormat format)
+{
+	ImageLevel level;
+	level.width = width;
+	level.height = height;
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	unsigned int blockBytes = blockFormatBytes(format);
+	level.data.resize((size_t)blocksX * blocksY * blockBytes);
+
+	parallelFor(blocksY, 4, [&](size_t begin, size_t end) {
+		bc::Block block;
+		for (size_t by = begin; by < end; by++)
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				bc::loadBlock(pixels, width, height, components, bx, (int)by, block);
+				unsigned char *output = &level.data[(by * blocksX + bx) * blockBytes];
+				if (format == BLOCK_BC1)
+					bc::encodeBC1(block, output);
+				else if (format == BLOCK_BC3)
+					bc::encodeBC3(block, output);
+				else if (format == BLOCK_BC5)
+					bc::encodeBC5(block, output);
+				else
+					bc::encodeBC7(block, output);
+			}
+	});
+	return level;
+}
+
+// picks the block format for an image: BC5 for normal maps, BC7 where supported, else BC1 / BC3 depending on alpha
+inline BlockFormat chooseBlockFormat(const DecodedImage &image, bool normalMap)
+{
+	const CompressionSupport &support = compressionSupport();
+	if (normalMap)
+		return BLOCK_BC5;
+	if (support.bptc)
+		return BLOCK_BC7;
+	if (image.components == 4 || image.components == 2)
+	{
+		size_t count = (size_t)image.width * image.height;
+		for (size_t i = 0; i < count; i++)
+			if (image.data[i * image.components + image.components - 1] != 255)
+				return BLOCK_BC3;
+	}
+	return BLOCK_BC1;
+}
+
+// block compresses every level of an image whose mip chain was built with buildMipChain(); the levels stay gamma
+// encoded, an sRGB format decodes them when sampling
+inline void compressImage(DecodedImage &image, BlockFormat format)
+{
+	for (unsigned int i = 0; i < image.levels.size(); i++)
+	{
+		ImageLevel &level = image.levels[i];
+		level = compressLevel(level.data.data(), level.width, level.height, image.components, format);
+	}
+	image.compressedFormat = blockFormatGL(format, image.srgb && format != BLOCK_BC5);
+}
+
+// decode-or-reuse entry point: reads "<filename>.<format>[f][s].ktx" when it is up to date, otherwise decodes, builds the
+// mip chain, compresses and writes it. Without driver support the image stays uncompressed (loadMippedImage).
+// Safe on worker threads once compressionSupport() was queried on the GL thread.
+inline DecodedImage loadCompressedImage(const string &filename, const TextureOptions &options)
+{
+	const CompressionSupport &support = compressionSupport();
+	if (!options.normalMap && !support.bptc && !support.s3tc)
+		return loadMippedImage(filename, options);
+
+	DecodedImage image;
+	auto start = chrono::steady_clock::now();
+	string tag = mipTag(options);
+	BlockFormat candidates[2] = {options.normalMap ? BLOCK_BC5 : (support.bptc ? BLOCK_BC7 : BLOCK_BC1), BLOCK_BC3};
+	for (int i = 0; i < (options.normalMap || support.bptc ? 1 : 2); i++)
+		if (ktx::read(ktx::cachePath(filename, blockFormatName(candidates[i]), options.flipVertically, options.srgb), filename, tag, image))
+		{
+			image.decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			return image;
+		}
+
+	image = decodeImage(filename, options.flipVertically);
+	if (!image.data)
+		return image;
+	BlockFormat format = chooseBlockFormat(image, options.normalMap);
+	buildMipChain(image, mipOptions(options));
+	compressImage(image, format);
+	if (!ktx::write(ktx::cachePath(filename, blockFormatName(format), options.flipVertically, options.srgb), filename, tag, image))
+		cout << "ERROR::KTX:: could not write cache for " << filename << endl;
+	image.decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return image;
+}
+
+#endif
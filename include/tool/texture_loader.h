@@ -0,0 +1,180 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+// the chapters include stb_image.h themselves under STB_IMAGE_IMPLEMENTATION; a second inclusion would define it twice
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <tool/stb_image.h>
+#endif
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Texture loading in two halves: decodeImage() is plain CPU work and may run on any thread,
+// uploadImage() issues the GL calls and must run on the thread that owns the context.
+// The flip is passed per decode and set through stb_image's thread local flag, so the global
+// stbi_set_flip_vertically_on_load state of the chapters does not leak into pool threads.
+
+// kernel used to build mip levels on the CPU, see tool/mipmap.h
+enum MipFilter
+{
+	MIP_BOX,		// 2x2 average
+	MIP_KAISER // Kaiser windowed sinc, sharper minification
+};
+
+// options that change the texels of a texture; they are part of the texture cache key
+struct TextureOptions
+{
+	bool flipVertically = false;
+	bool srgb = false;			 // color data stored gamma encoded: sRGB internal format, mips filtered in linear light
+	bool compressed = false; // block compress on the CPU and keep a KTX copy next to the image, see tool/texture_compress.h
+	bool normalMap = false;	 // tangent space normals: renormalized mips, two channel BC5 when compressed
+	MipFilter mipFilter = MIP_KAISER;
+
+	string key() const
+	{
+		return string(flipVertically ? "f" : "-") + (srgb ? "s" : "-") + (compressed ? "c" : "-") + (normalMap ? "n" : "-") +
+					 (mipFilter == MIP_BOX ? "b" : "k");
+	}
+};
+
+// one mip level, either 8 bit pixels with the image's component count or block compressed data
+struct ImageLevel
+{
+	int width;
+	int height;
+	vector<unsigned char> data;
+};
+
+// 8 bit pixels from stb_image (data), or a full mip chain in levels: 8 bit pixels filtered on the CPU (tool/mipmap.h)
+// or block compressed (compressedFormat != 0, tool/texture_compress.h).
+struct DecodedImage
+{
+	unsigned char *data = nullptr;
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	double decodeMs = 0.0; // time spent in stbi_load, or loading / filtering / compressing the levels
+
+	bool srgb = false; // upload as SRGB8 / SRGB8_ALPHA8
+	GLenum compressedFormat = 0;
+	vector<ImageLevel> levels;
+
+	bool valid() const
+	{
+		return data || !levels.empty();
+	}
+
+	// bytes handed to GL: level 0 of plain stb_image pixels, otherwise the whole chain
+	size_t size() const
+	{
+		if (!levels.empty())
+		{
+			size_t bytes = 0;
+			for (unsigned int i = 0; i < levels.size(); i++)
+				bytes += levels[i].data.size();
+			return bytes;
+		}
+		return (size_t)width * height * components;
+	}
+};
+
+inline DecodedImage decodeImage(const string &filename, bool flipVertically)
+{
+	DecodedImage image;
+	auto start = chrono::steady_clock::now();
+	stbi_set_flip_vertically_on_load_thread(flipVertically);
+	image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+	image.decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return image;
+}
+
+inline void freeImage(DecodedImage &image)
+{
+	stbi_image_free(image.data);
+	image.data = nullptr;
+}
+
+inline GLenum pixelFormat(int components)
+{
+	if (components == 1)
+		return GL_RED;
+	if (components == 2)
+		return GL_RG;
+	if (components == 4)
+		return GL_RGBA;
+	return GL_RGB;
+}
+
+// sized internal format for 8 bit pixels; there is no one or two channel sRGB format in core GL
+inline GLenum pixelInternalFormat(int components, bool srgb)
+{
+	if (components == 1)
+		return GL_R8;
+	if (components == 2)
+		return GL_RG8;
+	if (components == 4)
+		return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	return srgb ? GL_SRGB8 : GL_RGB8;
+}
+
+// uploads into an existing texture object; returns false if the decode had failed. Images with levels upload every
+// level as is, plain stb_image pixels fall back to glGenerateMipmap.
+inline bool uploadImage(unsigned int textureID, const DecodedImage &image)
+{
+	if (!image.valid())
+		return false;
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	if (image.compressedFormat)
+	{
+		for (unsigned int i = 0; i < image.levels.size(); i++)
+		{
+			const ImageLevel &level = image.levels[i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, image.compressedFormat, level.width, level.height, 0, (GLsizei)level.data.size(), level.data.data());
+		}
+	}
+	else
+	{
+		GLenum format = pixelFormat(image.components);
+		GLenum internalFormat = pixelInternalFormat(image.components, image.srgb);
+		// rows of 1 and 3 component images are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (image.levels.empty())
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+		for (unsigned int i = 0; i < image.levels.size(); i++)
+		{
+			const ImageLevel &level = image.levels[i];
+			glTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, level.data.data());
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (image.levels.empty())
+			glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.empty() ? 1000 : (GLint)image.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return true;
+}
+
+// fills a texture with a single texel until its image arrives, so streamed meshes can be drawn right away
+inline void uploadPlaceholder(unsigned int textureID, const unsigned char texel[4])
+{
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A small fixed-size worker pool. Jobs are plain std::function<void()>; submit() wraps them in a packaged_task so the caller can wait on the result.
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int threadCount = 0)
+	{
+		if (threadCount == 0)
+		{
+			// hardware_concurrency() is 0 when the core count is unknown; keep one core for the calling thread
+			unsigned int cores = std::thread::hardware_concurrency();
+			threadCount = cores > 1 ? cores - 1 : 1;
+		}
+		for (unsigned int i = 0; i < threadCount; i++)
+			workers.emplace_back([this]() { workerLoop(); });
+	}
+
+	// jobs that have not started are dropped (their futures report broken_promise), only the running ones are joined;
+	// the global pool goes away during static destruction, when queued jobs may depend on objects already destroyed
+	~ThreadPool()
+	{
+		std::queue<std::function<void()>> dropped;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+			dropped.swap(jobs);
+		}
+		condition.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	// the process wide pool shared by geometry, model and texture loading
+	static ThreadPool &global()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	// true when called from one of the pool's worker threads (of any pool)
+	static bool onWorkerThread()
+	{
+		return workerFlag();
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)workers.size();
+	}
+
+	template <typename F>
+	auto submit(F &&job) -> std::future<decltype(job())>
+	{
+		typedef decltype(job()) Result;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+		std::future<Result> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			jobs.push([task]() { (*task)(); });
+		}
+		condition.notify_one();
+		return result;
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex queueMutex;
+	std::condition_variable condition;
+	bool stopping = false;
+
+	static bool &workerFlag()
+	{
+		static thread_local bool isWorker = false;
+		return isWorker;
+	}
+
+	void workerLoop()
+	{
+		workerFlag() = true;
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (stopping)
+					return;
+				job = std::move(jobs.front());
+				jobs.pop();
+			}
+			job();
+		}
+	}
+};
+
+// Splits [0, count) into chunks of at least minChunk items and runs body(begin, end) on the global pool.
+// The calling thread takes the first chunk itself; nested calls from a worker run inline to avoid starving the pool.
+template <typename F>
+void parallelFor(size_t count, size_t minChunk, F &&body)
+{
+	if (count == 0)
+		return;
+	ThreadPool &pool = ThreadPool::global();
+	size_t maxChunks = pool.size() + 1;
+	size_t chunks = std::min(maxChunks, (count + minChunk - 1) / std::max<size_t>(minChunk, 1));
+	if (chunks <= 1 || ThreadPool::onWorkerThread())
+	{
+		body((size_t)0, count);
+		return;
+	}
+
+	size_t chunkSize = (count + chunks - 1) / chunks;
+	std::vector<std::future<void>> pending;
+	for (size_t begin = chunkSize; begin < count; begin += chunkSize)
+	{
+		size_t end = std::min(count, begin + chunkSize);
+		pending.push_back(pool.submit([&body, begin, end]() { body(begin, end); }));
+	}
+	body((size_t)0, std::min(count, chunkSize));
+	for (unsigned int i = 0; i < pending.size(); i++)
+		pending[i].get();
+}
+
+#endif
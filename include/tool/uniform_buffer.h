@@ -0,0 +1,197 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tool/shader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// The std140 blocks shared by the programs. Every member is a vec4 or a mat4, so the C++ layout is the std140 one.
+// The GLSL side, in any shader that wants them:
+//
+//   layout(std140) uniform FrameBlock
+//   {
+//     mat4 view;
+//     mat4 projection;
+//     mat4 viewProjection;
+//     vec4 cameraPosition; // w: time in seconds
+//   };
+//
+//   layout(std140) uniform MaterialBlock
+//   {
+//     vec4 ambient;
+//     float shininess;
+//   } material;
+//
+// Shader attaches blocks of these names to FRAME_BLOCK_BINDING / MATERIAL_BLOCK_BINDING when it links.
+
+struct FrameUniforms
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 cameraPosition;
+};
+
+struct MaterialUniforms
+{
+	glm::vec4 ambient = glm::vec4(0.0f);
+	float shininess = 32.0f;
+	float padding[3] = {0.0f, 0.0f, 0.0f}; // std140 rounds the block up to a vec4
+};
+
+inline FrameUniforms makeFrameUniforms(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition, float time = 0.0f)
+{
+	FrameUniforms frame;
+	frame.view = view;
+	frame.projection = projection;
+	frame.viewProjection = projection * view;
+	frame.cameraPosition = glm::vec4(cameraPosition, time);
+	return frame;
+}
+
+// The per-frame camera data of all programs: one upload per frame, however many programs read it.
+class FrameUniformBuffer
+{
+public:
+	unsigned int UBO = 0;
+
+	FrameUniformBuffer()
+	{
+		glGenBuffers(1, &UBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, UBO);
+	}
+
+	// the previous contents are invalidated so the driver never waits on the frames still reading them
+	void update(const FrameUniforms &frame)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		void *target = glMapBufferRange(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (target)
+		{
+			memcpy(target, &frame, sizeof(FrameUniforms));
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, UBO);
+	}
+
+	void dispose()
+	{
+		glDeleteBuffers(1, &UBO);
+		UBO = 0;
+	}
+};
+
+// Material blocks suballocated from one uniform buffer split into MATERIAL_RING_FRAMES regions, one per frame in
+// flight. bind() writes a block into the current region without synchronization and points MATERIAL_BLOCK_BINDING
+// at it with glBindBufferRange; beginFrame() moves on to the next region, waiting on the fence of the frame that
+// last used it (three frames ago, so normally already signaled).
+const unsigned int MATERIAL_RING_FRAMES = 3;
+
+class MaterialUniformRing
+{
+public:
+	unsigned int UBO = 0;
+	unsigned int stride = 0;	 // bytes per block, rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	unsigned int capacity = 0; // blocks per region
+	unsigned int count = 0;		 // blocks written to the current region
+
+	MaterialUniformRing(unsigned int blocksPerFrame = 64)
+	{
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		alignment = std::max(alignment, 1);
+		stride = (unsigned int)((sizeof(MaterialUniforms) + alignment - 1) / alignment * alignment);
+		glGenBuffers(1, &UBO);
+		reserve(std::max(blocksPerFrame, 1u));
+	}
+
+	// call once per frame before the first bind()
+	void beginFrame()
+	{
+		region = (region + 1) % MATERIAL_RING_FRAMES;
+		count = 0;
+		if (fences[region])
+		{
+			// a timeout in nanoseconds, the flush makes sure the fence gets signaled at all
+			GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+			while (status == GL_TIMEOUT_EXPIRED)
+				status = glClientWaitSync(fences[region], 0, 1000000000ull);
+			glDeleteSync(fences[region]);
+			fences[region] = 0;
+		}
+	}
+
+	// call once per frame after the last draw that reads a block of the frame
+	void endFrame()
+	{
+		if (count > 0)
+			fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// writes the material into the next block of the frame and binds it
+	void bind(const MaterialUniforms &material)
+	{
+		if (count == capacity)
+			reserve(capacity * 2);
+		GLintptr offset = (GLintptr)(region * capacity + count) * stride;
+		count++;
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		// the region is not read by any pending draw (see beginFrame), and earlier blocks of this frame are not touched
+		void *target = glMapBufferRange(GL_UNIFORM_BUFFER, offset, sizeof(MaterialUniforms), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (target)
+		{
+			memcpy(target, &material, sizeof(MaterialUniforms));
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, UBO, offset, sizeof(MaterialUniforms));
+	}
+
+	void dispose()
+	{
+		for (unsigned int i = 0; i < MATERIAL_RING_FRAMES; i++)
+			if (fences[i])
+			{
+				glDeleteSync(fences[i]);
+				fences[i] = 0;
+			}
+		glDeleteBuffers(1, &UBO);
+		UBO = 0;
+		capacity = count = 0;
+	}
+
+private:
+	unsigned int region = 0;
+	GLsync fences[MATERIAL_RING_FRAMES] = {0, 0, 0};
+
+	// new storage for all regions; draws already issued keep reading the orphaned one, the blocks bound earlier in
+	// this frame are not needed again since every block is bound right after it is written
+	void reserve(unsigned int blocks)
+	{
+		capacity = blocks;
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)MATERIAL_RING_FRAMES * capacity * stride, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		for (unsigned int i = 0; i < MATERIAL_RING_FRAMES; i++)
+			if (fences[i])
+			{
+				glDeleteSync(fences[i]);
+				fences[i] = 0;
+			}
+		count = 0;
+	}
+};
+
+#endif
@@ -10,6 +10,7 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <tool/stb_image.h>
+#include <tool/texture_cache.h>
 
 #include <tool/gui.h>
 
@@ -24,7 +25,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 
-unsigned int loadTexture(char const * path);
+TextureHandle loadTexture(char const *path);
 
 std::string Shader::dirName;
 
@@ -120,9 +121,9 @@ int main()
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-  unsigned int diffuseMap = loadTexture("static/texture/container2.png");
-  unsigned int specularMap = loadTexture("static/texture/container2_specular.png");
-  unsigned int specularColorMap = loadTexture("static/texture/lighting_maps_specular_color.png");
+  TextureHandle diffuseMap = loadTexture("static/texture/container2.png");
+  TextureHandle specularMap = loadTexture("static/texture/container2_specular.png");
+  TextureHandle specularColorMap = loadTexture("static/texture/lighting_maps_specular_color.png");
   ourShader.use();
   ourShader.setInt("material.diffuse", 0);
   ourShader.setInt("material.specular", 1);
@@ -207,13 +208,13 @@ int main()
 
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
+    glBindTexture(GL_TEXTURE_2D, diffuseMap->id);
 
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specularMap);
+    glBindTexture(GL_TEXTURE_2D, specularMap->id);
 
     glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, specularColorMap);
+    glBindTexture(GL_TEXTURE_2D, specularColorMap->id);
     
     glm::mat4 view = glm::mat4(1.0f);
 
@@ -277,6 +278,7 @@ int main()
   planeGeometry.dispose();
   boxGeometry.dispose();
   sphereGeometry.dispose();
+  TextureCache::global().shutdown();
   glfwTerminate();
   return 0;
 }
@@ -358,39 +360,11 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
   return;
 }
 
-unsigned int loadTexture(char const *path)
+TextureHandle loadTexture(char const *path)
 {
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-
-  int width, height, nrComponents;
-  unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-  if (data)
-  {
-    GLenum format;
-    if (nrComponents == 1)
-      format = GL_RED;
-    else if (nrComponents == 3)
-      format = GL_RGB;
-    else if (nrComponents == 4)
-      format = GL_RGBA;
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-  }
-  else
-  {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
-  }
-
-  return textureID;
+  // 图像y轴翻转
+  TextureOptions options;
+  options.flipVertically = true;
+  options.compressed = true;
+  return TextureCache::global().load(path, options);
 }
\ No newline at end of file
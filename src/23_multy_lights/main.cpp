@@ -13,6 +13,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define N  99
 #include <tool/stb_image.h>
+#include <tool/texture_cache.h>
 
 #include <tool/gui.h>
 
@@ -29,7 +30,7 @@ void processInput(GLFWwindow *window);
 
 float randomFloat();
 
-unsigned int loadTexture(char const * path);
+TextureHandle loadTexture(char const *path);
 
 std::string Shader::dirName;
 
@@ -126,9 +127,9 @@ int main()
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-  unsigned int diffuseMap = loadTexture("static/texture/container2.png");
-  unsigned int specularMap = loadTexture("static/texture/container2_specular.png");
-  unsigned int awesomeMap = loadTexture("./static/texture/awesomeface.png");
+  TextureHandle diffuseMap = loadTexture("static/texture/container2.png");
+  TextureHandle specularMap = loadTexture("static/texture/container2_specular.png");
+  TextureHandle awesomeMap = loadTexture("./static/texture/awesomeface.png");
   ourShader.use();
   ourShader.setInt("material.diffuse", 0);
   ourShader.setInt("material.specular", 1);
@@ -242,13 +243,13 @@ int main()
 
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
+    glBindTexture(GL_TEXTURE_2D, diffuseMap->id);
 
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specularMap);
+    glBindTexture(GL_TEXTURE_2D, specularMap->id);
 
     glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, awesomeMap);
+    glBindTexture(GL_TEXTURE_2D, awesomeMap->id);
     
     glm::mat4 view = glm::mat4(1.0f);
 
@@ -268,7 +269,7 @@ int main()
     ourShader.setMat4("projection",projection);
     ourShader.setVec3("spotLight.position",camera.Position);
     ourShader.setVec3("spotLight.direction",camera.Front);
-    ourShader.setVec3("directionLight.direction", lightPos);
+    ourShader.setVec3("directionalLight.direction", lightPos);
     ourShader.setVec3("viewPos",camera.Position);
 
     for (unsigned int i = 0; i < 4; i++)
@@ -331,6 +332,7 @@ int main()
   planeGeometry.dispose();
   boxGeometry.dispose();
   sphereGeometry.dispose();
+  TextureCache::global().shutdown();
   glfwTerminate();
   return 0;
 }
@@ -412,41 +414,13 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
   return;
 }
 
-unsigned int loadTexture(char const *path)
+TextureHandle loadTexture(char const *path)
 {
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-
-  int width, height, nrComponents;
-  unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-  if (data)
-  {
-    GLenum format;
-    if (nrComponents == 1)
-      format = GL_RED;
-    else if (nrComponents == 3)
-      format = GL_RGB;
-    else if (nrComponents == 4)
-      format = GL_RGBA;
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-  }
-  else
-  {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
-  }
-
-  return textureID;
+  // 图像y轴翻转
+  TextureOptions options;
+  options.flipVertically = true;
+  options.compressed = true;
+  return TextureCache::global().load(path, options);
 }
 
 float randomFloat()
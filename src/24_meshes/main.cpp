@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
 
 #include <geometry/BoxGeometry.h>
 #include <geometry/PlaneGeometry.h>
@@ -15,11 +16,13 @@
 #include <tool/gui.h>
 
 #include <tool/model.h>
+#include <tool/frustum_culler.h>
+#include <tool/uniform_buffer.h>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void processInput(GLFWwindow *window);
-unsigned int loadTexture(char const *path);
+TextureHandle loadTexture(char const *path);
 
 std::string Shader::dirName;
 
@@ -100,23 +103,33 @@ int main(int argc, char *argv[])
   // 2.鼠标事件
   glfwSetCursorPosCallback(window, mouse_callback);
 
-  Shader ourShader("./src/24_meshes/shader/vertex.glsl", "./src/24_meshes/shader/fragment.glsl");
-  Shader lightObjectShader("./src/24_meshes/shader/light_vertex.glsl", "./src/24_meshes/shader/light_fragment.glsl");
+  // 备用程序：批量编译的程序链接完成前用它绘制（纯色）
+  Shader fallbackShader("./src/24_meshes/shader/fallback_vertex.glsl", "./src/24_meshes/shader/fallback_fragment.glsl");
+  Shader::setFallback(fallbackShader);
+  // 着色器先全部提交，之后再检查编译状态；驱动支持 GL_KHR_parallel_shader_compile 时在后台线程并行编译
+  ShaderBatch shaderBatch;
+  // 模型贴图打包为纹理数组，片段着色器按层采样
+  // 光源结构体与光照函数放在 shader/include/lights.glsl 中，点光源数量与聚光开关作为宏编译进程序（循环展开、无运行时分支）
+  ShaderDefines lightingDefines;
+  lightingDefines.set("POINT_LIGHTS", 4).set("SPOT_LIGHT", 1);
+  Shader ourShader(shaderBatch, "./src/24_meshes/shader/vertex.glsl", "./src/24_meshes/shader/array_fragment.glsl", lightingDefines);
+  Shader lightObjectShader(shaderBatch, "./src/24_meshes/shader/light_instance_vertex.glsl", "./src/24_meshes/shader/light_instance_fragment.glsl");
+  Shader rockShader(shaderBatch, "./src/24_meshes/shader/instance_vertex.glsl", "./src/24_meshes/shader/rock_fragment.glsl");
 
   PlaneGeometry planeGeometry(1.0, 1.0, 1.0, 1.0);
   BoxGeometry boxGeometry(1.0, 1.0, 1.0);
   SphereGeometry sphereGeometry(0.1, 10.0, 10.0);
 
-  unsigned int diffuseMap = loadTexture("./static/texture/container2.png");
-  unsigned int specularMap = loadTexture("./static/texture/container2_specular.png");
-  unsigned int awesomeMap = loadTexture("./static/texture/awesomeface.png");
-  ourShader.use();
-  ourShader.setInt("material.diffuse", 0);
-  ourShader.setInt("material.specular", 1);
+  TextureHandle diffuseMap = loadTexture("./static/texture/container2.png");
+  TextureHandle specularMap = loadTexture("./static/texture/container2_specular.png");
+  TextureHandle awesomeMap = loadTexture("./static/texture/awesomeface.png");
 
-  ourShader.setInt("awesomeMap", 2);
-
-  float factor = 0.0;
+  // 编译与上面的几何体、贴图加载重叠
+  // 预热（warmupShaders = true）：在加载阶段等待全部程序链接完成，避免首次使用时卡顿；
+  // 否则不等待，每帧 poll，程序链接完成前用备用程序绘制，就绪后再设置 uniform（见 configureOurShader）
+  const bool warmupShaders = false;
+  if (warmupShaders)
+    shaderBatch.wait();
 
   // 旋转矩阵
   glm::mat4 ex = glm::eulerAngleX(45.0f);
@@ -131,31 +144,13 @@ int main(int argc, char *argv[])
 
   glm::vec3 lightPosition = glm::vec3(1.0, 2.5, 2.0); // 光照位置
 
-  // 传递材质属性
-  ourShader.setVec3("material.ambient", 1.0f, 0.5f, 0.31f);
-  ourShader.setFloat("material.shininess", 32.0f);
-
-  // 设置平行光光照属性
-  ourShader.setVec3("directionLight.ambient", 0.01f, 0.01f, 0.01f);
-  ourShader.setVec3("directionLight.diffuse", 0.2f, 0.2f, 0.2f); // 将光照调暗了一些以搭配场景
-  ourShader.setVec3("directionLight.specular", 1.0f, 1.0f, 1.0f);
-
-  // 设置聚光光照属性
-  ourShader.setVec3("spotLight.position", glm::vec3(0.0f, 0.0f, 2.0f));
-  ourShader.setVec3("spotLight.direction", camera.Front);
-  ourShader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-  ourShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-  ourShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-  ourShader.setFloat("spotLight.constant", 1.0f);
-  ourShader.setFloat("spotLight.linear", 0.09);
-  ourShader.setFloat("spotLight.quadratic", 0.032);
-  ourShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-  ourShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
-  // 设置衰减
-  ourShader.setFloat("light.constant", 1.0f);
-  ourShader.setFloat("light.linear", 0.09f);
-  ourShader.setFloat("light.quadratic", 0.032f);
+  // 相机数据放在所有着色器共享的 uniform 块中（绑定点 0），每帧只上传一次
+  FrameUniformBuffer frameUniforms;
+  // 材质属性放在 uniform 块中，每次绘制从环形缓冲中分配一块并用 glBindBufferRange 绑定（绑定点 1）
+  MaterialUniformRing materialRing;
+  MaterialUniforms sceneMaterial;
+  sceneMaterial.ambient = glm::vec4(1.0f, 0.5f, 0.31f, 1.0f);
+  sceneMaterial.shininess = 32.0f;
 
   // 定义是个不同的箱子位置
   glm::vec3 cubePositions[] = {
@@ -184,11 +179,130 @@ int main(int argc, char *argv[])
       glm::vec3(0.0f, 1.0f, 0.0f)};
 
   // Model ourModel("./static/model/nanosuit/nanosuit.obj");
-  Model ourModel("./static/model/nanosuit/nanosuit.obj");
+  // 异步加载模型：导入与解码在线程池中进行，每帧按预算上传，加载完成前先绘制已上传的网格
+  ModelStreamer modelStreamer;
+  // 纹理在 CPU 上压缩为 BC7 / BC5 并缓存为 KTX，之后的运行直接加载压缩数据
+  // 同尺寸贴图合并为纹理数组的层，小贴图（玻璃）放入图集，绘制各网格时无需重新绑定纹理
+  shared_ptr<Model> ourModel = modelStreamer.load("./static/model/nanosuit/nanosuit.obj", false, false, true, true);
+  shared_ptr<Model> planet = modelStreamer.load("./static/model/planet/planet.obj", false, false, true);
+  shared_ptr<Model> rock = modelStreamer.load("./static/model/rock/rock.obj", false, false, true);
+
+  // 每帧更新的 uniform 在循环外解析为句柄，循环内不再拼接名字、查询位置；值未变化的 uniform 不会重复上传
+  // 句柄在程序就绪后才能解析，之前是无效句柄，设置时直接跳过
+  UniformHandle<glm::mat4> modelUniform;
+  UniformHandle<glm::ivec4> textureLayersUniform;
+  UniformHandle<glm::vec3> lightDirectionUniform;
+  struct PointLightUniforms
+  {
+    UniformHandle<glm::vec3> position, ambient, diffuse, specular;
+    UniformHandle<float> constant, linear, quadratic;
+  } pointLightUniforms[4];
+
+  // 程序就绪后执行一次：设置采样器单元与不变的光照属性，解析句柄（需在 ourShader.use() 之后调用）
+  auto configureOurShader = [&]()
+  {
+    ourShader.setInt("awesomeMap", 2);
+    // 骨骼矩阵的 samplerBuffer 不能与 sampler2D 共用纹理单元 0，即使没有蒙皮网格也要指定
+    ourShader.setInt("bonePalette", PALETTE_TEXTURE_UNIT);
+
+    // 设置平行光光照属性
+    ourShader.setVec3("directionalLight.ambient", 0.01f, 0.01f, 0.01f);
+    ourShader.setVec3("directionalLight.diffuse", 0.2f, 0.2f, 0.2f); // 将光照调暗了一些以搭配场景
+    ourShader.setVec3("directionalLight.specular", 1.0f, 1.0f, 1.0f);
+
+    // 设置聚光光照属性
+    ourShader.setVec3("spotLight.position", glm::vec3(0.0f, 0.0f, 2.0f));
+    ourShader.setVec3("spotLight.direction", camera.Front);
+    ourShader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+    ourShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
+    ourShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
+    ourShader.setFloat("spotLight.constant", 1.0f);
+    ourShader.setFloat("spotLight.linear", 0.09);
+    ourShader.setFloat("spotLight.quadratic", 0.032);
+    ourShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
+    ourShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+
+    modelUniform = ourShader.uniform<glm::mat4>("model");
+    textureLayersUniform = ourShader.uniform<glm::ivec4>("textureLayers");
+    lightDirectionUniform = ourShader.uniform<glm::vec3>("directionalLight.direction");
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      std::string prefix = "pointLights[" + std::to_string(i) + "].";
+      pointLightUniforms[i].position = ourShader.uniform<glm::vec3>(prefix + "position");
+      pointLightUniforms[i].ambient = ourShader.uniform<glm::vec3>(prefix + "ambient");
+      pointLightUniforms[i].diffuse = ourShader.uniform<glm::vec3>(prefix + "diffuse");
+      pointLightUniforms[i].specular = ourShader.uniform<glm::vec3>(prefix + "specular");
+      pointLightUniforms[i].constant = ourShader.uniform<float>(prefix + "constant");
+      pointLightUniforms[i].linear = ourShader.uniform<float>(prefix + "linear");
+      pointLightUniforms[i].quadratic = ourShader.uniform<float>(prefix + "quadratic");
+    }
+  };
+  bool ourShaderConfigured = false;
+  bool shaderStatisticsPrinted = false;
+
+  // 灯光物体的实例缓冲：1 个平行光 + 4 个点光源
+  InstanceBuffer lightInstances(5);
+  vector<InstanceData> lightInstanceData;
+
+  // 小行星带：行星周围的环上随机放置 ROCK_COUNT 个岩石实例
+  // 岩石是静态的，实例缓冲只在这里上传一次，之后每帧每个网格一次实例化绘制
+  const unsigned int ROCK_COUNT = 100000;
+  const glm::vec3 planetPosition = glm::vec3(0.0f, -5.0f, -50.0f);
+  const float ringRadius = 25.0f;
+  const float ringOffset = 4.0f;
+  vector<InstanceData> rockInstanceData;
+  rockInstanceData.reserve(ROCK_COUNT);
+  srand(1);
+  for (unsigned int i = 0; i < ROCK_COUNT; i++)
+  {
+    // 沿环均匀分布，再在 [-ringOffset, ringOffset] 内随机偏移
+    float angle = glm::radians((float)i / (float)ROCK_COUNT * 360.0f);
+    float displacement = (rand() % (int)(2 * ringOffset * 100)) / 100.0f - ringOffset;
+    float x = sin(angle) * ringRadius + displacement;
+    displacement = (rand() % (int)(2 * ringOffset * 100)) / 100.0f - ringOffset;
+    float y = displacement * 0.4f; // 环的厚度小于宽度
+    displacement = (rand() % (int)(2 * ringOffset * 100)) / 100.0f - ringOffset;
+    float z = cos(angle) * ringRadius + displacement;
+
+    glm::mat4 rockMatrix = glm::translate(glm::mat4(1.0f), planetPosition + glm::vec3(x, y, z));
+    rockMatrix = glm::scale(rockMatrix, glm::vec3((rand() % 20) / 100.0f + 0.05f));
+    rockMatrix = glm::rotate(rockMatrix, glm::radians((float)(rand() % 360)), glm::vec3(0.4f, 0.6f, 0.8f));
+    rockInstanceData.push_back(makeInstance(rockMatrix));
+  }
+  InstanceBuffer rockInstances(ROCK_COUNT);
+  rockInstances.update(rockInstanceData);
+
+  InstanceBuffer planetInstances(1);
+  planetInstances.update({makeInstance(glm::scale(glm::translate(glm::mat4(1.0f), planetPosition), glm::vec3(2.0f)))});
+
+  // 静态合批：十个箱子按各自的模型矩阵烘焙进同一个 arena（世界空间），每帧一次多重绘制
+  // 逐个绘制时每个箱子需要设置 model、绑定 VAO、glDrawElements，共 3 次 GL 调用
+  const unsigned int CUBE_COUNT = 10;
+  GeometryArena boxArena;
+  for (unsigned int i = 0; i < CUBE_COUNT; i++)
+  {
+    glm::mat4 cubeMatrix = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+    cubeMatrix = glm::rotate(cubeMatrix, glm::radians(10.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
+    boxGeometry.addTo(boxArena, cubeMatrix);
+  }
+  bool arenaStatisticsPrinted = false;
+
+  // 视锥剔除：0 号为模型，1 - 5 号为灯光物体
+  FrustumCuller culler;
+  vector<unsigned int> visible;
 
   while (!glfwWindowShouldClose(window))
   {
     processInput(window);
+    // 每帧最多上传 8 MB 或 2 ms
+    modelStreamer.update(UploadBudget(8 * 1024 * 1024, 2.0));
+    // 取回已链接完成的着色器程序，不等待
+    if (shaderBatch.poll() == 0 && !shaderStatisticsPrinted)
+    {
+      // 程序二进制缓存（*.program）命中时跳过编译，打印着色器耗时
+      Shader::printStatistics();
+      shaderStatisticsPrinted = true;
+    }
 
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastTime;
@@ -219,9 +333,11 @@ int main(int argc, char *argv[])
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     ourShader.use();
-
-    factor = glfwGetTime();
-    ourShader.setFloat("factor", -factor * 0.3);
+    if (!ourShaderConfigured && ourShader.ready())
+    {
+      configureOurShader();
+      ourShaderConfigured = true;
+    }
 
     // 修改光源颜色
     glm::vec3 lightColor;
@@ -230,13 +346,13 @@ int main(int argc, char *argv[])
     lightColor.z = sin(glfwGetTime() * 1.3f);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
+    glBindTexture(GL_TEXTURE_2D, diffuseMap->id);
 
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specularMap);
+    glBindTexture(GL_TEXTURE_2D, specularMap->id);
 
     glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, awesomeMap);
+    glBindTexture(GL_TEXTURE_2D, awesomeMap->id);
 
     float radius = 10.0f;
     float camX = sin(glfwGetTime()) * radius;
@@ -248,74 +364,84 @@ int main(int argc, char *argv[])
 
     glm::vec3 lightPos = glm::vec3(lightPosition.x * glm::sin(glfwGetTime()) * 2.0, lightPosition.y, lightPosition.z);
 
-    ourShader.setMat4("view", view);
-    ourShader.setMat4("projection", projection);
+    frameUniforms.update(makeFrameUniforms(view, projection, camera.Position, currentFrame));
+    materialRing.beginFrame();
+    materialRing.bind(sceneMaterial);
 
-    ourShader.setVec3("directionLight.direction", lightPos); // 光源位置
-    ourShader.setVec3("viewPos", camera.Position);
+    ourShader.set(lightDirectionUniform, lightPos); // 光源位置
 
     for (unsigned int i = 0; i < 4; i++)
     {
       // 设置点光源属性
-      ourShader.setVec3("pointLights[" + std::to_string(i) + "].position", pointLightPositions[i]);
-      ourShader.setVec3("pointLights[" + std::to_string(i) + "].ambient", 0.01f, 0.01f, 0.01f);
-      ourShader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", pointLightColors[i]);
-      ourShader.setVec3("pointLights[" + std::to_string(i) + "].specular", 1.0f, 1.0f, 1.0f);
+      ourShader.set(pointLightUniforms[i].position, pointLightPositions[i]);
+      ourShader.set(pointLightUniforms[i].ambient, glm::vec3(0.01f, 0.01f, 0.01f));
+      ourShader.set(pointLightUniforms[i].diffuse, pointLightColors[i]);
+      ourShader.set(pointLightUniforms[i].specular, glm::vec3(1.0f, 1.0f, 1.0f));
 
       // // 设置衰减
-      ourShader.setFloat("pointLights[" + std::to_string(i) + "].constant", 1.0f);
-      ourShader.setFloat("pointLights[" + std::to_string(i) + "].linear", 0.09f);
-      ourShader.setFloat("pointLights[" + std::to_string(i) + "].quadratic", 0.032f);
+      ourShader.set(pointLightUniforms[i].constant, 1.0f);
+      ourShader.set(pointLightUniforms[i].linear, 0.09f);
+      ourShader.set(pointLightUniforms[i].quadratic, 0.032f);
     }
 
-    glm::mat4 model = glm::mat4(1.0f);
-    for (unsigned int i = 0; i < 10; i++)
+    // 箱子已在世界空间，model 为单位矩阵；没有模型贴图（层 -1），漫反射取灰色
+    // 程序就绪前不绘制：备用程序的 model 句柄尚未解析
+    if (ourShaderConfigured)
     {
-      model = glm::mat4(1.0f);
-      model = glm::translate(model, cubePositions[i]);
-
-      float angle = 10.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-
-      ourShader.setMat4("model", model);
-
-      // glBindVertexArray(boxGeometry.VAO);
-      // glDrawElements(GL_TRIANGLES, boxGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+      ourShader.set(modelUniform, glm::mat4(1.0f));
+      ourShader.set(textureLayersUniform, glm::ivec4(-1));
+      boxArena.drawAll();
+      if (!arenaStatisticsPrinted)
+      {
+        cout << "GEOMETRY_ARENA:: " << CUBE_COUNT << " boxes: " << boxArena.lastDrawCommands << " commands in 1 draw call, "
+             << boxArena.lastGLCalls << " GL calls; per object: " << CUBE_COUNT << " draw calls, " << CUBE_COUNT * 3 << " GL calls" << endl;
+        arenaStatisticsPrinted = true;
+      }
     }
 
-    model = glm::mat4(1.0f);
+    glm::mat4 model = glm::mat4(1.0f);
     model = glm::rotate(model, glm::radians(15.0f * (float)glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::translate(model, glm::vec3(0.0f, -1.0f, 0.0f));
     model = glm::scale(model, glm::vec3(0.13f, 0.13f, 0.13f));
-    ourShader.setMat4("model", model);
-
-    ourModel.Draw(ourShader);
-
-    // 绘制灯光物体
-    lightObjectShader.use();
-    lightObjectShader.setMat4("view", view);
-    lightObjectShader.setMat4("projection", projection);
+    glm::mat4 ourModelMatrix = model;
 
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, lightPos);
+    // 灯光物体的模型矩阵
+    glm::mat4 lightMatrices[5];
+    lightMatrices[0] = glm::translate(glm::mat4(1.0f), lightPos);
+    for (unsigned int i = 0; i < 4; i++)
+      lightMatrices[i + 1] = glm::translate(glm::mat4(1.0f), pointLightPositions[i]);
 
-    lightObjectShader.setMat4("model", model);
-    lightObjectShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
+    culler.clear();
+    culler.add(ourModel->boundingBox, ourModel->boundingSphere, ourModelMatrix);
+    for (unsigned int i = 0; i < 5; i++)
+      culler.add(sphereGeometry.boundingBox, sphereGeometry.boundingSphere, lightMatrices[i]);
+    culler.cull(camera.GetFrustum(projection), visible);
 
-    glBindVertexArray(sphereGeometry.VAO);
-    glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
+    lightInstanceData.clear();
+    for (unsigned int i = 0; i < visible.size(); i++)
+    {
+      if (visible[i] == 0)
+        ourModel->Draw(ourShader, camera, ourModelMatrix, SCREEN_HEIGHT);
+      else if (visible[i] == 1)
+        lightInstanceData.push_back(makeInstance(lightMatrices[0], glm::vec4(1.0f)));
+      else
+        lightInstanceData.push_back(makeInstance(lightMatrices[visible[i] - 1], glm::vec4(pointLightColors[visible[i] - 2], 1.0f)));
+    }
 
-    for (unsigned int i = 0; i < 4; i++)
+    // 行星与小行星带，每个网格一次实例化绘制；备用程序不读取 nodeMatrix，程序链接完成前不绘制
+    if (rockShader.ready())
     {
-      model = glm::mat4(1.0f);
-      model = glm::translate(model, pointLightPositions[i]);
+      rockShader.use();
+      planet->DrawInstanced(rockShader, planetInstances);
+      rock->DrawInstanced(rockShader, rockInstances);
+    }
 
-      lightObjectShader.setMat4("model", model);
-      lightObjectShader.setVec3("lightColor", pointLightColors[i]);
+    // 绘制可见的灯光物体（一次实例化绘制）
+    lightObjectShader.use();
 
-      glBindVertexArray(sphereGeometry.VAO);
-      glDrawElements(GL_TRIANGLES, sphereGeometry.indices.size(), GL_UNSIGNED_INT, 0);
-    }
+    lightInstances.update(lightInstanceData);
+    sphereGeometry.drawInstanced(lightInstances);
+    materialRing.endFrame();
 
     // 渲染 gui
     ImGui::Render();
@@ -326,8 +452,18 @@ int main(int argc, char *argv[])
   }
 
   boxGeometry.dispose();
+  boxArena.dispose();
   planeGeometry.dispose();
   sphereGeometry.dispose();
+  lightInstances.dispose();
+  rockInstances.dispose();
+  planetInstances.dispose();
+  frameUniforms.dispose();
+  materialRing.dispose();
+  // 关闭窗口时模型可能仍在加载：跳过排队中的导入与解码，等待正在执行的任务结束后再关闭纹理缓存
+  modelStreamer.cancel();
+  TextureCache::global().printStatistics();
+  TextureCache::global().shutdown();
   glfwTerminate();
 
   return 0;
@@ -380,42 +516,12 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos)
   camera.ProcessMouseMovement(xoffset, yoffset);
 }
 
-// 加载纹理贴图
-unsigned int loadTexture(char const *path)
+// 加载纹理贴图，经由全局纹理缓存，同一路径只解码上传一次
+TextureHandle loadTexture(char const *path)
 {
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-
   // 图像y轴翻转
-  stbi_set_flip_vertically_on_load(true);
-  int width, height, nrComponents;
-  unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-  if (data)
-  {
-    GLenum format;
-    if (nrComponents == 1)
-      format = GL_RED;
-    else if (nrComponents == 3)
-      format = GL_RGB;
-    else if (nrComponents == 4)
-      format = GL_RGBA;
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-  }
-  else
-  {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
-  }
-
-  return textureID;
-}
\ No newline at end of file
+  TextureOptions options;
+  options.flipVertically = true;
+  options.compressed = true;
+  return TextureCache::global().load(path, options);
+}
@@ -0,0 +1,76 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 outTexCoord;
+in vec3 outNormal;
+in vec3 outFragPos;
+
+uniform vec3 lightPos;
+#include "include/frame_block.glsl"
+
+// material constants, suballocated per draw from a ring buffer (MaterialUniformRing in include/tool/uniform_buffer.h)
+layout(std140) uniform MaterialBlock
+{
+  vec4 ambient;
+  float shininess;
+} material;
+
+// model textures packed into arrays, one layer per slot and draw (include/tool/texture_array.h)
+// units 2 and 3 (normal, height) stay unused here, awesomeMap lives on unit 2
+uniform sampler2DArray diffuseArray;
+uniform sampler2DArray specularArray;
+uniform ivec4 textureLayers;
+
+uniform sampler2D awesomeMap;
+
+vec3 DiffuseColor();
+vec3 SpecularColor();
+
+#include "include/lights.glsl"
+
+void main() {
+    vec3 viewDir = normalize(cameraPosition.xyz - outFragPos);
+    vec3 normal = normalize(outNormal);
+
+    //directional light
+    vec3 outPut = Calc_DirectionalLight(directionalLight, normal, viewDir);
+
+    //point light
+#if POINT_LIGHTS > 0
+    for(int i = 0; i < POINT_LIGHTS; i++)
+    {
+      outPut += Calc_PointLight(pointLights[i], normal, outFragPos, viewDir);
+    }
+#endif
+
+    //spot light
+#if SPOT_LIGHT
+    outPut += Calc_SpotLight(spotLight, normal, outFragPos, viewDir)* texture(awesomeMap, outTexCoord).rgb;
+#endif
+
+    FragColor = vec4(outPut, 1.0);
+
+}
+
+// DIFFUSE_TEXTURE / SPECULAR_TEXTURE: 1 when every mesh drawn with the program has the texture, 0 when none has it;
+// left undefined the slot is tested per draw (layer -1: the mesh has no texture in that slot)
+vec3 DiffuseColor()
+{
+#if !defined(DIFFUSE_TEXTURE)
+  return textureLayers.x < 0 ? vec3(0.5) : texture(diffuseArray, vec3(outTexCoord, textureLayers.x)).rgb;
+#elif DIFFUSE_TEXTURE
+  return texture(diffuseArray, vec3(outTexCoord, textureLayers.x)).rgb;
+#else
+  return vec3(0.5);
+#endif
+}
+
+vec3 SpecularColor()
+{
+#if !defined(SPECULAR_TEXTURE)
+  return textureLayers.y < 0 ? vec3(0.0) : texture(specularArray, vec3(outTexCoord, textureLayers.y)).rgb;
+#elif SPECULAR_TEXTURE
+  return texture(specularArray, vec3(outTexCoord, textureLayers.y)).rgb;
+#else
+  return vec3(0.0);
+#endif
+}
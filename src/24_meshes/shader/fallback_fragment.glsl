@@ -0,0 +1,6 @@
+#version 330 core
+out vec4 FragColor;
+
+void main() {
+  FragColor = vec4(0.5, 0.5, 0.5, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout(location = 0) in vec3 Position;
+// node matrices of a mesh shared by several nodes, see Model::drawMesh
+layout(location = 5) in mat4 instanceModel;
+
+#include "include/frame_block.glsl"
+
+// drawn with while the real program is still linking (Shader::setFallback), so it only needs the placement
+uniform mat4 model;
+uniform bool instanced;
+
+void main() {
+
+  mat4 world = instanced ? model * instanceModel : model;
+  gl_Position = viewProjection*world*vec4(Position, 1.0f);
+}
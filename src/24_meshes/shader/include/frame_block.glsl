@@ -0,0 +1,8 @@
+// per-frame camera data shared by all programs, see include/tool/uniform_buffer.h
+layout(std140) uniform FrameBlock
+{
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec4 cameraPosition; // w: time in seconds
+};
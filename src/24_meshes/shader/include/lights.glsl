@@ -0,0 +1,125 @@
+// Lights of the chapter 24 fragment shaders. The including shader declares `material` (with a shininess member)
+// and defines DiffuseColor() / SpecularColor() before including this file.
+// Switches, set through ShaderDefines; each value compiles into its own program, the light loop is unrolled
+// by the compiler and disabled lights cost nothing:
+//   POINT_LIGHTS  number of point lights (pointLights[]), 0 for none
+//   SPOT_LIGHT    1 to light with spotLight, 0 to leave it out
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS 4
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+
+//define directional light struct
+struct DirectionalLight {
+  vec3 direction;
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+//define point light struct
+struct PointLight {
+  vec3 position;
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+  float constant;
+  float linear;
+  float quadratic;
+};
+
+//define spot light struct
+struct SpotLight {
+  vec3 position;
+  vec3 direction;
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+  float constant;
+  float linear;
+  float quadratic;
+  float cutOff;
+  float outerCutOff;
+};
+
+#if POINT_LIGHTS > 0
+uniform PointLight pointLights[POINT_LIGHTS];
+#endif
+
+uniform DirectionalLight directionalLight;
+
+uniform PointLight pointLight;
+
+uniform SpotLight spotLight;
+
+// calculate the attributes of the directional light
+vec3 Calc_DirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
+{
+  //----------Vector and scalar calculations----------
+  vec3 lightDir = normalize(-light.direction);
+  float diff = max(dot(normal, lightDir), 0.0);
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+  //----------Calculate the directional light attribution----------
+  vec3 ambient = light.ambient * DiffuseColor();
+  vec3 diffuse = light.diffuse * diff * DiffuseColor();
+  vec3 specular = light.specular * spec * SpecularColor();
+
+  return (ambient + diffuse + specular);
+}
+
+// calculate the attributes of the point light
+vec3 Calc_PointLight(PointLight light,vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+  //----------Vector and scalar calculations----------
+  vec3 lightDir = normalize(light.position - fragPos);
+  float diff = max(dot(normal, lightDir), 0.0);
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+  float distance = length(light.position - fragPos);
+  float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+  //----------Calculate the point light attribution----------
+  vec3 ambient = light.ambient * DiffuseColor();
+  vec3 diffuse = light.diffuse * diff * DiffuseColor();
+  vec3 specular = light.specular * spec * SpecularColor();
+
+  ambient *= attenuation;
+  diffuse *= attenuation;
+  specular *= attenuation;
+
+  return (ambient + diffuse + specular);
+
+}
+
+// calculate the attributes of the spot light
+vec3 Calc_SpotLight(SpotLight light,vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+  //----------Vector and scalar calculations----------
+  vec3 lightDir = normalize(light.position - fragPos);
+  float diff = max(dot(normal, lightDir), 0.0);
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+  float distance = length(light.position - fragPos);
+  float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+  float theta = dot(lightDir, normalize(-light.direction));
+  float epsilon = (light.cutOff - light.outerCutOff);
+  float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+  //----------Calculate the spot light attribution----------
+  vec3 ambient = light.ambient * DiffuseColor();
+  vec3 diffuse = light.diffuse * diff * DiffuseColor();
+  vec3 specular = light.specular * spec * SpecularColor();
+
+  ambient *= attenuation * intensity;
+  diffuse *= attenuation * intensity;
+  specular *= attenuation * intensity;
+
+  return (ambient + diffuse + specular);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+layout(location = 0) in vec3 Position;
+layout(location = 1) in vec3 Normal;
+layout(location = 2) in vec2 TexCoords;
+
+// per-instance attributes, see include/tool/instance_buffer.h
+layout(location = 5) in mat4 instanceModel;
+layout(location = 9) in mat3 instanceNormalMatrix;
+
+out vec2 outTexCoord;
+out vec3 outNormal;
+out vec3 outFragPos;
+
+#include "include/frame_block.glsl"
+// node transform of the mesh inside its model, set by Model::DrawInstanced
+uniform mat4 nodeMatrix;
+uniform mat3 nodeNormalMatrix;
+
+void main() {
+
+  vec4 worldPosition = instanceModel * nodeMatrix * vec4(Position, 1.0f);
+  gl_Position = viewProjection*worldPosition;
+
+  outFragPos = vec3(worldPosition);
+
+  outTexCoord = TexCoords;
+
+  // the normal matrix is computed once per instance on the CPU
+  outNormal = instanceNormalMatrix * nodeNormalMatrix * Normal;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout(location = 0) in vec3 Position;
+layout(location = 1) in vec3 Normal;
+layout(location = 2) in vec2 TexCoords;
+
+// per-instance attributes, see include/tool/instance_buffer.h
+layout(location = 5) in mat4 instanceModel;
+layout(location = 12) in vec4 instanceColor;
+
+out vec2 outTexCoord;
+out vec3 outColor;
+
+#include "include/frame_block.glsl"
+
+void main() {
+
+  gl_Position = viewProjection*instanceModel*vec4(Position, 1.0f);
+  outTexCoord = TexCoords;
+  outColor = instanceColor.rgb;
+}
@@ -6,11 +6,10 @@ layout(location = 2) in vec2 TexCoords;
 out vec2 outTexCoord;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/frame_block.glsl"
 
 void main() {
 
-  gl_Position = projection*view*model*vec4(Position, 1.0f);
+  gl_Position = viewProjection*model*vec4(Position, 1.0f);
   outTexCoord = TexCoords;
 }
\ No newline at end of file
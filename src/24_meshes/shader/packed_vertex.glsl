@@ -0,0 +1,101 @@
+#version 330 core
+// vertex shader for the compact layout in include/geometry/PackedVertex.h
+layout(location = 0) in vec4 Position;  // snorm16 inside the mesh bounds, or half
+layout(location = 1) in vec2 Normal;    // octahedral encoded
+layout(location = 2) in vec2 TexCoords; // half
+layout(location = 3) in vec4 QTangent;  // only bound when the mesh has tangents
+// node matrices of a mesh shared by several nodes, see Model::drawMesh
+layout(location = 5) in mat4 instanceModel;
+layout(location = 9) in mat3 instanceNormalMatrix;
+// bone influences of skinned meshes, see include/tool/animation.h
+layout(location = 13) in uvec4 boneIndices;
+layout(location = 14) in vec4 boneWeights;
+
+out vec2 outTexCoord;
+out vec3 outNormal;
+out vec3 outFragPos;
+out vec3 outTangent;
+out vec3 outBitangent;
+
+uniform mat4 model;
+#include "include/frame_block.glsl"
+uniform bool instanced;
+
+// bone palettes of Model::DrawSkinned: three texels (the rows of a 3x4 matrix) per bone, boneCount bones per instance
+uniform bool skinned;
+uniform samplerBuffer bonePalette;
+uniform int boneCount;
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+//----------skinning----------
+mat4 boneMatrix(uint bone)
+{
+  int base = (gl_InstanceID * boneCount + int(bone)) * 3;
+  return transpose(mat4(texelFetch(bonePalette, base), texelFetch(bonePalette, base + 1), texelFetch(bonePalette, base + 2), vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+mat4 skinMatrix()
+{
+  return boneMatrix(boneIndices.x) * boneWeights.x + boneMatrix(boneIndices.y) * boneWeights.y +
+         boneMatrix(boneIndices.z) * boneWeights.z + boneMatrix(boneIndices.w) * boneWeights.w;
+}
+
+//----------decode helpers----------
+vec3 decodePosition(vec4 p)
+{
+  return positionOffset + positionScale * p.xyz;
+}
+
+vec3 decodeOctahedral(vec2 e)
+{
+  vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(n);
+}
+
+vec3 quatRotate(vec4 q, vec3 v)
+{
+  return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// tangent = q * X, bitangent = sign(q.w) * cross(normal, tangent)
+void decodeQTangent(vec4 q, vec3 normal, out vec3 tangent, out vec3 bitangent)
+{
+  q = normalize(q);
+  tangent = quatRotate(q, vec3(1.0, 0.0, 0.0));
+  bitangent = (q.w < 0.0 ? -1.0 : 1.0) * cross(normal, tangent);
+}
+
+void main() {
+  vec3 position = decodePosition(Position);
+  vec3 normal = decodeOctahedral(Normal);
+  vec3 tangent;
+  vec3 bitangent;
+  decodeQTangent(QTangent, normal, tangent, bitangent);
+  if (skinned)
+  {
+    mat4 skin = skinMatrix();
+    position = vec3(skin * vec4(position, 1.0));
+    normal = mat3(skin) * normal;
+    tangent = mat3(skin) * tangent;
+    bitangent = mat3(skin) * bitangent;
+  }
+
+  mat4 world = instanced ? model * instanceModel : model;
+  gl_Position = viewProjection*world*vec4(position, 1.0f);
+
+  outFragPos = vec3(world * vec4(position, 1.0f));
+
+  outTexCoord = TexCoords;
+
+  //solve the Non-Uniform Scale that infulence the normal
+  mat3 normalMatrix = mat3(transpose(inverse(model)));
+  if (instanced)
+    normalMatrix = normalMatrix * instanceNormalMatrix;
+  outNormal = normalMatrix * normal;
+  outTangent = normalMatrix * tangent;
+  outBitangent = normalMatrix * bitangent;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 outTexCoord;
+in vec3 outNormal;
+in vec3 outFragPos;
+
+// first diffuse texture of the mesh, bound by Mesh::bindMaterial
+uniform sampler2D texture_diffuse1;
+
+// a single fixed sun, the asteroid field does not take part in the scene lights
+const vec3 sunDirection = vec3(-0.2, -1.0, -0.3);
+
+void main() {
+  vec3 color = texture(texture_diffuse1, outTexCoord).rgb;
+  float diff = max(dot(normalize(outNormal), normalize(-sunDirection)), 0.0);
+  FragColor = vec4(color * (0.1 + 0.9 * diff), 1.0);
+}
@@ -2,23 +2,51 @@
 layout(location = 0) in vec3 Position;
 layout(location = 1) in vec3 Normal;
 layout(location = 2) in vec2 TexCoords;
+// node matrices of a mesh shared by several nodes, see Model::drawMesh
+layout(location = 5) in mat4 instanceModel;
+layout(location = 9) in mat3 instanceNormalMatrix;
+// bone influences of skinned meshes, see include/tool/animation.h
+layout(location = 13) in uvec4 boneIndices;
+layout(location = 14) in vec4 boneWeights;
 
 out vec2 outTexCoord;
 out vec3 outNormal;
 out vec3 outFragPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/frame_block.glsl"
+uniform bool instanced;
+// bone palettes of Model::DrawSkinned: three texels (the rows of a 3x4 matrix) per bone, boneCount bones per instance
+uniform bool skinned;
+uniform samplerBuffer bonePalette;
+uniform int boneCount;
+
+mat4 boneMatrix(uint bone)
+{
+  int base = (gl_InstanceID * boneCount + int(bone)) * 3;
+  return transpose(mat4(texelFetch(bonePalette, base), texelFetch(bonePalette, base + 1), texelFetch(bonePalette, base + 2), vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+mat4 skinMatrix()
+{
+  return boneMatrix(boneIndices.x) * boneWeights.x + boneMatrix(boneIndices.y) * boneWeights.y +
+         boneMatrix(boneIndices.z) * boneWeights.z + boneMatrix(boneIndices.w) * boneWeights.w;
+}
 
 void main() {
 
-  gl_Position = projection*view*model*vec4(Position, 1.0f);
+  mat4 skin = skinned ? skinMatrix() : mat4(1.0);
+  vec4 position = skin * vec4(Position, 1.0f);
+  vec3 normal = mat3(skin) * Normal;
+
+  mat4 world = instanced ? model * instanceModel : model;
+  gl_Position = viewProjection*world*position;
 
-  outFragPos =vec3(model * vec4(Position, 1.0f));
+  outFragPos =vec3(world * position);
 
   outTexCoord = TexCoords;
   
   //solve the Non-Uniform Scale that infulence the normal
-  outNormal = mat3(transpose(inverse(model))) * Normal;
+  mat3 normalMatrix = mat3(transpose(inverse(model)));
+  outNormal = (instanced ? normalMatrix * instanceNormalMatrix : normalMatrix) * normal;
 }
\ No newline at end of file
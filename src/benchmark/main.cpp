@@ -0,0 +1,313 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <chrono>
+#include <cfloat>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <geometry/BoxGeometry.h>
+#include <geometry/PlaneGeometry.h>
+#include <geometry/SphereGeometry.h>
+
+#include <tool/shader.h>
+#include <tool/obj_loader.h>
+#include <tool/animation.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/gltf_model.h>
+
+std::string Shader::dirName;
+
+using namespace std;
+
+// 重复执行 func 并返回单次平均耗时（秒）
+double timeIt(int repeat, const function<void()> &func)
+{
+  func(); // 预热
+  auto start = chrono::high_resolution_clock::now();
+  for (int i = 0; i < repeat; i++)
+    func();
+  auto end = chrono::high_resolution_clock::now();
+  return chrono::duration<double>(end - start).count() / repeat;
+}
+
+void benchTangents(const char *name, BufferGeometry &geometry, int repeat)
+{
+  double triangles = geometry.indices.size() / 3.0;
+  double seconds = timeIt(repeat, [&]() { geometry.computeTangents(); });
+  cout << "computeTangents " << name << ": " << (size_t)triangles << " triangles, "
+       << seconds * 1000.0 << " ms, " << triangles / seconds / 1e6 << " M triangles/s" << endl;
+}
+
+// Model 的两条 OBJ 导入路径：Assimp（与 Model 相同的后处理参数）对比 tool/obj_loader.h
+// 两者都输出三角化、带法线与切线的网格，之后的 optimizeMesh / LOD 步骤相同，不计入
+void benchObj(const char *path, int repeat)
+{
+  size_t assimpVertices = 0, assimpTriangles = 0;
+  double assimpSeconds = timeIt(repeat, [&]() {
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    assimpVertices = assimpTriangles = 0;
+    for (unsigned int i = 0; scene && i < scene->mNumMeshes; i++)
+    {
+      assimpVertices += scene->mMeshes[i]->mNumVertices;
+      assimpTriangles += scene->mMeshes[i]->mNumFaces;
+    }
+  });
+
+  size_t objVertices = 0, objTriangles = 0;
+  double objSeconds = timeIt(repeat, [&]() {
+    ObjScene scene;
+    loadObj(path, scene);
+    objVertices = objTriangles = 0;
+    for (unsigned int i = 0; i < scene.meshes.size(); i++)
+    {
+      objVertices += scene.meshes[i].vertices.size();
+      objTriangles += scene.meshes[i].indices.size() / 3;
+    }
+  });
+
+  cout << "OBJ import " << path << ":" << endl
+       << "  Assimp     " << assimpSeconds * 1000.0 << " ms, " << assimpTriangles << " triangles, " << assimpVertices << " vertices" << endl
+       << "  obj_loader " << objSeconds * 1000.0 << " ms, " << objTriangles << " triangles, " << objVertices << " vertices, "
+       << assimpSeconds / objSeconds << "x" << endl;
+}
+
+// 把 obj_loader 读出的网格写成自包含的 .glb：顶点按 Vertex 交错存放（byteStride），索引为 UNSIGNED_INT
+// 每个网格由两个节点放置，覆盖 GltfModel 共享网格的实例化路径；不写材质与切线（glTF 的 TANGENT 是 vec4）
+bool writeGlb(const ObjScene &scene, const string &path)
+{
+  string bin;
+  ostringstream views, accessors, meshes, nodes, roots;
+  accessors.precision(9);
+  unsigned int viewCount = 0, accessorCount = 0, nodeCount = 0;
+  auto separator = [](ostringstream &out) {
+    if (out.tellp() > 0)
+      out << ",";
+  };
+  // 数据追加到 BIN 块并按 4 字节对齐，返回偏移
+  auto append = [&](const void *data, size_t bytes) {
+    size_t offset = bin.size();
+    bin.append((const char *)data, bytes);
+    bin.resize((bin.size() + 3) & ~(size_t)3, '\0');
+    return offset;
+  };
+  auto addView = [&](size_t offset, size_t bytes, size_t stride, int target) {
+    separator(views);
+    views << "{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << bytes;
+    if (stride)
+      views << ",\"byteStride\":" << stride;
+    views << ",\"target\":" << target << "}";
+    return viewCount++;
+  };
+  auto addAccessor = [&](unsigned int view, size_t offset, int componentType, size_t count, const char *type, const string &extra) {
+    separator(accessors);
+    accessors << "{\"bufferView\":" << view << ",\"byteOffset\":" << offset << ",\"componentType\":" << componentType
+              << ",\"count\":" << count << ",\"type\":\"" << type << "\"" << extra << "}";
+    return accessorCount++;
+  };
+
+  unsigned int meshCount = 0;
+  for (unsigned int m = 0; m < scene.meshes.size(); m++)
+  {
+    const ObjMesh &mesh = scene.meshes[m];
+    if (mesh.vertices.empty() || mesh.indices.empty())
+      continue;
+    glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+    for (unsigned int i = 0; i < mesh.vertices.size(); i++)
+    {
+      low = glm::min(low, mesh.vertices[i].Position);
+      high = glm::max(high, mesh.vertices[i].Position);
+    }
+    ostringstream bounds;
+    bounds.precision(9);
+    bounds << ",\"min\":[" << low.x << "," << low.y << "," << low.z << "],\"max\":[" << high.x << "," << high.y << "," << high.z << "]";
+
+    size_t vertexBytes = mesh.vertices.size() * sizeof(Vertex);
+    size_t indexBytes = mesh.indices.size() * sizeof(unsigned int);
+    unsigned int vertexView = addView(append(mesh.vertices.data(), vertexBytes), vertexBytes, sizeof(Vertex), GL_ARRAY_BUFFER);
+    unsigned int indexView = addView(append(mesh.indices.data(), indexBytes), indexBytes, 0, GL_ELEMENT_ARRAY_BUFFER);
+    unsigned int position = addAccessor(vertexView, offsetof(Vertex, Position), GL_FLOAT, mesh.vertices.size(), "VEC3", bounds.str());
+    unsigned int normal = addAccessor(vertexView, offsetof(Vertex, Normal), GL_FLOAT, mesh.vertices.size(), "VEC3", "");
+    unsigned int texCoords = addAccessor(vertexView, offsetof(Vertex, TexCoords), GL_FLOAT, mesh.vertices.size(), "VEC2", "");
+    unsigned int indices = addAccessor(indexView, 0, GL_UNSIGNED_INT, mesh.indices.size(), "SCALAR", "");
+
+    separator(meshes);
+    meshes << "{\"name\":\"mesh" << m << "\",\"primitives\":[{\"attributes\":{\"POSITION\":" << position << ",\"NORMAL\":" << normal
+           << ",\"TEXCOORD_0\":" << texCoords << "},\"indices\":" << indices << "}]}";
+    for (int copy = 0; copy < 2; copy++)
+    {
+      separator(nodes);
+      nodes << "{\"mesh\":" << meshCount << ",\"translation\":[" << copy * 2.0f * (high.x - low.x) << ",0,0]}";
+      separator(roots);
+      roots << nodeCount++;
+    }
+    meshCount++;
+  }
+
+  string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" + roots.str() + "]}],\"nodes\":[" + nodes.str() +
+                "],\"meshes\":[" + meshes.str() + "],\"accessors\":[" + accessors.str() + "],\"bufferViews\":[" + views.str() +
+                "],\"buffers\":[{\"byteLength\":" + to_string(bin.size()) + "}]}";
+  json.resize((json.size() + 3) & ~(size_t)3, ' ');
+
+  ofstream out(path, ios::binary | ios::trunc);
+  if (!out)
+    return false;
+  uint32_t header[3] = {0x46546C67, 2, (uint32_t)(12 + 8 + json.size() + 8 + bin.size())};
+  uint32_t jsonChunk[2] = {(uint32_t)json.size(), 0x4E4F534A};
+  uint32_t binChunk[2] = {(uint32_t)bin.size(), 0x004E4942};
+  out.write((const char *)header, sizeof(header));
+  out.write((const char *)jsonChunk, sizeof(jsonChunk));
+  out.write(json.data(), json.size());
+  out.write((const char *)binChunk, sizeof(binChunk));
+  out.write(bin.data(), bin.size());
+  return (bool)out;
+}
+
+// GltfModel 读取 .glb（缓冲视图从映射直接上传，顶点不重新打包）对比 obj_loader 解析同一份几何（不含上传）
+void benchGltf(const char *objPath, int repeat)
+{
+  ObjScene scene;
+  string glbPath = string(objPath) + ".bench.glb";
+  if (!loadObj(objPath, scene) || !writeGlb(scene, glbPath))
+  {
+    cout << "ERROR::BENCHMARK:: could not convert " << objPath << " to " << glbPath << endl;
+    return;
+  }
+
+  bool loaded = false;
+  size_t primitives = 0, nodes = 0;
+  double gltfSeconds = timeIt(repeat, [&]() {
+    GltfModel model(glbPath);
+    loaded = model.loaded;
+    primitives = 0;
+    for (unsigned int m = 0; m < model.meshes.size(); m++)
+      primitives += model.meshes[m].primitives.size();
+    nodes = model.sceneGraph.size();
+    model.dispose();
+  });
+  if (!loaded)
+  {
+    cout << "ERROR::BENCHMARK:: GltfModel could not load " << glbPath << endl;
+    return;
+  }
+  double objSeconds = timeIt(repeat, [&]() {
+    ObjScene parsed;
+    loadObj(objPath, parsed);
+  });
+
+  cout << "glTF load " << glbPath << ":" << endl
+       << "  GltfModel  " << gltfSeconds * 1000.0 << " ms with upload, " << primitives << " primitives, " << nodes << " nodes" << endl
+       << "  obj_loader " << objSeconds * 1000.0 << " ms parse only" << endl;
+}
+
+// 合成骨架：joints 个关节排成 4 叉树，两段 2 秒的动画片段，每个关节都有平移与旋转关键帧
+// 对 characters 个角色做采样 + 交叉淡化 + 层级展开 + 骨骼矩阵，只计 CPU 部分，不上传
+void benchAnimation(unsigned int joints, unsigned int characters, int repeat)
+{
+  SceneGraph graph;
+  for (unsigned int j = 0; j < joints; j++)
+    graph.addNode(j == 0 ? -1 : (int)(j - 1) / 4, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f)), "joint" + to_string(j));
+  Skeleton skeleton;
+  for (unsigned int j = 0; j < joints; j++)
+    skeleton.addBone("joint" + to_string(j), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f * j, 0.0f)));
+  skeleton.setJoints(graph);
+
+  vector<AnimationClip> clips(2);
+  for (unsigned int c = 0; c < clips.size(); c++)
+  {
+    vector<JointKeys> tracks(joints);
+    for (unsigned int j = 0; j < joints; j++)
+    {
+      tracks[j].joint = j;
+      for (int k = 0; k <= 20; k++)
+      {
+        float time = k * 0.1f;
+        tracks[j].positionTimes.push_back(time);
+        tracks[j].positions.push_back(glm::vec3(0.0f, 0.1f, 0.01f * sin(time * (c + 1))));
+        tracks[j].rotationTimes.push_back(time);
+        tracks[j].rotations.push_back(glm::angleAxis(sin(time * 3.0f + j) * (c + 1) * 0.3f, glm::vec3(0.0f, 0.0f, 1.0f)));
+      }
+    }
+    clips[c].build(skeleton, "clip" + to_string(c), 2.0f, tracks);
+  }
+
+  vector<AnimationState> states(characters);
+  for (unsigned int i = 0; i < characters; i++)
+  {
+    states[i].time = i * 0.013f;
+    states[i].blendClip = 1;
+    states[i].blendTime = i * 0.007f;
+    states[i].blendWeight = (i % 10) / 10.0f;
+  }
+  vector<float> palettes((size_t)characters * joints * PALETTE_FLOATS_PER_BONE);
+  double seconds = timeIt(repeat, [&]() {
+    for (unsigned int i = 0; i < characters; i++)
+      states[i].time += 1.0f / 60.0f;
+    evaluatePalettes(skeleton, clips, states.data(), states.size(), palettes.data());
+  });
+  cout << "evaluatePalettes " << characters << " characters x " << joints << " joints: " << seconds * 1000.0 << " ms, "
+       << characters * (double)joints / seconds / 1e6 << " M joints/s" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // 不需要显示窗口，只需要 GL 上下文来创建几何体缓冲
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow *window = glfwCreateWindow(64, 64, "benchmark", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+
+  cout << "worker threads: " << ThreadPool::global().size() + 1 << endl;
+
+  // ---------------- 切线生成 ----------------
+  PlaneGeometry plane(1.0, 1.0, 512.0, 512.0);
+  SphereGeometry sphere(1.0, 512.0, 256.0);
+  BoxGeometry box(1.0, 1.0, 1.0, 64.0, 64.0, 64.0);
+
+  benchTangents("plane 512x512", plane, 10);
+  benchTangents("sphere 512x256", sphere, 10);
+  benchTangents("box 64x64x64", box, 10);
+
+  plane.dispose();
+  sphere.dispose();
+  box.dispose();
+
+  // ---------------- 骨骼动画 ----------------
+  benchAnimation(64, 500, 20);
+  benchAnimation(64, 2000, 10);
+
+  // ---------------- OBJ 导入 ----------------
+  benchObj("./static/model/cerberus/Cerberus.obj", 5);
+  benchObj("./static/model/nanosuit/nanosuit.obj", 5);
+
+  // ---------------- glTF 导入 ----------------
+  benchGltf("./static/model/nanosuit/nanosuit.obj", 5);
+
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}